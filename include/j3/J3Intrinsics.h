@@ -71,6 +71,7 @@ public:
   llvm::Function* ResolveSpecialStubFunction;
   llvm::Function* ResolveStaticStubFunction;
   llvm::Function* ResolveInterfaceFunction;
+  llvm::Function* HotMethodFunction;
 
   llvm::Function* VirtualLookupFunction;
   llvm::Function* IsSubclassOfFunction;
@@ -136,6 +137,12 @@ public:
   llvm::Constant* OffsetDisplayInVTConstant;
   llvm::Constant* OffsetBaseClassVTInVTConstant;
   llvm::Constant* OffsetIMTInVTConstant;
+
+  llvm::Constant* OffsetCodeInMethodConstant;
+  llvm::Constant* OffsetInvocationCountInMethodConstant;
+  llvm::Constant* OffsetBackEdgeCountInMethodConstant;
+  llvm::Constant* OffsetTierInMethodConstant;
+  llvm::Constant* OptimizedTierConstant;
   
   llvm::Constant* OffsetBaseClassInArrayClassConstant;
   llvm::Constant* OffsetLogSizeInPrimitiveClassConstant;
@@ -28,6 +28,7 @@ class Class;
 class CommonClass;
 class JavaMethod;
 class JavaVirtualTable;
+class Jnjvm;
 class JnjvmClassLoader;
 class Signdef;
 
@@ -56,6 +57,23 @@ public:
     return false;
   }
 
+  /// startCompilerThreads - Start nbThreads threads that compile methods in
+  /// the background. Compilers that can not compile concurrently ignore
+  /// the request.
+  ///
+  virtual void startCompilerThreads(Jnjvm* vm, uint32_t nbThreads) {}
+
+  /// enableTieredCompilation - Compile methods at the baseline tier first,
+  /// and recompile them with optimizations once they reach hotThreshold
+  /// invocations or loop back edges. Compilers that do not recompile
+  /// methods ignore the request.
+  ///
+  virtual void enableTieredCompilation(uint32_t hotThreshold) {}
+
+  /// optimizeMethod - Recompile a hot method with optimizations.
+  ///
+  virtual void optimizeMethod(JavaMethod* meth) {}
+
   virtual bool isCompilingGarbageCollector() {
 	  return compilingGarbageCollector;
   }
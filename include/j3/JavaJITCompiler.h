@@ -17,6 +17,7 @@
 
 namespace j3 {
 
+class JavaCompileQueue;
 class JavaJITCompiler;
 
 class JavaJITListener : public llvm::JITEventListener {
@@ -59,6 +60,35 @@ public:
   virtual void makeIMT(Class* cl);
   
   virtual void* materializeFunction(JavaMethod* meth, Class* customizeFor);
+
+  /// compileMethod - Compile the method with this compiler, in the current
+  /// thread.
+  ///
+  void* compileMethod(JavaMethod* meth, Class* customizeFor);
+
+  /// compileQueue - The queue of the compiler threads, or NULL if methods
+  /// are compiled by the threads that need them.
+  ///
+  static JavaCompileQueue* compileQueue;
+
+  virtual void startCompilerThreads(Jnjvm* vm, uint32_t nbThreads);
+
+  /// recompileMethod - Compile the method with optimizations with this
+  /// compiler, in the current thread, and install the new code.
+  ///
+  void* recompileMethod(JavaMethod* meth);
+
+  /// hotThreshold - The threshold of the baseline counters, or zero if
+  /// tiered compilation is disabled.
+  ///
+  static uint32 hotThreshold;
+
+  virtual void enableTieredCompilation(uint32_t threshold);
+  virtual void optimizeMethod(JavaMethod* meth);
+
+  virtual uint32 getHotThreshold() {
+    return hotThreshold;
+  }
   
   virtual llvm::Constant* getFinalObject(JavaObject* obj, CommonClass* cl);
   virtual JavaObject* getFinalObject(llvm::Value* C);
@@ -73,6 +103,7 @@ public:
   virtual llvm::Constant* getStringPtr(JavaString** str);
   virtual llvm::Constant* getResolvedConstantPool(JavaConstantPool* ctp);
   virtual llvm::Constant* getNativeFunction(JavaMethod* meth, void* natPtr);
+  virtual llvm::Constant* newInterfaceCallCache(Class* cl);
   
   virtual void setMethod(llvm::Function* func, void* ptr, const char* name);
   
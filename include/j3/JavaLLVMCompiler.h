@@ -104,6 +104,25 @@ public:
     return TheModule->getContext();
   }
 
+  /// protectEngine - Lock protecting the module, the LLVM context and the
+  /// execution engine of this compiler. Compilers do not share IR, so
+  /// different compilers can generate code concurrently.
+  ///
+  vmkit::LockRecursive protectEngine;
+
+  /// protectIR - Take the lock before creating IR or generating code with
+  /// this compiler.
+  ///
+  void protectIR() {
+    protectEngine.lock();
+  }
+
+  /// unprotectIR - Release the lock taken by protectIR.
+  ///
+  void unprotectIR() {
+    protectEngine.unlock();
+  }
+
   J3Intrinsics* getIntrinsics() {
     return &JavaIntrinsics;
   }
@@ -203,14 +222,37 @@ public:
   virtual llvm::Constant* getStringPtr(JavaString** str) = 0;
   virtual llvm::Constant* getResolvedConstantPool(JavaConstantPool* ctp) = 0;
   virtual llvm::Constant* getNativeFunction(JavaMethod* meth, void* natPtr) = 0;
+
+  /// newInterfaceCallCache - Allocate the inline cache of an invokeinterface
+  /// call site in a method of the class. Returns NULL if the compiler does
+  /// not emit inline caches.
+  ///
+  virtual llvm::Constant* newInterfaceCallCache(Class* cl) {
+    return NULL;
+  }
   
   virtual void setMethod(llvm::Function* func, void* ptr, const char* name) = 0;
   
   virtual void* materializeFunction(JavaMethod* meth,
                                     Class* customizeFor) = 0;
   llvm::Function* parseFunction(JavaMethod* meth, Class* customizeFor);
+
+  /// parseOptimizedFunction - Create a new function for the method and
+  /// compile it with inlining and the standard optimizations, regardless
+  /// of the tier the compiler uses by default.
+  ///
+  llvm::Function* parseOptimizedFunction(JavaMethod* meth);
+
+  /// getHotThreshold - Number of invocations or loop back edges after which
+  /// a method compiled at the baseline tier is recompiled. Zero if methods
+  /// are directly compiled with optimizations.
+  ///
+  virtual uint32 getHotThreshold() {
+    return 0;
+  }
    
   llvm::FunctionPassManager* JavaFunctionPasses;
+  llvm::FunctionPassManager* JavaBaselineFunctionPasses;
   llvm::FunctionPassManager* J3FunctionPasses;
   llvm::FunctionPassManager* JavaNativeFunctionPasses;
   
@@ -34,9 +34,14 @@ protected:
   Thread* initiator;
   
 public: 
+  /// selfScanStacks - Should threads joining the rendezvous record the roots
+  /// of their stack before blocking, to shorten stack scanning?
+  bool selfScanStacks;
+
   CollectionRV() {
     nbJoined = 0;
     initiator = NULL;
+    selfScanStacks = false;
   }
 
   void lockRV() { _lockRV.lock(); }
@@ -89,30 +89,86 @@ namespace vmkit {
 		///
 		vmkit::LockNormal FinalizationLock;
 
+		/// BatchSize - The maximum number of objects a finalizer thread takes
+		/// from the queue at once.
+		///
+		static const uint32 BatchSize = 32;
+
+		/// Owner - The thread holding the queues. Other finalizer threads only
+		/// help it finalize objects.
+		///
+		FinalizerThread* Owner;
+
+		/// NextWorker - The next finalizer thread of the owner.
+		///
+		FinalizerThread* NextWorker;
+
+		/// NbWorkers - The number of finalizer threads, owner included.
+		///
+		uint32 NbWorkers;
+
+		/// Batch - The objects taken from the queue and not yet finalized, from
+		/// BatchIndex to BatchLength. They are roots of this thread.
+		///
+		gc* Batch[BatchSize];
+		uint32 BatchIndex;
+		uint32 BatchLength;
+
+		/// takeBatch - Take a share of the objects to be finalized. Returns
+		/// false if there are none.
+		///
+		bool takeBatch() {
+			FinalizerThread* queue = Owner;
+			queue->FinalizationQueueLock.acquire();
+			uint32 length = queue->CurrentFinalizedIndex / queue->NbWorkers;
+			if (length == 0) length = queue->CurrentFinalizedIndex;
+			if (length > BatchSize) length = BatchSize;
+			for (uint32 i = 0; i < length; ++i) {
+				Batch[i] = queue->ToBeFinalized[--queue->CurrentFinalizedIndex];
+			}
+			BatchIndex = 0;
+			BatchLength = length;
+			queue->FinalizationQueueLock.release();
+			return length != 0;
+		}
+
 		static void finalizerStart(FinalizerThread* th) {
 			gc* res = NULL;
 			llvm_gcroot(res, 0);
+			FinalizerThread* queue = th->Owner;
 
 			while (true) {
-				th->FinalizationLock.lock();
-				while (th->CurrentFinalizedIndex == 0) {
-					th->FinalizationCond.wait(&th->FinalizationLock);
+				queue->FinalizationLock.lock();
+				while (queue->CurrentFinalizedIndex == 0) {
+					queue->FinalizationCond.wait(&queue->FinalizationLock);
 				}
-				th->FinalizationLock.unlock();
+				queue->FinalizationLock.unlock();
 
-				while (true) {
-					th->FinalizationQueueLock.acquire();
-					if (th->CurrentFinalizedIndex != 0) {
-						res = th->ToBeFinalized[th->CurrentFinalizedIndex - 1];
-						--th->CurrentFinalizedIndex;
+				while (th->takeBatch()) {
+					while (th->BatchIndex < th->BatchLength) {
+						res = th->Batch[th->BatchIndex++];
+						th->MyVM->finalizeObject(res);
+						res = NULL;
 					}
-					th->FinalizationQueueLock.release();
-					if (!res) break;
+				}
+			}
+		}
 
-					th->MyVM->finalizeObject(res);
+		/// addWorker - Add a thread helping this thread finalize objects. The
+		/// worker is started by the caller.
+		///
+		void addWorker(FinalizerThread* worker) {
+			worker->NextWorker = NextWorker;
+			NextWorker = worker;
+			++NbWorkers;
+		}
 
-					res = NULL;
-				}
+		/// tracer - Trace the objects of the batch being finalized.
+		///
+		virtual void tracer(word_t closure) {
+			T_THREAD::tracer(closure);
+			for (uint32 i = BatchIndex; i < BatchLength; ++i) {
+				vmkit::Collector::markAndTraceRoot(NULL, Batch + i, closure);
 			}
 		}
 
@@ -168,6 +224,29 @@ namespace vmkit {
 			ToBeFinalized = new gc*[INITIAL_QUEUE_SIZE];
 			ToBeFinalizedLength = INITIAL_QUEUE_SIZE;
 			CurrentFinalizedIndex = 0;
+
+			Owner = this;
+			NextWorker = NULL;
+			NbWorkers = 1;
+			BatchIndex = 0;
+			BatchLength = 0;
+		}
+
+		FinalizerThread(vmkit::VirtualMachine* vm, FinalizerThread* owner) :
+				T_THREAD(vm) {
+			FinalizationQueue = NULL;
+			QueueLength = 0;
+			CurrentIndex = 0;
+
+			ToBeFinalized = NULL;
+			ToBeFinalizedLength = 0;
+			CurrentFinalizedIndex = 0;
+
+			Owner = owner;
+			NextWorker = NULL;
+			NbWorkers = 1;
+			BatchIndex = 0;
+			BatchLength = 0;
 		}
 
 		~FinalizerThread() {
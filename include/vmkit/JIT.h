@@ -100,6 +100,8 @@ public:
 
   llvm::Function* llvm_memcpy_i32;
   llvm::Function* llvm_memset_i32;
+  llvm::Function* llvm_memmove_i32;
+  llvm::Function* llvm_memmove_i64;
   llvm::Function* llvm_frameaddress;
   llvm::Function* llvm_gc_gcroot;
 
@@ -109,6 +111,7 @@ public:
   llvm::Function* AllocateUnresolvedFunction;
   llvm::Function* AddFinalizationCandidate;
   llvm::Function* ArrayWriteBarrierFunction;
+  llvm::Function* ArrayCopyWriteBarrierFunction;
   llvm::Function* FieldWriteBarrierFunction;
   llvm::Function* NonHeapWriteBarrierFunction;
 
@@ -190,6 +193,11 @@ public:
 
    static void addCommandLinePasses(llvm::FunctionPassManager* PM);
 
+   /// addBaselinePasses - Add the cheap passes used for code that is
+   /// compiled quickly and recompiled once hot.
+   ///
+   static void addBaselinePasses(llvm::FunctionPassManager* PM);
+
    static const char* getHostTriple();
 };
 
@@ -101,12 +101,38 @@ public:
   bool associatedObjectIsDead() const {return associatedObjectDead;}
   void markAssociatedObjectAsDead() {associatedObjectDead = true;}
 
+  /// deflate - If nobody holds, waits on, or blocks on this lock, give its
+  /// object back a thin lock and put this lock in the free list. Returns
+  /// true if the lock was deflated. Only called during a collection, when
+  /// mutators are stopped.
+  ///
+  bool deflate(LockSystem& table);
+
   friend class LockSystem;
   friend class LockingThread;
   friend class ThinLock;
 };
 
 
+/// BiasInfo - The history of bias revocations of the objects of a class,
+/// that is of the objects sharing a virtual table.
+///
+class BiasInfo {
+public:
+  /// VT - The virtual table of the objects.
+  ///
+  void* VT;
+
+  /// revocations - Number of biases of objects of the class revoked since
+  /// lastRevocation minus LockSystem::BiasDecayTime.
+  ///
+  uint32_t revocations;
+
+  /// lastRevocation - Time in seconds of the last revocation.
+  ///
+  uint32_t lastRevocation;
+};
+
 /// LockSystem - This class manages all Java locks used by the applications.
 /// Each JVM must own an instance of this class and allocate Java locks
 /// with it.
@@ -142,6 +168,83 @@ public:
   /// threadLock - Spin lock to protect the currentIndex field.
   ///
   vmkit::SpinLock threadLock;
+
+  /// MinSpin, MaxSpin - Bounds of the number of times a thread spins on a
+  /// thin lock held by another thread before parking.
+  ///
+  static const uint32_t MinSpin = 16;
+  static const uint32_t MaxSpin = 1 << 14;
+
+  /// MaxBackoff - The maximum number of pauses between two reads of the
+  /// header of a lock a thread spins on.
+  ///
+  static const uint32_t MaxBackoff = 64;
+
+  /// spinLimit - The number of times a thread spins on a thin lock held by
+  /// another thread before parking. Grows when spinning gets the lock,
+  /// shrinks when it does not. Updates are racy, this is only a hint.
+  ///
+  uint32_t spinLimit;
+
+  /// parkLock - Lock protecting the parked threads.
+  ///
+  vmkit::LockNormal parkLock;
+
+  /// parkCond - Condition on which threads wait for a contended thin lock to
+  /// be inflated by its owner.
+  ///
+  vmkit::Cond parkCond;
+
+  /// parkedThreads - Number of threads waiting on parkCond.
+  ///
+  uint32_t parkedThreads;
+
+  /// park - Wait until the owner of the contended thin lock of the object
+  /// releases it. header is the value of the header when the lock was seen
+  /// held by another thread.
+  ///
+  void park(gc* object, word_t header);
+
+  /// unparkAll - Wake up the threads waiting on contended thin locks. Called
+  /// by the owner of a lock after clearing its contended bit.
+  ///
+  void unparkAll();
+
+  /// BulkRebiasThreshold - Number of revocations after which unlocked
+  /// objects of a class are rebiased to the thread revoking their bias,
+  /// instead of getting a thin lock.
+  ///
+  static const uint32_t BulkRebiasThreshold = 20;
+
+  /// BulkRevokeThreshold - Number of revocations after which objects of a
+  /// class are not biased anymore.
+  ///
+  static const uint32_t BulkRevokeThreshold = 40;
+
+  /// BiasDecayTime - Time in seconds after which the revocations of a class
+  /// are forgotten, if the class has not reached BulkRevokeThreshold.
+  ///
+  static const uint32_t BiasDecayTime = 25;
+
+  /// BiasTableSize - The number of classes whose revocations are recorded.
+  ///
+  static const uint32_t BiasTableSize = 1024;
+
+  /// biasTable - Open addressing hash table of the classes with revoked
+  /// biases. Entries are only added by the thread revoking a bias, while
+  /// other threads are stopped.
+  ///
+  BiasInfo* biasTable;
+
+  /// getBiasInfo - Get the entry of the virtual table in biasTable. Returns
+  /// NULL if the table does not have it and create is false, or if the
+  /// table is full.
+  ///
+  BiasInfo* getBiasInfo(void* VT, bool create);
+
+  /// canBias - Can the lock of the object be biased towards a thread?
+  ///
+  bool canBias(gc* object);
   
   /// allocate - Allocate a FatLock.
   ///
@@ -174,19 +277,47 @@ public:
   //    ^      ^^^ ^^^^ ^^^^        ^^^^ ^^^^ ^^^^        ^^^^ ^^^^
   //    1           11                    12                  8
   // fat lock    thread id       thin lock count + hash     GC bits
+  //
+  // The highest bit of the thin lock count is the contended bit: it is set
+  // by threads that gave up spinning on the lock and wait for its owner to
+  // inflate it. Code generated by the JIT only releases a thin lock whose
+  // contended bit is clear, other releases go through ThinLock::release.
+  //
+  // On 64-bit architectures, the lock can also be biased towards the first
+  // thread that locks the object: the header then contains BiasedMask, the
+  // thread id and the number of times the thread holds the lock, which the
+  // thread updates without atomic operations. Other threads revoke the bias
+  // at a rendezvous, which gives the object a thin lock. A header whose lock
+  // bits are only BiasedMask is unlocked and cannot be biased anymore. A
+  // header whose lock bits are zero has never been locked.
 
   static const uint64_t FatMask = 1LL << (kThreadStart > 0xFFFFFFFFLL ? 61LL : 31LL);
 
   static const uint64_t NonLockBits = HashBits + GCBits;
   static const uint64_t NonLockBitsMask = ((1LL << NonLockBits) - 1LL);
 
-  static const uint64_t ThinCountMask = 0xFFFFFFFFLL & ~(FatMask | kThreadIDMask | NonLockBitsMask);
+  static const uint64_t ThinLockBitsMask = 0xFFFFFFFFLL & ~(FatMask | kThreadIDMask | NonLockBitsMask);
+  static const uint64_t ContendedMask = (ThinLockBitsMask + (1LL << NonLockBits)) >> 1;
+  static const uint64_t ThinCountMask = ThinLockBitsMask & ~ContendedMask;
   static const uint64_t ThinCountShift = NonLockBits;
   static const uint64_t ThinCountAdd = 1LL << NonLockBits;
 
-  /// initialise - Initialise the value of the lock.
+  static const uint64_t BiasedMask = (kThreadStart > 0xFFFFFFFFLL) ? (1LL << 62LL) : 0;
+
+  /// getBiasedOwnerID - The id of the thread the header is biased towards,
+  /// or 0 if it is not biased.
+  ///
+  static word_t getBiasedOwnerID(word_t header) {
+    if (BiasedMask == 0) return 0;
+    if ((header & (BiasedMask | FatMask)) != BiasedMask) return 0;
+    return header & System::GetThreadIDMask() & ~(BiasedMask | FatMask);
+  }
+
+  /// revokeBias - Revoke the bias of the lock of the object, if it has one,
+  /// at a rendezvous. An unlocked object is rebiased towards the current
+  /// thread if rebias is true and its class has had many revocations.
   ///
-  static void removeFatLock(FatLock* fatLock, LockSystem& table);
+  static void revokeBias(gc* object, LockSystem& table, bool rebias);
 
   /// overflowThinlock - Change the lock of this object to a fat lock because
   /// we have reached the maximum number of locks.
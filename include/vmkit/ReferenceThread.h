@@ -11,6 +11,7 @@
 #define VMKIT_REFERENCE_THREAD_H
 
 #include "vmkit/Locks.h"
+#include "vmkit/System.h"
 
 // Same values than JikesRVM
 #define INITIAL_QUEUE_SIZE 256
@@ -28,8 +29,47 @@ namespace vmkit {
 	  vmkit::SpinLock QueueLock;
 	  uint8_t semantics;
 
+	  /// Timestamps - For soft references, the time in milliseconds of the
+	  /// registration of each reference, or of the last access to its referent
+	  /// recorded by the threads. The class library may also keep the time of
+	  /// the last access in the reference itself.
+	  ///
+	  uint64_t* Timestamps;
+
+	  /// IndexTable - For soft references, an open addressing table from a
+	  /// reference to one plus its position in the queue, zero being empty.
+	  /// It is rebuilt when references move.
+	  ///
+	  uint32* IndexTable;
+	  uint32 IndexSize;
+
+	  /// MaxAge, Now - The age in milliseconds above which soft referents not
+	  /// otherwise reachable are cleared, and the time of the current scan.
+	  ///
+	  uint64_t MaxAge;
+	  uint64_t Now;
+
+	  static uint32 hash(gc* ref) {
+	    return (uint32)(((word_t)ref >> 3) * 2654435761U);
+	  }
+
+	  void rebuildIndex(uint32 size) {
+	    if (size != IndexSize) {
+	      delete[] IndexTable;
+	      IndexTable = new uint32[size];
+	      IndexSize = size;
+	    }
+	    memset(IndexTable, 0, IndexSize * sizeof(uint32));
+	    for (uint32 i = 0; i < CurrentIndex; ++i) {
+	      uint32 index = hash(References[i]);
+	      while (IndexTable[index & (IndexSize - 1)] != 0) ++index;
+	      IndexTable[index & (IndexSize - 1)] = i + 1;
+	    }
+	  }
+
 	  template <class T>
-	  gc* processReference(gc* reference, ReferenceThread<T>* th, word_t closure) {
+	  gc* processReference(gc* reference, uint64_t timestamp,
+	                       ReferenceThread<T>* th, word_t closure) {
         gc *referent = NULL, *newReference = NULL, *newReferent = NULL;
         llvm_gcroot(referent, 0);
         llvm_gcroot(newReference, 0);
@@ -48,9 +88,18 @@ namespace vmkit {
 	    }
 
 	    if (semantics == SOFT) {
-	      // TODO: are we are out of memory? Consider that we always are for now.
-	      if (false) {
-	        vmkit::Collector::retainReferent(referent, closure);
+	      // Keep the referents used recently enough for the free memory. The
+	      // oldest referents are the first cleared when memory gets short.
+	      if (!vmkit::Collector::isLive(referent, closure)) {
+	        vmkit::VirtualMachine* vm = vmkit::Thread::get()->MyVM;
+	        uint64_t accessed = vm->getObjectReferenceTimestamp(reference);
+	        if (accessed > timestamp) timestamp = accessed;
+	        if (Now - timestamp <= MaxAge) {
+	          vmkit::Collector::retainReferent(referent, closure);
+	          ++vm->softReferencesKept;
+	        } else {
+	          ++vm->softReferencesCleared;
+	        }
 	      }
 	    } else if (semantics == PHANTOM) {
 	      // Nothing to do.
@@ -79,35 +128,85 @@ namespace vmkit {
 	  ReferenceQueue(uint8_t s) {
 	    References = new gc*[INITIAL_QUEUE_SIZE];
 	    memset(References, 0, INITIAL_QUEUE_SIZE * sizeof(gc*));
+	    Timestamps = new uint64_t[INITIAL_QUEUE_SIZE];
 	    QueueLength = INITIAL_QUEUE_SIZE;
 	    CurrentIndex = 0;
+	    IndexTable = NULL;
+	    IndexSize = 0;
+	    MaxAge = 0;
+	    Now = 0;
 	    semantics = s;
+	    if (semantics == SOFT) rebuildIndex(2 * INITIAL_QUEUE_SIZE);
 	  }
 
 	  ~ReferenceQueue() {
 	    delete[] References;
+	    delete[] Timestamps;
+	    delete[] IndexTable;
 	  }
 
-	  void addReference(gc* ref) {
+	  /// append - Add a reference registered at the given time. The caller
+	  /// holds the lock of the queue.
+	  ///
+	  void append(gc* ref, uint64_t timestamp) {
 	    llvm_gcroot(ref, 0);
-	    QueueLock.acquire();
 	    if (CurrentIndex >= QueueLength) {
 	      uint32 newLength = QueueLength * GROW_FACTOR;
 	      gc** newQueue = new gc*[newLength];
+	      uint64_t* newTimestamps = new uint64_t[newLength];
 	      if (!newQueue) {
 	        fprintf(stderr, "I don't know how to handle reference overflow yet!\n");
 	        abort();
 	      }
 	      memset(newQueue, 0, newLength * sizeof(gc*));
 	      for (uint32 i = 0; i < QueueLength; ++i) newQueue[i] = References[i];
+	      memcpy(newTimestamps, Timestamps, QueueLength * sizeof(uint64_t));
 	      delete[] References;
+	      delete[] Timestamps;
 	      References = newQueue;
+	      Timestamps = newTimestamps;
 	      QueueLength = newLength;
 	    }
+	    Timestamps[CurrentIndex] = timestamp;
 	    References[CurrentIndex++] = ref;
+	    if (semantics == SOFT) {
+	      if (2 * CurrentIndex > IndexSize) {
+	        rebuildIndex(2 * IndexSize);
+	      } else {
+	        uint32 index = hash(ref);
+	        while (IndexTable[index & (IndexSize - 1)] != 0) ++index;
+	        IndexTable[index & (IndexSize - 1)] = CurrentIndex;
+	      }
+	    }
+	  }
+
+	  void addReference(gc* ref) {
+	    llvm_gcroot(ref, 0);
+	    uint64_t timestamp =
+	      (semantics == SOFT) ? vmkit::System::GetTimeMillis() : 0;
+	    QueueLock.acquire();
+	    append(ref, timestamp);
 	    QueueLock.release();
 	  }
 
+	  /// touch - Record an access to the referent of a soft reference at the
+	  /// given time. The caller holds the lock of the queue.
+	  ///
+	  void touch(gc* ref, uint64_t now) {
+	    llvm_gcroot(ref, 0);
+	    assert(semantics == SOFT && "Only soft references have timestamps");
+	    uint32 index = hash(ref);
+	    while (true) {
+	      uint32 pos = IndexTable[index & (IndexSize - 1)];
+	      if (pos == 0) break;
+	      if (References[pos - 1] == ref) {
+	        Timestamps[pos - 1] = now;
+	        break;
+	      }
+	      ++index;
+	    }
+	  }
+
 	  void acquire() {
 	    QueueLock.acquire();
 	  }
@@ -123,17 +222,71 @@ namespace vmkit {
         llvm_gcroot(res, 0);
 	    uint32 NewIndex = 0;
 
+	    if (semantics == SOFT) {
+	      // Referents may stay unused for softReferenceMSPerMB milliseconds
+	      // per MB free after the previous collection.
+	      vmkit::VirtualMachine* vm = vmkit::Thread::get()->MyVM;
+	      size_t freeMemory = vm->softReferenceFreeMemory;
+	      if (freeMemory == ~(size_t)0) {
+	        freeMemory = vmkit::Collector::getMaxMemory();
+	      }
+	      MaxAge = (freeMemory >> 20) * vm->softReferenceMSPerMB;
+	      Now = vmkit::System::GetTimeMillis();
+	    }
+
 	    for (uint32 i = 0; i < CurrentIndex; ++i) {
 	      obj = References[i];
-	      res = processReference(obj, thread, closure);
-	      if (res) References[NewIndex++] = res;
+	      res = processReference(obj, Timestamps[i], thread, closure);
+	      if (res) {
+	        Timestamps[NewIndex] = Timestamps[i];
+	        References[NewIndex++] = res;
+	      }
 	    }
 
 	    CurrentIndex = NewIndex;
+	    if (semantics == SOFT) rebuildIndex(IndexSize);
 	  }
 
 	};
 
+	/// ReferenceBuffer - References registered by a mutator thread and not yet
+	/// added to the queues. A thread fills its buffer without taking the locks
+	/// of the queues, and the collector empties all buffers before scanning
+	/// the queues. Buffers are never freed: a thread gives its buffer back
+	/// when it stops executing Java code, and the buffer is then given to the
+	/// next thread needing one.
+	///
+	class ReferenceBuffer {
+	public:
+	  static const uint32 Size = 64;
+
+	  gc* References[Size];
+	  uint64_t Timestamps[Size];
+	  uint8_t Semantics[Size];
+	  uint32 Length;
+
+	  /// Touched - The soft references whose referent the thread accessed
+	  /// since the buffer was last flushed.
+	  ///
+	  gc* Touched[Size];
+	  uint32 TouchedLength;
+
+	  /// InUse - Is the buffer owned by a thread?
+	  ///
+	  uint32 InUse;
+
+	  /// Next - The next buffer of the reference thread.
+	  ///
+	  ReferenceBuffer* Next;
+
+	  ReferenceBuffer() {
+	    Length = 0;
+	    TouchedLength = 0;
+	    InUse = 1;
+	    Next = NULL;
+	  }
+	};
+
 	template <class T_THREAD> class ReferenceThread : public T_THREAD {
 	public:
 	  /// WeakReferencesQueue - The queue of weak references.
@@ -158,32 +311,216 @@ namespace vmkit {
 	  vmkit::Cond EnqueueCond;
 	  vmkit::SpinLock ToEnqueueLock;
 
+	  /// Buffers - The registration buffers of the mutator threads.
+	  ///
+	  ReferenceBuffer* Buffers;
+
+	  /// BuffersLock - A lock to protect the list of buffers. The collector
+	  /// holds it during collections.
+	  ///
+	  vmkit::SpinLock BuffersLock;
+
+	  /// BatchSize - The maximum number of references an enqueue thread takes
+	  /// from the queue at once.
+	  ///
+	  static const uint32 BatchSize = 32;
+
+	  /// Owner - The thread holding the queues. Other enqueue threads only help
+	  /// it enqueue references.
+	  ///
+	  ReferenceThread* Owner;
+
+	  /// NextWorker - The next enqueue thread of the owner.
+	  ///
+	  ReferenceThread* NextWorker;
+
+	  /// NbWorkers - The number of enqueue threads, owner included.
+	  ///
+	  uint32 NbWorkers;
+
+	  /// Batch - The references taken from the queue and not yet enqueued,
+	  /// from BatchIndex to BatchLength. They are roots of this thread.
+	  ///
+	  gc* Batch[BatchSize];
+	  uint32 BatchIndex;
+	  uint32 BatchLength;
+
+	  /// takeBatch - Take a share of the references to enqueue. Returns false
+	  /// if there are none.
+	  ///
+	  bool takeBatch() {
+	    ReferenceThread* queue = Owner;
+	    queue->ToEnqueueLock.acquire();
+	    uint32 length = queue->ToEnqueueIndex / queue->NbWorkers;
+	    if (length == 0) length = queue->ToEnqueueIndex;
+	    if (length > BatchSize) length = BatchSize;
+	    for (uint32 i = 0; i < length; ++i) {
+	      Batch[i] = queue->ToEnqueue[--queue->ToEnqueueIndex];
+	    }
+	    BatchIndex = 0;
+	    BatchLength = length;
+	    queue->ToEnqueueLock.release();
+	    return length != 0;
+	  }
+
 	  static void enqueueStart(ReferenceThread* th){
 	    gc* res = NULL;
 	    llvm_gcroot(res, 0);
+	    ReferenceThread* queue = th->Owner;
 
 	    while (true) {
-	      th->EnqueueLock.lock();
-	      while (th->ToEnqueueIndex == 0) {
-	        th->EnqueueCond.wait(&th->EnqueueLock);
+	      queue->EnqueueLock.lock();
+	      while (queue->ToEnqueueIndex == 0) {
+	        queue->EnqueueCond.wait(&queue->EnqueueLock);
 	      }
-	      th->EnqueueLock.unlock();
+	      queue->EnqueueLock.unlock();
 
-	      while (true) {
-	        th->ToEnqueueLock.acquire();
-	        if (th->ToEnqueueIndex != 0) {
-	          res = th->ToEnqueue[th->ToEnqueueIndex - 1];
-	          --th->ToEnqueueIndex;
+	      while (th->takeBatch()) {
+	        while (th->BatchIndex < th->BatchLength) {
+	          res = th->Batch[th->BatchIndex++];
+	          vmkit::Thread::get()->MyVM->invokeEnqueueReference(res);
+	          res = NULL;
 	        }
-	        th->ToEnqueueLock.release();
-	        if (!res) break;
+	      }
+	    }
+	  }
+
+	  /// addWorker - Add a thread helping this thread enqueue references. The
+	  /// worker is started by the caller.
+	  ///
+	  void addWorker(ReferenceThread* worker) {
+	    worker->NextWorker = NextWorker;
+	    NextWorker = worker;
+	    ++NbWorkers;
+	  }
+
+	  /// tracer - Trace the references of the batch being enqueued.
+	  ///
+	  virtual void tracer(word_t closure) {
+	    T_THREAD::tracer(closure);
+	    for (uint32 i = BatchIndex; i < BatchLength; ++i) {
+	      vmkit::Collector::markAndTraceRoot(NULL, Batch + i, closure);
+	    }
+	  }
+
+	  ReferenceQueue& getQueue(uint8_t semantics) {
+	    if (semantics == ReferenceQueue::SOFT) return SoftReferencesQueue;
+	    if (semantics == ReferenceQueue::WEAK) return WeakReferencesQueue;
+	    return PhantomReferencesQueue;
+	  }
+
+	  /// getBuffer - Get a registration buffer for the current thread.
+	  ///
+	  ReferenceBuffer* getBuffer() {
+	    BuffersLock.acquire();
+	    ReferenceBuffer* buffer = Buffers;
+	    while (buffer != NULL && buffer->InUse) buffer = buffer->Next;
+	    if (buffer == NULL) {
+	      buffer = new ReferenceBuffer();
+	      buffer->Next = Buffers;
+	      Buffers = buffer;
+	    }
+	    buffer->InUse = 1;
+	    BuffersLock.release();
+	    return buffer;
+	  }
+
+	  /// releaseBuffer - Give back the buffer of a thread that exits. Its
+	  /// references are added to the queues by the next collection.
+	  ///
+	  void releaseBuffer(ReferenceBuffer* buffer) {
+	    __sync_synchronize();
+	    buffer->InUse = 0;
+	  }
+
+	  /// flushBuffer - Add the references of a full buffer to the queues.
+	  /// A collection may flush the buffer while the locks are acquired, so
+	  /// the buffer is only read once all of them are held. They are taken in
+	  /// the order of the collector.
+	  ///
+	  void flushBuffer(ReferenceBuffer* buffer) {
+	    SoftReferencesQueue.acquire();
+	    WeakReferencesQueue.acquire();
+	    PhantomReferencesQueue.acquire();
+	    for (uint32 i = 0; i < buffer->Length; ++i) {
+	      getQueue(buffer->Semantics[i]).append(buffer->References[i],
+	                                            buffer->Timestamps[i]);
+	    }
+	    buffer->Length = 0;
+	    PhantomReferencesQueue.release();
+	    WeakReferencesQueue.release();
+	    SoftReferencesQueue.release();
+	  }
 
-	        vmkit::Thread::get()->MyVM->invokeEnqueueReference(res);
-	        res = NULL;
+	  /// flushBuffers - Add the references of all buffers to the queues. Only
+	  /// called by the collector, which holds the locks of the buffers and of
+	  /// the queues while mutators are stopped.
+	  ///
+	  void flushBuffers() {
+	    for (ReferenceBuffer* buffer = Buffers; buffer != NULL;
+	         buffer = buffer->Next) {
+	      for (uint32 i = 0; i < buffer->Length; ++i) {
+	        getQueue(buffer->Semantics[i]).append(buffer->References[i],
+	                                              buffer->Timestamps[i]);
+	      }
+	      buffer->Length = 0;
+	    }
+	    // Accesses are applied once all references are in the queues.
+	    uint64_t now = vmkit::System::GetTimeMillis();
+	    for (ReferenceBuffer* buffer = Buffers; buffer != NULL;
+	         buffer = buffer->Next) {
+	      for (uint32 i = 0; i < buffer->TouchedLength; ++i) {
+	        SoftReferencesQueue.touch(buffer->Touched[i], now);
 	      }
+	      buffer->TouchedLength = 0;
 	    }
 	  }
 
+	  /// addReference - Register a reference in the buffer of the current
+	  /// thread, allocating the buffer on first use.
+	  ///
+	  void addReference(gc* ref, uint8_t semantics, ReferenceBuffer** ptr) {
+	    llvm_gcroot(ref, 0);
+	    if (*ptr == NULL) *ptr = getBuffer();
+	    ReferenceBuffer* buffer = *ptr;
+	    if (buffer->Length == ReferenceBuffer::Size) flushBuffer(buffer);
+	    buffer->References[buffer->Length] = ref;
+	    buffer->Timestamps[buffer->Length] =
+	      (semantics == ReferenceQueue::SOFT) ? vmkit::System::GetTimeMillis() : 0;
+	    buffer->Semantics[buffer->Length] = semantics;
+	    ++buffer->Length;
+	  }
+
+	  /// touchSoftReference - Record an access to the referent of a soft
+	  /// reference, for class libraries that do not keep the time of the last
+	  /// access in the reference. The access is logged in the buffer of the
+	  /// current thread, without taking a lock, and timed when the log is
+	  /// flushed.
+	  ///
+	  void touchSoftReference(gc* ref, ReferenceBuffer** ptr) {
+	    llvm_gcroot(ref, 0);
+	    if (*ptr == NULL) *ptr = getBuffer();
+	    ReferenceBuffer* buffer = *ptr;
+	    // Caches usually get the same reference repeatedly.
+	    uint32 length = buffer->TouchedLength;
+	    if (length != 0 && buffer->Touched[length - 1] == ref) return;
+	    if (length == ReferenceBuffer::Size) flushTouched(buffer);
+	    buffer->Touched[buffer->TouchedLength++] = ref;
+	  }
+
+	  /// flushTouched - Record the accesses logged in a full buffer.
+	  ///
+	  void flushTouched(ReferenceBuffer* buffer) {
+	    uint64_t now = vmkit::System::GetTimeMillis();
+	    // A collection may flush the buffer while the lock is acquired.
+	    SoftReferencesQueue.acquire();
+	    for (uint32 i = 0; i < buffer->TouchedLength; ++i) {
+	      SoftReferencesQueue.touch(buffer->Touched[i], now);
+	    }
+	    buffer->TouchedLength = 0;
+	    SoftReferencesQueue.release();
+	  }
+
 	  void addToEnqueue(gc* obj) {
 	    llvm_gcroot(obj, 0);
 	    if (ToEnqueueIndex >= ToEnqueueLength) {
@@ -205,23 +542,23 @@ namespace vmkit {
 
 	  /// addWeakReference - Add a weak reference to the queue.
 	  ///
-	  void addWeakReference(gc* ref) {
+	  void addWeakReference(gc* ref, ReferenceBuffer** buffer) {
 	    llvm_gcroot(ref, 0);
-	    WeakReferencesQueue.addReference(ref);
+	    addReference(ref, ReferenceQueue::WEAK, buffer);
 	  }
 
-	  /// addSoftReference - Add a weak reference to the queue.
+	  /// addSoftReference - Add a soft reference to the queue.
 	  ///
-	  void addSoftReference(gc* ref) {
+	  void addSoftReference(gc* ref, ReferenceBuffer** buffer) {
 	    llvm_gcroot(ref, 0);
-	    SoftReferencesQueue.addReference(ref);
+	    addReference(ref, ReferenceQueue::SOFT, buffer);
 	  }
 
-	  /// addPhantomReference - Add a weak reference to the queue.
+	  /// addPhantomReference - Add a phantom reference to the queue.
 	  ///
-	  void addPhantomReference(gc* ref) {
+	  void addPhantomReference(gc* ref, ReferenceBuffer** buffer) {
 	    llvm_gcroot(ref, 0);
-	    PhantomReferencesQueue.addReference(ref);
+	    addReference(ref, ReferenceQueue::PHANTOM, buffer);
 	  }
 
 	  ReferenceThread(vmkit::VirtualMachine* vm) : T_THREAD(vm), WeakReferencesQueue(ReferenceQueue::WEAK),
@@ -230,6 +567,30 @@ namespace vmkit {
 	    ToEnqueue = new gc*[INITIAL_QUEUE_SIZE];
 	    ToEnqueueLength = INITIAL_QUEUE_SIZE;
 	    ToEnqueueIndex = 0;
+	    Buffers = NULL;
+	    Owner = this;
+	    NextWorker = NULL;
+	    NbWorkers = 1;
+	    BatchIndex = 0;
+	    BatchLength = 0;
+	  }
+
+	  /// ReferenceThread - Create a thread helping the owner enqueue
+	  /// references. Its own queues stay empty.
+	  ///
+	  ReferenceThread(vmkit::VirtualMachine* vm, ReferenceThread* owner) :
+	      T_THREAD(vm), WeakReferencesQueue(ReferenceQueue::WEAK),
+	      SoftReferencesQueue(ReferenceQueue::SOFT),
+	      PhantomReferencesQueue(ReferenceQueue::PHANTOM) {
+	    ToEnqueue = NULL;
+	    ToEnqueueLength = 0;
+	    ToEnqueueIndex = 0;
+	    Buffers = NULL;
+	    Owner = owner;
+	    NextWorker = NULL;
+	    NbWorkers = 1;
+	    BatchIndex = 0;
+	    BatchLength = 0;
 	  }
 
 	  ~ReferenceThread() {
@@ -11,10 +11,13 @@
 #define VMKIT_SYSTEM_H
 
 #include <csetjmp>
+#include <cstdlib>
 #include <cstring>
 #include <dlfcn.h>
 #include <signal.h>
 #include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #if defined(__linux__) || defined(__FreeBSD__)
@@ -60,16 +63,32 @@ namespace vmkit {
 const int kWordSize = sizeof(word_t);
 const int kWordSizeLog2 = kWordSize == 4 ? 2 : 3;
 
+// kThreadIDMask is the mask of the smallest stack size. Larger stacks,
+// set at startup, use the mask returned by System::GetThreadIDMask.
+// kThreadMemorySize is the size of the address range that can be reserved
+// for stacks, starting at kThreadStart.
 #if ARCH_X64
 const word_t kThreadStart   = 0x0000000110000000LL;
 const word_t kThreadIDMask  = 0xFFFFFFFFFFF00000LL;
 const word_t kVmkitThreadMask = 0xFFFFFFFFF0000000LL;
+const word_t kThreadMemorySize = 0x1000000000LL;
 #else
 const word_t kThreadStart   = 0x10000000;
 const word_t kThreadIDMask  = 0x7FF00000;
 const word_t kVmkitThreadMask = 0xF0000000;
+const word_t kThreadMemorySize = 0x20000000;
 #endif
 
+/// vmkitThreadIDMask - The mask to apply to the stack pointer to get the
+/// Thread object. Depends on the stack size of threads.
+///
+extern "C" word_t vmkitThreadIDMask;
+
+/// vmkitStackOverflowMask - The mask to apply to the stack pointer to check
+/// for stack overflows in Java code. Depends on the stack size of threads.
+///
+extern "C" word_t vmkitStackOverflowMask;
+
 #if MACOS_OS
   #define LONGJMP _longjmp
   #define SETJMP _setjmp
@@ -92,7 +111,15 @@ const word_t kVmkitThreadMask = 0xF0000000;
   const word_t kGCMemoryStart = 0x50000000;
 #endif
 
+// The heap is only reserved at startup: pages are committed when MMTk maps
+// them, so the reservation can be larger than the maximum heap size given
+// with -Xmx. The layout of MMTk spaces is computed from these constants when
+// MMTk is compiled.
+#if ARCH_X64 && !MACOS_OS
+const word_t kGCMemorySize = 0xC0000000LL;
+#else
 const word_t kGCMemorySize = 0x30000000;
+#endif
 
 #define TRY { vmkit::ExceptionBuffer __buffer__; if (!SETJMP(__buffer__.buffer))
 #define CATCH else
@@ -130,7 +157,12 @@ public:
 
   // Apply this mask to the stack pointer to get the Thread object.
   static word_t GetThreadIDMask() {
-    return kThreadIDMask;
+    return vmkitThreadIDMask;
+  }
+
+  // Apply this mask to the stack pointer to check for stack overflows.
+  static word_t GetStackOverflowMask() {
+    return vmkitStackOverflowMask;
   }
 
   // Apply this mask to verify that the current thread was created by vmkit.
@@ -228,14 +260,69 @@ public:
 #endif
   }
 
+  static uint64_t GetTimeMillis() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  }
+
+  static uint64_t GetTimeNanos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+
   static int GetNumberOfProcessors() {
     return sysconf(_SC_NPROCESSORS_ONLN);
   }
 
+  /// SpinPause - Tell the processor that the thread is busy waiting, so that
+  /// it does not flood the memory bus and lets the other hardware thread run.
+  ///
+  static void SpinPause() {
+#if defined(ARCH_X86) || defined(ARCH_X64)
+    __asm__ __volatile__ ("pause" : : : "memory");
+#else
+    __asm__ __volatile__ ("" : : : "memory");
+#endif
+  }
+
   static void Exit(int value) {
     _exit(value);
   }
 
+  /// ParseSize - Parse a size of the form <n>[kKmMgG]. Returns 0 if the size
+  /// is invalid.
+  ///
+  static word_t ParseSize(const char* value) {
+    char* end = NULL;
+    word_t size = strtoull(value, &end, 10);
+    if (end == value) return 0;
+    switch (*end) {
+      case 'g': case 'G': size <<= 10;
+      case 'm': case 'M': size <<= 10;
+      case 'k': case 'K': size <<= 10; ++end;
+      default: break;
+    }
+    return (*end == 0) ? size : 0;
+  }
+
+  /// NextVMOption - Return the index of the VM option following the one at
+  /// index i of the command line, or argc if there is none. Start with i
+  /// equal to 0. The values of -cp and -classpath are skipped, and the main
+  /// class or -jar end the options of the VM, as in the argument parser of
+  /// the VM.
+  ///
+  static int NextVMOption(int argc, char** argv, int i) {
+    if (i > 0) {
+      if (!strcmp(argv[i], "-jar")) return argc;
+      if (!strcmp(argv[i], "-cp") || !strcmp(argv[i], "-classpath")) ++i;
+    }
+    ++i;
+    if (i >= argc || argv[i][0] != '-') return argc;
+    return i;
+  }
+
   static bool SupportsHardwareNullCheck();
   static bool SupportsHardwareStackOverflow();
 };
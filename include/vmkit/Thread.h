@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <stdlib.h>
 
 #include "debug.h"
@@ -117,6 +118,7 @@ public:
   Thread() {
     lastExceptionBuffer = 0;
     lastKnownFrame = 0;
+    memset(frameInfoIPs, 0, sizeof(frameInfoIPs));
   }
 
   /// yield - Yield the processor to another thread.
@@ -202,7 +204,17 @@ public:
   /// a tracer.
   ///
   virtual void tracer(word_t closure) {}
+
+  /// scanStack - Report the roots of the stack of this thread. Uses the roots
+  /// recorded by recordStackRoots if any.
+  ///
   void scanStack(word_t closure);
+
+  /// recordStackRoots - Record the addresses of the roots of the stack of
+  /// this thread, so that a collector scanning the stack does not have to
+  /// walk it. Called by the thread itself before it blocks for a collection.
+  ///
+  void recordStackRoots() __attribute__ ((noinline));
   
   word_t getLastSP() { return lastSP; }
   void  setLastSP(word_t V) { lastSP = V; }
@@ -224,22 +236,26 @@ public:
 
   bool isVmkitThread() const {
     if (!baseAddr) return false;
-    else return (((word_t)this) & System::GetVmkitThreadMask()) == baseAddr;
+    else return ((word_t)this - baseAddr) < (endAddr - baseAddr);
   }
 
   /// baseAddr - The base address for all threads.
   static word_t baseAddr;
 
-  /// OverflowMask - Apply this mask to implement overflow checks. For
-  /// efficiency, we lower the available size of the stack: it can never go
-  /// under 0xC0000
+  /// endAddr - The end of the memory reserved for threads.
+  static word_t endAddr;
+
+  /// initialise - Set the stack size and the maximum number of threads from
+  /// the -Xss and -Xmax-threads options. Must be called before creating
+  /// threads and compilers, which embed the mask of the stack size.
   ///
-  static const uint64_t StackOverflowMask = 0xC0000;
+  static void initialise(int argc, char** argv);
 
-  /// stackOverflow - Returns if there is a stack overflow in Java land.
+  /// stackOverflow - Returns if there is a stack overflow in Java land. For
+  /// efficiency, we lower the available size of the stack by 256KB.
   ///
   bool stackOverflow() {
-    return (System::GetCallerAddress() & StackOverflowMask) == 0;
+    return (System::GetCallerAddress() & System::GetStackOverflowMask()) == 0;
   }
 
   /// operator new - Allocate the Thread object as well as the stack for this
@@ -276,6 +292,40 @@ public:
   ///
   ExceptionBuffer* lastExceptionBuffer;
 
+  /// FrameInfoCacheSize - Number of entries of the FrameInfo cache.
+  ///
+  static const uint32_t FrameInfoCacheSize = 16;
+
+  /// frameInfoIPs - The return addresses cached in frameInfos. The cache is
+  /// only used by this thread, so it needs no synchronization.
+  ///
+  word_t frameInfoIPs[FrameInfoCacheSize];
+
+  /// frameInfos - The FrameInfos of the return addresses in frameInfoIPs.
+  ///
+  FrameInfo* frameInfos[FrameInfoCacheSize];
+
+  /// rootSlots - The addresses of the roots recorded by recordStackRoots.
+  ///
+  word_t* rootSlots;
+
+  /// nbRootSlots - The number of roots in rootSlots.
+  ///
+  uint32_t nbRootSlots;
+
+  /// rootSlotsCapacity - The number of roots rootSlots can hold.
+  ///
+  uint32_t rootSlotsCapacity;
+
+  /// rootSlotsReady - Are the recorded roots the current roots of the stack?
+  ///
+  bool rootSlotsReady;
+
+  /// IPToFrameInfo - Get the FrameInfo of a return address in the given VM,
+  /// looking first in the cache of this thread.
+  ///
+  FrameInfo* IPToFrameInfo(VirtualMachine* vm, word_t ip);
+
   void internalThrowException();
 
   void startKnownFrame(KnownFrame& F) __attribute__ ((noinline));
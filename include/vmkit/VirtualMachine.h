@@ -30,13 +30,40 @@ class Frames;
 
 class FunctionMap {
 public:
-  /// Functions - Map of applicative methods to function pointers. This map is
-  /// used when walking the stack so that VMKit knows which applicative method
-  /// is executing on the stack.
+  /// FrameInfoTable - An open addressing hash table from return addresses to
+  /// FrameInfos. Entries are never removed, and a table is never modified
+  /// once a bigger table replaces it, so lookups need no lock.
   ///
-  llvm::DenseMap<word_t, FrameInfo*> Functions;
+  class FrameInfoTable {
+  public:
+    /// size - Number of entries of the table, a power of two.
+    ///
+    uint32_t size;
+
+    /// count - Number of used entries.
+    ///
+    uint32_t count;
+
+    /// IPs - The keys of the table. Zero for an empty entry.
+    ///
+    word_t* IPs;
+
+    /// Infos - The FrameInfos of the return addresses in IPs.
+    ///
+    FrameInfo** Infos;
+  };
+
+  /// Table - The current table. Replaced by a bigger one when it gets half
+  /// full. Old tables stay allocated, as a thread may still be reading them.
+  ///
+  FrameInfoTable* volatile Table;
+
+  /// allocator - The allocator of the tables.
+  ///
+  BumpPtrAllocator& allocator;
 
-  /// FunctionMapLock - Spin lock to protect the Functions map.
+  /// FunctionMapLock - Spin lock to serialize the writers of the table.
+  /// Readers do not take it.
   ///
   vmkit::SpinLock FunctionMapLock;
 
@@ -47,13 +74,29 @@ public:
   /// addFrameInfo - A new instruction pointer in the function map.
   ///
   void addFrameInfo(word_t ip, FrameInfo* meth);
-  void addFrameInfoNoLock(word_t ip, FrameInfo* meth) {
-    Functions[ip] = meth;
-  }
+  void addFrameInfoNoLock(word_t ip, FrameInfo* meth);
+
   /// removeFrameInfos - Remove all FrameInfo owned by the given owner.
   void removeFrameInfos(void* owner) {} /* TODO */
 
   FunctionMap(BumpPtrAllocator& allocator, CompiledFrames** frames);
+
+private:
+  /// newTable - Allocate an empty table of the given size.
+  ///
+  FrameInfoTable* newTable(uint32_t size);
+
+  /// insert - Insert or replace an entry in the table. Readers see either
+  /// the old entry or the complete new one.
+  ///
+  static void insert(FrameInfoTable* table, word_t ip, FrameInfo* meth);
+
+  /// hash - The index of an instruction pointer in a table of the given size.
+  ///
+  static uint32_t hash(word_t ip, uint32_t size) {
+    uint32_t h = (uint32_t)(ip >> 2) * 2654435761U;
+    return (h ^ (h >> 16)) & (size - 1);
+  }
 };
 
 /// VirtualMachine - This class is the root of virtual machine classes. It
@@ -67,6 +110,14 @@ protected:
     numberOfThreads = 0;
     doExit = false;
     exitingThread = NULL;
+    criticalCount = 0;
+    criticalWaiting = false;
+    softReferenceMSPerMB = 1000;
+    softReferenceFreeMemory = ~(size_t)0;
+    softReferencesKept = 0;
+    softReferencesCleared = 0;
+    arrayScanNanos = 0;
+    arrayChunksScanned = 0;
   }
 
   virtual ~VirtualMachine() {
@@ -196,10 +247,22 @@ public:
   ///
   virtual void tracer(word_t closure) {}
 
+  /// staticRootsTracer - Trace the roots that the VM stores with the non-heap
+  /// write barrier, such as static fields. Generational collections trace
+  /// them only when they trace the whole heap.
+  ///
+  virtual void staticRootsTracer(word_t closure) {}
+
   /// traceObject - Method called during GC to trace live objects graph.
   ///
   virtual void traceObject(gc* object, word_t closure) = 0;
 
+  /// traceArrayChunk - Method called during GC to trace a chunk of a large
+  /// array, which the tracer of the array gave to the collector with
+  /// Collector::pushArrayChunk.
+  ///
+  virtual void traceArrayChunk(gc* array, uint32_t start, word_t closure) = 0;
+
   /// setType - Method called when allocating an object. The VirtualMachine has to
   /// set the identity of the object (identity is determined by user).
   ///
@@ -223,6 +286,64 @@ public:
   ///
   CooperativeCollectionRV rendezvous;
 
+  /// softReferenceMSPerMB - How long, in milliseconds per MB of free memory,
+  /// a soft referent not otherwise reachable is kept after its last access.
+  /// Set with -Xsoftref-ms-per-mb:<n>.
+  ///
+  uint64_t softReferenceMSPerMB;
+
+  /// softReferenceFreeMemory - The free memory after the last collection, or
+  /// ~0 before the first one.
+  ///
+  size_t softReferenceFreeMemory;
+
+  /// softReferencesKept, softReferencesCleared - The number of soft referents
+  /// not otherwise reachable that collections kept and cleared.
+  ///
+  uint64_t softReferencesKept;
+  uint64_t softReferencesCleared;
+
+  /// arrayScanNanos, arrayChunksScanned - The time spent scanning reference
+  /// arrays and the number of chunks of large arrays scanned during the
+  /// current collection. Only counted with -verbose:gc.
+  ///
+  uint64_t arrayScanNanos;
+  uint64_t arrayChunksScanned;
+
+  /// criticalCount - The number of critical regions entered and not left
+  /// yet. Objects used in a critical region must not move, so collections
+  /// wait for the count to drop to zero.
+  ///
+  uint32_t criticalCount;
+
+  /// criticalWaiting - Is a thread waiting for the critical regions to end?
+  ///
+  bool criticalWaiting;
+
+  /// criticalLock, criticalCond - Wake up the threads waiting for the
+  /// critical regions to end.
+  ///
+  vmkit::LockNormal criticalLock;
+  vmkit::Cond criticalCond;
+
+  /// enterCriticalRegion - Prevent collections from moving objects until
+  /// the matching leaveCriticalRegion. Must be called in cooperative code, so
+  /// that no collection is running. A thread in a critical region must not
+  /// allocate.
+  ///
+  void enterCriticalRegion() {
+    __sync_add_and_fetch(&criticalCount, 1);
+  }
+
+  /// leaveCriticalRegion - Leave a critical region, and wake up the threads
+  /// waiting to collect if it was the last one.
+  ///
+  void leaveCriticalRegion();
+
+  /// waitForCriticalRegions - Wait until no thread is in a critical region.
+  ///
+  void waitForCriticalRegions();
+
 //===----------------------------------------------------------------------===//
 // (2.5) GC-DEBUG-related methods.
 //===----------------------------------------------------------------------===//
@@ -286,6 +407,12 @@ public:
   /// setObjectReferent - set the referent of an object
   ///
   virtual void setObjectReferent(gc* _obj, gc* val) {}
+
+  /// getObjectReferenceTimestamp - Return the time in milliseconds of the
+  /// last access to the referent of a soft reference, as recorded in the
+  /// reference by the class library, or 0 if it is not recorded there.
+  ///
+  virtual uint64_t getObjectReferenceTimestamp(gc* _obj) { return 0; }
 };
 
 
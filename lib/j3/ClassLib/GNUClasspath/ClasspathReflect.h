@@ -295,6 +295,16 @@ public:
     // No write barrier: this is only called by the GC.
     self->referent = r;
   }
+
+  /// getTimestamp - GNU Classpath's SoftReference has no timestamp field.
+  /// Accesses are logged by the native SoftReference.get instead.
+  ///
+  static uint64_t getTimestamp(Jnjvm* vm, JavaObjectReference* self) {
+    llvm_gcroot(self, 0);
+    return 0;
+  }
+
+  static void setClock(Jnjvm* vm, uint64_t now) {}
 };
 
 }
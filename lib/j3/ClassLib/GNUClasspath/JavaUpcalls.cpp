@@ -100,6 +100,7 @@ JavaMethod* Classpath::initVMThrowable;
 JavaField*  Classpath::vmDataVMThrowable;
 Class*      Classpath::newVMThrowable;
 JavaField*  Classpath::bufferAddress;
+JavaField*  Classpath::bufferCapacity;
 JavaField*  Classpath::dataPointer32;
 JavaField*  Classpath::dataPointer64;
 Class*      Classpath::newPointer32;
@@ -307,13 +308,19 @@ void Classpath::InitializeThreading(Jnjvm* vm) {
   systemName = vm->asciizToStr("system");
   groupName->setInstanceObjectField(SystemGroup, systemName);
 
-  // Create the finalizer thread.
+  // Create the finalizer threads.
   assert(vm->getFinalizerThread() && "VM did not set its finalizer thread");
-  CreateJavaThread(vm, vm->getFinalizerThread(), "Finalizer", SystemGroup);
+  for (vmkit::FinalizerThread<JavaThread>* th = vm->getFinalizerThread();
+       th != NULL; th = th->NextWorker) {
+    CreateJavaThread(vm, th, "Finalizer", SystemGroup);
+  }
   
-  // Create the enqueue thread.
+  // Create the enqueue threads.
   assert(vm->getReferenceThread() && "VM did not set its enqueue thread");
-  CreateJavaThread(vm, vm->getReferenceThread(), "Reference", SystemGroup);
+  for (vmkit::ReferenceThread<JavaThread>* th = vm->getReferenceThread();
+       th != NULL; th = th->NextWorker) {
+    CreateJavaThread(vm, th, "Reference", SystemGroup);
+  }
 }
 
 extern "C" void Java_java_lang_ref_WeakReference__0003Cinit_0003E__Ljava_lang_Object_2(
@@ -324,7 +331,9 @@ extern "C" void Java_java_lang_ref_WeakReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
   
   JavaObjectReference::init(reference, referent, 0);
-  JavaThread::get()->getJVM()->getReferenceThread()->addWeakReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addWeakReference(reference,
+      &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 
@@ -341,7 +350,9 @@ extern "C" void Java_java_lang_ref_WeakReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
   
   JavaObjectReference::init(reference, referent, queue);
-  JavaThread::get()->getJVM()->getReferenceThread()->addWeakReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addWeakReference(reference,
+      &th->referenceBuffer);
   
   END_NATIVE_EXCEPTION
 
@@ -355,7 +366,9 @@ extern "C" void Java_java_lang_ref_SoftReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
   
   JavaObjectReference::init(reference, referent, 0);
-  JavaThread::get()->getJVM()->getReferenceThread()->addSoftReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addSoftReference(reference,
+      &th->referenceBuffer);
   
   END_NATIVE_EXCEPTION
 
@@ -372,12 +385,35 @@ extern "C" void Java_java_lang_ref_SoftReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
 
   JavaObjectReference::init(reference, referent, queue);
-  JavaThread::get()->getJVM()->getReferenceThread()->addSoftReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addSoftReference(reference,
+      &th->referenceBuffer);
   
   END_NATIVE_EXCEPTION
 
 }
 
+extern "C" JavaObject* Java_java_lang_ref_SoftReference_get__(
+    JavaObjectReference* reference) {
+  JavaObject* res = NULL;
+  llvm_gcroot(reference, 0);
+  llvm_gcroot(res, 0);
+
+  BEGIN_NATIVE_EXCEPTION(0)
+
+  // Record the access, so that the referent is kept while memory allows.
+  res = *JavaObjectReference::getReferentPtr(reference);
+  if (res != NULL) {
+    JavaThread* th = JavaThread::get();
+    th->getJVM()->getReferenceThread()->touchSoftReference(reference,
+        &th->referenceBuffer);
+  }
+
+  END_NATIVE_EXCEPTION
+
+  return res;
+}
+
 extern "C" void Java_java_lang_ref_PhantomReference__0003Cinit_0003E__Ljava_lang_Object_2Ljava_lang_ref_ReferenceQueue_2(
     JavaObjectReference* reference,
     JavaObject* referent,
@@ -389,7 +425,9 @@ extern "C" void Java_java_lang_ref_PhantomReference__0003Cinit_0003E__Ljava_lang
   BEGIN_NATIVE_EXCEPTION(0)
   
   JavaObjectReference::init(reference, referent, queue);
-  JavaThread::get()->getJVM()->getReferenceThread()->addPhantomReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addPhantomReference(reference,
+      &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 }
@@ -734,6 +772,9 @@ void Classpath::initialiseClasspath(JnjvmClassLoader* loader) {
     UPCALL_FIELD(loader, "java/nio/Buffer", "address", "Lgnu/classpath/Pointer;",
                  ACC_VIRTUAL);
 
+  bufferCapacity =
+    UPCALL_FIELD(loader, "java/nio/Buffer", "cap", "I", ACC_VIRTUAL);
+
   dataPointer32 =
     UPCALL_FIELD(loader, "gnu/classpath/Pointer32", "data", "I", ACC_VIRTUAL);
   
@@ -1137,6 +1178,11 @@ void Classpath::initialiseClasspath(JnjvmClassLoader* loader) {
                   "(Ljava/lang/Object;Ljava/lang/ref/ReferenceQueue;)V",
                   ACC_VIRTUAL);
   initSoftReference->setNative();
+
+  JavaMethod* getSoftReference =
+    UPCALL_METHOD(loader, "java/lang/ref/SoftReference", "get",
+                  "()Ljava/lang/Object;", ACC_VIRTUAL);
+  getSoftReference->setNative();
   
   JavaMethod* initPhantomReference =
     UPCALL_METHOD(loader, "java/lang/ref/PhantomReference", "<init>",
@@ -1163,6 +1209,7 @@ void Classpath::InitializeSystem(Jnjvm * jvm) {
 #include "ClasspathVMClassLoader.inc"
 #include "ClasspathVMObject.inc"
 #include "ClasspathVMRuntime.inc"
+#include "ClasspathVMManagement.inc"
 #include "ClasspathVMStackWalker.inc"
 #include "ClasspathVMSystem.inc"
 #include "ClasspathVMSystemProperties.inc"
@@ -112,6 +112,7 @@ public:
   ISOLATE_STATIC JavaField*  vmDataVMThrowable;
   ISOLATE_STATIC UserClass*  newVMThrowable;
   ISOLATE_STATIC JavaField*  bufferAddress;
+  ISOLATE_STATIC JavaField*  bufferCapacity;
   ISOLATE_STATIC JavaField*  dataPointer32;
   ISOLATE_STATIC JavaField*  dataPointer64;
   ISOLATE_STATIC UserClass*  newPointer32;
@@ -357,6 +357,21 @@ public:
     // No write barrier: this is only called by the GC.
     self->referent = r;
   }
+
+  /// getTimestamp - The value of SoftReference.clock when the referent of a
+  /// soft reference was last accessed. SoftReference.get updates it.
+  ///
+  static uint64_t getTimestamp(Jnjvm* vm, JavaObjectReference* self) {
+    llvm_gcroot(self, 0);
+    return vm->upcalls->SoftReferenceTimestamp->getInstanceLongField(self);
+  }
+
+  /// setClock - Set SoftReference.clock, the time of the last collection.
+  ///
+  static void setClock(Jnjvm* vm, uint64_t now) {
+    JavaField* field = vm->upcalls->SoftReferenceClock;
+    if (field->classDef->isReady()) field->setStaticLongField(now);
+  }
 };
 
 }
@@ -95,6 +95,7 @@ JavaField*  Classpath::fieldSlot;
 ClassArray* Classpath::classArrayClass;
 JavaMethod* Classpath::loadInClassLoader;
 JavaField*  Classpath::bufferAddress;
+JavaField*  Classpath::bufferCapacity;
 Class*      Classpath::newDirectByteBuffer;
 JavaField*  Classpath::vmdataClassLoader;
 JavaMethod* Classpath::InitDirectByteBuffer;
@@ -242,6 +243,8 @@ JavaField* Classpath::constantPoolOop;
 JavaMethod* Classpath::EnqueueReference;
 Class*      Classpath::newReference;
 JavaField*  Classpath::NullRefQueue;
+JavaField*  Classpath::SoftReferenceTimestamp;
+JavaField*  Classpath::SoftReferenceClock;
 JavaField*  Classpath::RefLock;
 Class*      Classpath::newRefLock;
 JavaField*  Classpath::RefPending;
@@ -330,13 +333,19 @@ void Classpath::InitializeThreading(Jnjvm* vm) {
   assert(vm->getMainThread() && "VM did not set its main thread");
   CreateJavaThread(vm, (JavaThread*)vm->getMainThread(), "main", MainGroup);
 
-  // Create the finalizer thread.
+  // Create the finalizer threads.
   assert(vm->getFinalizerThread() && "VM did not set its finalizer thread");
-  CreateJavaThread(vm, vm->getFinalizerThread(), "Finalizer", SystemGroup);
+  for (vmkit::FinalizerThread<JavaThread>* th = vm->getFinalizerThread();
+       th != NULL; th = th->NextWorker) {
+    CreateJavaThread(vm, th, "Finalizer", SystemGroup);
+  }
 
-  // Create the enqueue thread.
+  // Create the enqueue threads.
   assert(vm->getReferenceThread() && "VM did not set its enqueue thread");
-  CreateJavaThread(vm, vm->getReferenceThread(), "Reference", SystemGroup);
+  for (vmkit::ReferenceThread<JavaThread>* th = vm->getReferenceThread();
+       th != NULL; th = th->NextWorker) {
+    CreateJavaThread(vm, th, "Reference", SystemGroup);
+  }
 
   // Create the ReferenceHandler thread.
   RefHandler = RefHandlerClass->doNew(vm);
@@ -356,7 +365,9 @@ extern "C" void Java_java_lang_ref_WeakReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
 
   JavaObjectReference::init(reference, referent, 0);
-  JavaThread::get()->getJVM()->getReferenceThread()->addWeakReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addWeakReference(reference,
+      &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 
@@ -373,7 +384,9 @@ extern "C" void Java_java_lang_ref_WeakReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
 
   JavaObjectReference::init(reference, referent, queue);
-  JavaThread::get()->getJVM()->getReferenceThread()->addWeakReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addWeakReference(reference,
+      &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 
@@ -387,7 +400,12 @@ extern "C" void Java_java_lang_ref_SoftReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
 
   JavaObjectReference::init(reference, referent, 0);
-  JavaThread::get()->getJVM()->getReferenceThread()->addSoftReference(reference);
+  JavaThread* th = JavaThread::get();
+  Jnjvm* vm = th->getJVM();
+  // As the constructor of SoftReference does.
+  vm->upcalls->SoftReferenceTimestamp->setInstanceLongField(reference,
+      vm->upcalls->SoftReferenceClock->getStaticLongField());
+  vm->getReferenceThread()->addSoftReference(reference, &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 
@@ -404,7 +422,12 @@ extern "C" void Java_java_lang_ref_SoftReference__0003Cinit_0003E__Ljava_lang_Ob
   BEGIN_NATIVE_EXCEPTION(0)
 
   JavaObjectReference::init(reference, referent, queue);
-  JavaThread::get()->getJVM()->getReferenceThread()->addSoftReference(reference);
+  JavaThread* th = JavaThread::get();
+  Jnjvm* vm = th->getJVM();
+  // As the constructor of SoftReference does.
+  vm->upcalls->SoftReferenceTimestamp->setInstanceLongField(reference,
+      vm->upcalls->SoftReferenceClock->getStaticLongField());
+  vm->getReferenceThread()->addSoftReference(reference, &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 
@@ -421,7 +444,9 @@ extern "C" void Java_java_lang_ref_PhantomReference__0003Cinit_0003E__Ljava_lang
   BEGIN_NATIVE_EXCEPTION(0)
 
   JavaObjectReference::init(reference, referent, queue);
-  JavaThread::get()->getJVM()->getReferenceThread()->addPhantomReference(reference);
+  JavaThread* th = JavaThread::get();
+  th->getJVM()->getReferenceThread()->addPhantomReference(reference,
+      &th->referenceBuffer);
 
   END_NATIVE_EXCEPTION
 }
@@ -631,6 +656,9 @@ void Classpath::initialiseClasspath(JnjvmClassLoader* loader) {
     UPCALL_FIELD(loader, "java/nio/Buffer", "address", "J",
                  ACC_VIRTUAL);
 
+  bufferCapacity =
+    UPCALL_FIELD(loader, "java/nio/Buffer", "capacity", "I", ACC_VIRTUAL);
+
   vmdataClassLoader =
     UPCALL_FIELD(loader, "java/lang/ClassLoader", "classes", "Ljava/util/Vector;",
                  ACC_VIRTUAL);
@@ -975,6 +1003,14 @@ void Classpath::initialiseClasspath(JnjvmClassLoader* loader) {
     UPCALL_FIELD(loader, "java/lang/ref/ReferenceQueue",
         "NULL", "Ljava/lang/ref/ReferenceQueue;", ACC_STATIC);
 
+  SoftReferenceTimestamp =
+    UPCALL_FIELD(loader, "java/lang/ref/SoftReference",
+        "timestamp", "J", ACC_VIRTUAL);
+
+  SoftReferenceClock =
+    UPCALL_FIELD(loader, "java/lang/ref/SoftReference",
+        "clock", "J", ACC_STATIC);
+
   JavaMethod* initWeakReference =
     UPCALL_METHOD(loader, "java/lang/ref/WeakReference", "<init>",
                   "(Ljava/lang/Object;)V",
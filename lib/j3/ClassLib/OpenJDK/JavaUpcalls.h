@@ -111,6 +111,7 @@ public:
   ISOLATE_STATIC UserClassArray* classArrayClass;
   ISOLATE_STATIC JavaMethod* loadInClassLoader;
   ISOLATE_STATIC JavaField*  bufferAddress;
+  ISOLATE_STATIC JavaField*  bufferCapacity;
   ISOLATE_STATIC UserClass*  newDirectByteBuffer;
   ISOLATE_STATIC JavaMethod* InitDirectByteBuffer;
   ISOLATE_STATIC JavaField*  vmdataClassLoader;
@@ -279,6 +280,8 @@ public:
   ISOLATE_STATIC JavaMethod* EnqueueReference;
   ISOLATE_STATIC UserClass*  newReference;
   ISOLATE_STATIC JavaField*  NullRefQueue;
+  ISOLATE_STATIC JavaField*  SoftReferenceTimestamp;
+  ISOLATE_STATIC JavaField*  SoftReferenceClock;
   ISOLATE_STATIC JavaField*  RefLock;
   ISOLATE_STATIC UserClass*  newRefLock;
   ISOLATE_STATIC JavaField*  RefPending;
@@ -159,6 +159,13 @@ void J3Intrinsics::init(llvm::Module* module) {
   OffsetStatusInTaskClassMirrorConstant = constantZero;
   OffsetInitializedInTaskClassMirrorConstant = constantOne;
   
+  OffsetCodeInMethodConstant =            ConstantInt::get(Type::getInt32Ty(Context), 8);
+  OffsetInvocationCountInMethodConstant = ConstantInt::get(Type::getInt32Ty(Context), 10);
+  OffsetBackEdgeCountInMethodConstant =   ConstantInt::get(Type::getInt32Ty(Context), 11);
+  OffsetTierInMethodConstant =            ConstantInt::get(Type::getInt32Ty(Context), 12);
+  OptimizedTierConstant = ConstantInt::get(Type::getInt8Ty(Context),
+                                           JavaMethod::OptimizedTier);
+
   OffsetIsolateIDInThreadConstant =         ConstantInt::get(Type::getInt32Ty(Context), 1);
   OffsetVMInThreadConstant =                ConstantInt::get(Type::getInt32Ty(Context), 2);
   OffsetDoYieldInThreadConstant =           ConstantInt::get(Type::getInt32Ty(Context), 4);
@@ -213,6 +220,7 @@ void J3Intrinsics::init(llvm::Module* module) {
   ResolveStaticStubFunction = module->getFunction("j3ResolveStaticStub");
   ResolveSpecialStubFunction = module->getFunction("j3ResolveSpecialStub");
   ResolveInterfaceFunction = module->getFunction("j3ResolveInterface");
+  HotMethodFunction = module->getFunction("j3HotMethod");
   
   NullPointerExceptionFunction =
     module->getFunction("j3NullPointerException");
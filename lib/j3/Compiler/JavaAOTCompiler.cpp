@@ -279,15 +279,18 @@ Constant* JavaAOTCompiler::getClassBytes(const UTF8* className, ClassBytes* byte
   std::vector<Type*> Elemts;
   ArrayType* ATy = ArrayType::get(Type::getInt8Ty(getLLVMContext()), bytes->size);
   Elemts.push_back(Type::getInt32Ty(getLLVMContext()));
+  Elemts.push_back(PointerType::getUnqual(Type::getInt8Ty(getLLVMContext())));
   Elemts.push_back(ATy);
   StructType* STy = StructType::get(getLLVMContext(), Elemts);
 
   std::string name(UTF8Buffer(className).toCompileName("_bytes")->cString());
-  Constant* C = emitClassBytes ? CreateConstantFromClassBytes(bytes) : NULL;
   GlobalVariable* varGV = new GlobalVariable(*getLLVMModule(), STy, false,
                                              GlobalValue::ExternalLinkage,
-                                             C, name);
+                                             NULL, name);
   classBytes[bytes] = varGV;
+  if (emitClassBytes) {
+    varGV->setInitializer(CreateConstantFromClassBytes(bytes, varGV));
+  }
   return varGV;
 }
 
@@ -1033,6 +1036,21 @@ Constant* JavaAOTCompiler::CreateConstantFromJavaMethod(JavaMethod& method) {
   // offset
   MethodElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), method.offset));
 
+  // invocationCount
+  MethodElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), 0));
+
+  // backEdgeCount
+  MethodElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), 0));
+
+  // tier: precompiled code is already optimized. Methods without code are
+  // compiled at runtime, at the baseline tier.
+  uint8 tier = (getMethodInfo(&method)->methodFunction == NULL) ?
+      JavaMethod::BaselineTier : JavaMethod::OptimizedTier;
+  MethodElts.push_back(ConstantInt::get(Type::getInt8Ty(getLLVMContext()), tier));
+
+  // codeSlots
+  MethodElts.push_back(Constant::getNullValue(JavaIntrinsics.ptrType));
+
   return ConstantStruct::get(STy, MethodElts); 
 }
 
@@ -1393,19 +1411,32 @@ Constant* JavaAOTCompiler::CreateConstantFromClass(Class* cl) {
   // minJDKVersionBuild
   ClassElts.push_back(ConstantInt::get(Type::getInt16Ty(getLLVMContext()), cl->minJDKVersionBuild));
 
+  // memberIndex, built at runtime.
+  ClassElts.push_back(Constant::getNullValue(JavaIntrinsics.ptrType));
+
+  // referenceOffsets, nbReferenceOffsets and referenceBitmap. Precompiled
+  // classes keep the regular tracer, which does not use them.
+  ClassElts.push_back(Constant::getNullValue(
+      STy->getContainedType(ClassElts.size())));
+  ClassElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), 0));
+  ClassElts.push_back(ConstantInt::get(Type::getInt64Ty(getLLVMContext()), 0));
+
   return ConstantStruct::get(STy, ClassElts);
 }
 
-Constant* JavaAOTCompiler::CreateConstantFromClassBytes(ClassBytes* bytes) {
-  std::vector<Type*> Elemts;
-  ArrayType* ATy = ArrayType::get(Type::getInt8Ty(getLLVMContext()), bytes->size);
-  Elemts.push_back(Type::getInt32Ty(getLLVMContext()));
-  Elemts.push_back(ATy);
-
-  StructType* STy = StructType::get(getLLVMContext(), Elemts);
+Constant* JavaAOTCompiler::CreateConstantFromClassBytes(ClassBytes* bytes,
+                                                        GlobalVariable* varGV) {
+  StructType* STy = dyn_cast<StructType>(varGV->getType()->getContainedType(0));
+  ArrayType* ATy = dyn_cast<ArrayType>(STy->getContainedType(2));
   
   std::vector<Constant*> Cts;
   Cts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), bytes->size));
+
+  // The elements pointer points to the bytes that follow it in the global.
+  Constant* GEPs[3] = { getIntrinsics()->constantZero,
+                        getIntrinsics()->constantTwo,
+                        getIntrinsics()->constantZero };
+  Cts.push_back(ConstantExpr::getGetElementPtr(varGV, GEPs, 3));
   
   std::vector<Constant*> Vals;
   for (uint32 i = 0; i < bytes->size; ++i) {
@@ -2095,9 +2126,8 @@ void extractFiles(ClassBytes* bytes,
    
   vmkit::BumpPtrAllocator allocator; 
   char* realName = (char*)allocator.Allocate(4096, "temp");
-  for (ZipArchive::table_iterator i = archive.filetable.begin(), 
-       e = archive.filetable.end(); i != e; ++i) {
-    ZipFile* file = i->second;
+  for (uint32 i = 0; i < archive.nbFiles; ++i) {
+    ZipFile* file = archive.files[i];
      
     char* name = file->filename;
     uint32 size = strlen(name);
@@ -2160,7 +2190,7 @@ void mainCompilerStart(JavaThread* th) {
       (!strcmp(&name[size - 4], ".jar") || !strcmp(&name[size - 4], ".zip"))) {
   
     std::vector<Class*> classes;
-    ClassBytes* bytes = Reader::openFile(bootstrapLoader, name);
+    ClassBytes* bytes = Reader::openArchive(bootstrapLoader, name);
       
     if (!bytes) {
       fprintf(stderr, "Can't find zip file '%s'.\n", name);
@@ -2458,10 +2488,9 @@ void JavaAOTCompiler::generateClassBytes(JnjvmBootstrapLoader* loader) {
   for (std::vector<ZipArchive*>::iterator i = loader->bootArchives.begin(),
        e = loader->bootArchives.end(); i != e; ++i) {
     ZipArchive* archive = *i;
-    for (ZipArchive::table_iterator zi = archive->filetable.begin(),
-         ze = archive->filetable.end(); zi != ze; zi++) {
+    for (uint32 zi = 0; zi < archive->nbFiles; ++zi) {
       // Remove the '.class'.
-      const char* name = zi->first;
+      const char* name = archive->files[zi]->filename;
       std::string str(name, strlen(name) - strlen(".class"));
       ClassBytes* bytes = Reader::openZip(loader, archive, name);
       getClassBytes(loader->asciizConstructUTF8(str.c_str()), bytes);
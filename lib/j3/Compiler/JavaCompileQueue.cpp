@@ -0,0 +1,184 @@
+//===---- JavaCompileQueue.cpp - Background compilation of methods --------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JavaClass.h"
+#include "JavaThread.h"
+#include "Jnjvm.h"
+
+#include "j3/JavaJITCompiler.h"
+
+#include "JavaCompileQueue.h"
+
+using namespace j3;
+
+JavaCompilerThread::JavaCompilerThread(Jnjvm* vm, JavaCompileQueue* q,
+                                       JavaJITCompiler* c) : JavaThread(vm) {
+  queue = q;
+  compiler = c;
+}
+
+JavaCompileQueue::JavaCompileQueue(Jnjvm* vm, JavaJITCompiler* compiler,
+                                   uint32 nb) {
+  pending = NULL;
+  lastPending = NULL;
+  running = NULL;
+  freeRequests = NULL;
+  nbThreads = nb;
+  threads = new JavaCompilerThread*[nbThreads];
+
+  for (uint32 i = 0; i < nbThreads; ++i) {
+    // Each thread gets its own compiler, hence its own LLVM context, module
+    // and execution engine.
+    JavaJITCompiler* C = (JavaJITCompiler*)compiler->Create(
+        "Compiler thread", compiler->isCompilingGarbageCollector());
+    threads[i] = new JavaCompilerThread(vm, this, C);
+  }
+
+  for (uint32 i = 0; i < nbThreads; ++i) {
+    threads[i]->start((void (*)(vmkit::Thread*))compilerStart);
+  }
+}
+
+bool JavaCompileQueue::isCompilerThread(vmkit::Thread* th) {
+  for (uint32 i = 0; i < nbThreads; ++i) {
+    if (threads[i] == th) return true;
+  }
+  return false;
+}
+
+JavaCompileRequest* JavaCompileQueue::findRequest(JavaMethod* meth,
+                                                  Class* customizeFor) {
+  for (JavaCompileRequest* req = running; req != NULL; req = req->next) {
+    if (req->meth == meth && req->customizeFor == customizeFor &&
+        !req->optimize) {
+      return req;
+    }
+  }
+  for (JavaCompileRequest* req = pending; req != NULL; req = req->next) {
+    if (req->meth == meth && req->customizeFor == customizeFor &&
+        !req->optimize) {
+      return req;
+    }
+  }
+  return NULL;
+}
+
+JavaCompileRequest* JavaCompileQueue::newRequest(JavaMethod* meth,
+                                                 Class* customizeFor) {
+  JavaCompileRequest* req = freeRequests;
+  if (req != NULL) {
+    freeRequests = req->next;
+  } else {
+    req = new JavaCompileRequest();
+  }
+  req->meth = meth;
+  req->customizeFor = customizeFor;
+  req->result = NULL;
+  req->done = false;
+  req->optimize = false;
+  req->waiters = 0;
+  req->next = NULL;
+
+  if (lastPending != NULL) {
+    lastPending->next = req;
+  } else {
+    pending = req;
+  }
+  lastPending = req;
+  return req;
+}
+
+JavaCompileRequest* JavaCompileQueue::takeRequest() {
+  queueLock.lock();
+  while (pending == NULL) {
+    requestCond.wait(&queueLock);
+  }
+  JavaCompileRequest* req = pending;
+  pending = req->next;
+  if (pending == NULL) lastPending = NULL;
+  req->next = running;
+  running = req;
+  queueLock.unlock();
+  return req;
+}
+
+void JavaCompileQueue::finishRequest(JavaCompileRequest* req, void* result) {
+  queueLock.lock();
+  JavaCompileRequest** prev = &running;
+  while (*prev != req) {
+    assert(*prev != NULL && "Request not in the running list");
+    prev = &((*prev)->next);
+  }
+  *prev = req->next;
+  if (req->optimize) {
+    req->next = freeRequests;
+    freeRequests = req;
+  } else {
+    req->next = NULL;
+    req->result = result;
+    req->done = true;
+    doneCond.broadcast();
+  }
+  queueLock.unlock();
+}
+
+void* JavaCompileQueue::compile(JavaMethod* meth, Class* customizeFor) {
+  queueLock.lock();
+  JavaCompileRequest* req = findRequest(meth, customizeFor);
+  if (req == NULL) {
+    req = newRequest(meth, customizeFor);
+    requestCond.signal();
+  }
+  ++req->waiters;
+  while (!req->done) {
+    doneCond.wait(&queueLock);
+  }
+  void* res = req->result;
+  if (--req->waiters == 0) {
+    req->next = freeRequests;
+    freeRequests = req;
+  }
+  queueLock.unlock();
+  return res;
+}
+
+void JavaCompileQueue::optimize(JavaMethod* meth) {
+  queueLock.lock();
+  JavaCompileRequest* req = newRequest(meth, NULL);
+  req->optimize = true;
+  requestCond.signal();
+  queueLock.unlock();
+}
+
+void JavaCompileQueue::compilerStart(JavaCompilerThread* th) {
+  JavaCompileQueue* queue = th->queue;
+
+  while (true) {
+    JavaCompileRequest* req = queue->takeRequest();
+    void* res = NULL;
+
+    JavaMethod* meth = req->meth;
+    if (req->optimize) {
+      TRY {
+        res = th->compiler->recompileMethod(meth);
+      } IGNORE;
+    } else if ((!meth->isCustomizable || req->customizeFor == NULL) &&
+        meth->code != NULL) {
+      // The method may have been compiled by a thread that did not go
+      // through the queue.
+      res = meth->code;
+    } else {
+      TRY {
+        res = th->compiler->compileMethod(meth, req->customizeFor);
+      } IGNORE;
+    }
+
+    queue->finishRequest(req, res);
+  }
+}
@@ -0,0 +1,167 @@
+//===------ JavaCompileQueue.h - Background compilation of methods --------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef J3_COMPILE_QUEUE_H
+#define J3_COMPILE_QUEUE_H
+
+#include "vmkit/Cond.h"
+#include "vmkit/Locks.h"
+
+#include "JavaThread.h"
+
+namespace j3 {
+
+class Class;
+class JavaCompileQueue;
+class JavaJITCompiler;
+class JavaMethod;
+class Jnjvm;
+
+/// JavaCompileRequest - A method waiting to be compiled, or being compiled,
+/// by a compiler thread.
+///
+class JavaCompileRequest {
+public:
+  /// meth - The method to compile.
+  ///
+  JavaMethod* meth;
+
+  /// customizeFor - The class to customize the method for, if any.
+  ///
+  Class* customizeFor;
+
+  /// result - The compiled code, or NULL if the compiler thread failed to
+  /// compile the method.
+  ///
+  void* result;
+
+  /// done - Has a compiler thread finished with this request?
+  ///
+  bool done;
+
+  /// optimize - Is this a request to recompile a hot method with
+  /// optimizations? Nobody waits on the result of such requests.
+  ///
+  bool optimize;
+
+  /// waiters - Number of threads waiting on the result of this request.
+  ///
+  uint32 waiters;
+
+  /// next - The next request in the list this request belongs to.
+  ///
+  JavaCompileRequest* next;
+};
+
+/// JavaCompilerThread - A thread that compiles the methods of the compile
+/// queue with its own compiler, hence its own LLVM context and module.
+///
+class JavaCompilerThread : public JavaThread {
+public:
+  /// compiler - The compiler owned by this thread.
+  ///
+  JavaJITCompiler* compiler;
+
+  /// queue - The queue this thread takes requests from.
+  ///
+  JavaCompileQueue* queue;
+
+  JavaCompilerThread(Jnjvm* vm, JavaCompileQueue* q, JavaJITCompiler* c);
+};
+
+/// JavaCompileQueue - A queue of methods to compile, drained by a pool of
+/// compiler threads. Each compiler thread owns a compiler, so methods of
+/// the queue are compiled in parallel. A thread asking for a method blocks
+/// until the code has been published in the method, other threads keep
+/// running. Two threads asking for the same method share the request.
+///
+class JavaCompileQueue {
+private:
+  /// queueLock - Lock protecting the lists of requests.
+  ///
+  vmkit::LockNormal queueLock;
+
+  /// requestCond - Condition to wake up compiler threads.
+  ///
+  vmkit::Cond requestCond;
+
+  /// doneCond - Condition to wake up threads waiting on a request.
+  ///
+  vmkit::Cond doneCond;
+
+  /// pending - Requests not yet taken by a compiler thread.
+  ///
+  JavaCompileRequest* pending;
+
+  /// lastPending - The last request of the pending list.
+  ///
+  JavaCompileRequest* lastPending;
+
+  /// running - Requests currently compiled by a compiler thread.
+  ///
+  JavaCompileRequest* running;
+
+  /// freeRequests - Requests that can be reused.
+  ///
+  JavaCompileRequest* freeRequests;
+
+  /// threads - The compiler threads.
+  ///
+  JavaCompilerThread** threads;
+
+  /// nbThreads - Number of compiler threads.
+  ///
+  uint32 nbThreads;
+
+  /// findRequest - Find a pending or running request for the method.
+  ///
+  JavaCompileRequest* findRequest(JavaMethod* meth, Class* customizeFor);
+
+  /// newRequest - Get a request for the method, appended to the pending
+  /// list.
+  ///
+  JavaCompileRequest* newRequest(JavaMethod* meth, Class* customizeFor);
+
+  /// takeRequest - Move the first pending request to the running list.
+  /// Blocks if there is no pending request.
+  ///
+  JavaCompileRequest* takeRequest();
+
+  /// finishRequest - Publish the result of a running request.
+  ///
+  void finishRequest(JavaCompileRequest* req, void* result);
+
+public:
+  JavaCompileQueue(Jnjvm* vm, JavaJITCompiler* compiler, uint32 nbThreads);
+
+  /// compile - Ask a compiler thread to compile the method and wait for the
+  /// result. Returns NULL if the compiler thread could not compile the
+  /// method, in which case the caller compiles it itself so that errors are
+  /// reported in its context.
+  ///
+  void* compile(JavaMethod* meth, Class* customizeFor);
+
+  /// optimize - Ask a compiler thread to recompile a hot method with
+  /// optimizations. Does not wait for the result.
+  ///
+  void optimize(JavaMethod* meth);
+
+  /// isCompilerThread - Is the thread one of the compiler threads?
+  /// Compiler threads must not wait on the queue.
+  ///
+  bool isCompilerThread(vmkit::Thread* th);
+
+  /// compilerStart - The main loop of a compiler thread.
+  ///
+  static void compilerStart(JavaCompilerThread* th);
+};
+
+} // end namespace j3
+
+#endif // J3_COMPILE_QUEUE_H
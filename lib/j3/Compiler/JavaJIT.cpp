@@ -94,7 +94,75 @@ void JavaJIT::checkYieldPoint() {
   currentBlock = continueBlock;
 }
 
+void JavaJIT::forwardToOptimizedCode() {
+  Value* M = TheCompiler->getMethodInClass(compilingMethod);
+  Value* GEP[2] = { intrinsics->constantZero,
+                    intrinsics->OffsetTierInMethodConstant };
+  Value* TierPtr = GetElementPtrInst::Create(M, GEP, "tierPtr", currentBlock);
+  Value* Tier = new LoadInst(TierPtr, "tier", currentBlock);
+  Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, Tier,
+                             intrinsics->OptimizedTierConstant, "");
+
+  BasicBlock* forwardBlock = createBasicBlock("forwardToOptimized");
+  BasicBlock* baselineBlock = createBasicBlock("baseline");
+  BranchInst::Create(forwardBlock, baselineBlock, test, currentBlock);
+
+  // The method has been recompiled, but callers may still have the address
+  // of this code: call the optimized code with the same arguments. Nothing
+  // has been acquired yet, so exceptions simply go through this frame.
+  currentBlock = forwardBlock;
+  GEP[1] = intrinsics->OffsetCodeInMethodConstant;
+  Value* CodePtr = GetElementPtrInst::Create(M, GEP, "codePtr", currentBlock);
+  Value* Code = new LoadInst(CodePtr, "code", currentBlock);
+  Code = new BitCastInst(Code, llvmFunction->getType(), "", currentBlock);
+
+  std::vector<Value*> args;
+  for (Function::arg_iterator i = llvmFunction->arg_begin(),
+       e = llvmFunction->arg_end(); i != e; ++i) {
+    args.push_back(i);
+  }
+  Instruction* res = CallInst::Create(Code, args, "", currentBlock);
+  res->setDebugLoc(CreateLocation());
+  if (res->getType()->isVoidTy()) {
+    ReturnInst::Create(*llvmContext, currentBlock);
+  } else {
+    ReturnInst::Create(*llvmContext, res, currentBlock);
+  }
+
+  currentBlock = baselineBlock;
+}
+
+void JavaJIT::incrementCounter(Constant* counterOffset) {
+  Value* M = TheCompiler->getMethodInClass(compilingMethod);
+  Value* GEP[2] = { intrinsics->constantZero, counterOffset };
+  Value* CounterPtr =
+    GetElementPtrInst::Create(M, GEP, "counterPtr", currentBlock);
+
+  // Updates are racy: losing a few counts does not matter.
+  Value* Count = new LoadInst(CounterPtr, "count", currentBlock);
+  Count = BinaryOperator::CreateAdd(Count, intrinsics->constantOne, "",
+                                    currentBlock);
+  new StoreInst(Count, CounterPtr, currentBlock);
+
+  Value* Threshold = ConstantInt::get(Type::getInt32Ty(*llvmContext),
+                                      TheCompiler->getHotThreshold());
+  Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, Count,
+                             Threshold, "");
+
+  BasicBlock* hotBlock = createBasicBlock("hotMethod");
+  BasicBlock* continueBlock = createBasicBlock("afterCounter");
+  BranchInst::Create(hotBlock, continueBlock, test, currentBlock);
+
+  currentBlock = hotBlock;
+  CallInst::Create(intrinsics->HotMethodFunction, M, "", currentBlock);
+  BranchInst::Create(continueBlock, currentBlock);
+
+  currentBlock = continueBlock;
+}
+
 bool JavaJIT::canBeInlined(JavaMethod* meth, bool customizing) {
+  // Baseline code is recompiled once hot: don't spend time inlining.
+  if (profiling) return false;
   if (inlineMethods[meth]) return false;
   if (isSynchro(meth->access)) return false;
   if (isNative(meth->access)) return false;
@@ -225,7 +293,7 @@ void JavaJIT::invokeVirtual(uint16 index) {
                                               Type::getInt32Ty(*llvmContext),
                                               false,
                                               GlobalValue::ExternalLinkage,
-                                              intrinsics->constantZero, "");
+                                              intrinsics->constantPtrZero, "");
     
       BasicBlock* resolveVirtual = createBasicBlock("resolveVirtual");
       BasicBlock* endResolveVirtual = createBasicBlock("endResolveVirtual");
@@ -234,7 +302,7 @@ void JavaJIT::invokeVirtual(uint16 index) {
 
       Value* load = new LoadInst(GV, "", false, currentBlock);
       Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, load,
-                                 intrinsics->constantZero, "");
+                                 intrinsics->constantPtrZero, "");
       BranchInst::Create(resolveVirtual, endResolveVirtual, test, currentBlock);
       node->addIncoming(load, currentBlock);
       currentBlock = resolveVirtual;
@@ -294,8 +362,14 @@ llvm::Value* JavaJIT::getMutatorThreadPtr() {
                                      	intrinsics->constantZero, "", currentBlock);
   Value* threadId = new PtrToIntInst(FrameAddr, intrinsics->pointerSizeType, "",
                               			 currentBlock);
-  threadId = BinaryOperator::CreateAnd(threadId, intrinsics->constantThreadIDMask,
-                                       "", currentBlock);
+  Value* mask = intrinsics->constantThreadIDMask;
+  if (TheCompiler->isStaticCompiling()) {
+    // The stack size, hence the mask, is only known when the code runs.
+    Constant* maskPtr = TheCompiler->getLLVMModule()->getOrInsertGlobal(
+        "vmkitThreadIDMask", intrinsics->pointerSizeType);
+    mask = new LoadInst(maskPtr, "", currentBlock);
+  }
+  threadId = BinaryOperator::CreateAnd(threadId, mask, "", currentBlock);
   threadId = new IntToPtrInst(threadId, intrinsics->MutatorThreadType, "MutatorThreadPtr", currentBlock);
 
   return threadId;
@@ -657,22 +731,77 @@ llvm::Value* JavaJIT::objectToHeader(Value* obj) {
 	return new IntToPtrInst(obj, intrinsics->ObjectHeaderType, "objectHeader", currentBlock);
 }
 
+/// isBiasedTowards - Emit the test that the header is biased towards the
+/// thread. header & BiasedOwnerMask is the thread id and the biased bit of
+/// a biased header.
+static Value* isBiasedTowards(Value* header, Value* threadId,
+                              J3Intrinsics* intrinsics,
+                              BasicBlock* currentBlock) {
+  static const uint64_t BiasedOwnerMask = ~(vmkit::ThinLock::NonLockBitsMask |
+                                            vmkit::ThinLock::ThinCountMask);
+  Value* ownerMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                      BiasedOwnerMask);
+  Value* biasedMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                       vmkit::ThinLock::BiasedMask);
+  Value* owner = BinaryOperator::CreateAnd(header, ownerMask, "", currentBlock);
+  Value* expected = BinaryOperator::CreateOr(threadId, biasedMask, "",
+                                             currentBlock);
+  return new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, owner, expected, "");
+}
+
 void JavaJIT::monitorEnter(Value* obj) {
   Value* lockPtr = objectToHeader(obj);
 
-  Value* lock = new LoadInst(lockPtr, "", currentBlock);
+  Value* header = new LoadInst(lockPtr, "", currentBlock);
 
   Value* NonLockBitsMask = ConstantInt::get(intrinsics->pointerSizeType,
                                             vmkit::ThinLock::NonLockBitsMask);
 
-  lock = BinaryOperator::CreateAnd(lock, NonLockBitsMask, "", currentBlock);
+  Value* lock = BinaryOperator::CreateAnd(header, NonLockBitsMask, "",
+                                          currentBlock);
 
   Value* threadId = getMutatorThreadPtr();
   threadId = new PtrToIntInst(threadId, intrinsics->pointerSizeType, "",
                               currentBlock);
+
   Value* newValMask = BinaryOperator::CreateOr(threadId, lock, "",
                                                currentBlock);
 
+  BasicBlock* OK = createBasicBlock("synchronize passed");
+  BasicBlock* NotOK = createBasicBlock("synchronize did not pass");
+
+  if (vmkit::ThinLock::BiasedMask != 0) {
+    // If the object is biased towards this thread, increment the count of
+    // the lock without atomic operation, unless it overflows.
+    Value* ThinCountMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                            vmkit::ThinLock::ThinCountMask);
+    Value* count = BinaryOperator::CreateAnd(header, ThinCountMask, "",
+                                             currentBlock);
+    Value* notFull = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, count,
+                                  ThinCountMask, "");
+    Value* biased = isBiasedTowards(header, threadId, intrinsics,
+                                    currentBlock);
+    biased = BinaryOperator::CreateAnd(biased, notFull, "", currentBlock);
+
+    BasicBlock* BiasedBlock = createBasicBlock("biased lock");
+    BasicBlock* ThinBlock = createBasicBlock("thin lock");
+    BranchInst::Create(BiasedBlock, ThinBlock, biased, currentBlock);
+
+    currentBlock = BiasedBlock;
+    Value* add = ConstantInt::get(intrinsics->pointerSizeType,
+                                  vmkit::ThinLock::ThinCountAdd);
+    Value* newHeader = BinaryOperator::CreateAdd(header, add, "",
+                                                 currentBlock);
+    new StoreInst(newHeader, lockPtr, currentBlock);
+    BranchInst::Create(OK, currentBlock);
+
+    // Objects that cannot be biased are unlocked with the biased bit.
+    currentBlock = ThinBlock;
+    Value* biasedMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                         vmkit::ThinLock::BiasedMask);
+    lock = BinaryOperator::CreateOr(lock, biasedMask, "", currentBlock);
+  }
+
   // Do the atomic compare and swap.
   Value* atomic = new AtomicCmpXchgInst(
       lockPtr, lock, newValMask, SequentiallyConsistent, CrossThread,
@@ -680,9 +809,6 @@ void JavaJIT::monitorEnter(Value* obj) {
   
   Value* cmp = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, atomic,
                             lock, "");
-  
-  BasicBlock* OK = createBasicBlock("synchronize passed");
-  BasicBlock* NotOK = createBasicBlock("synchronize did not pass");
 
   BranchInst::Create(OK, NotOK, cmp, currentBlock);
 
@@ -721,14 +847,42 @@ void JavaJIT::monitorExit(Value* obj) {
   Value* oldValMask = BinaryOperator::CreateOr(threadId, lockedMask, "",
                                                currentBlock);
 
-  std::vector<Value*> atomicArgs;
-  atomicArgs.push_back(lockPtr);
-  atomicArgs.push_back(oldValMask);
-  atomicArgs.push_back(lockedMask);
+  Value* unlockedMask = lockedMask;
+  if (vmkit::ThinLock::BiasedMask != 0) {
+    // If the object is biased towards this thread, decrement the count of
+    // the lock without atomic operation.
+    Value* ThinCountMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                            vmkit::ThinLock::ThinCountMask);
+    Value* count = BinaryOperator::CreateAnd(lock, ThinCountMask, "",
+                                             currentBlock);
+    Value* held = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, count,
+                               intrinsics->constantPtrZero, "");
+    Value* biased = isBiasedTowards(lock, threadId, intrinsics,
+                                    currentBlock);
+    biased = BinaryOperator::CreateAnd(biased, held, "", currentBlock);
+
+    BasicBlock* BiasedBlock = createBasicBlock("biased unlock");
+    BasicBlock* ThinBlock = createBasicBlock("thin unlock");
+    BranchInst::Create(BiasedBlock, ThinBlock, biased, currentBlock);
+
+    currentBlock = BiasedBlock;
+    Value* add = ConstantInt::get(intrinsics->pointerSizeType,
+                                  vmkit::ThinLock::ThinCountAdd);
+    Value* newHeader = BinaryOperator::CreateSub(lock, add, "", currentBlock);
+    new StoreInst(newHeader, lockPtr, currentBlock);
+    BranchInst::Create(EndBlock, currentBlock);
+
+    // A released thin lock is not biased again.
+    currentBlock = ThinBlock;
+    Value* biasedMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                         vmkit::ThinLock::BiasedMask);
+    unlockedMask = BinaryOperator::CreateOr(lockedMask, biasedMask, "",
+                                            currentBlock);
+  }
 
   // Do the atomic compare and swap.
   Value* atomic = new AtomicCmpXchgInst(
-      lockPtr, oldValMask, lockedMask, SequentiallyConsistent, CrossThread,
+      lockPtr, oldValMask, unlockedMask, SequentiallyConsistent, CrossThread,
       currentBlock);
   
   Value* cmp = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, atomic,
@@ -1144,6 +1298,11 @@ llvm::Function* JavaJIT::javaCompile() {
     endNode = llvm::PHINode::Create(returnType, 0, "", endBlock);
   }
 
+  if (profiling) {
+    forwardToOptimizedCode();
+    incrementCounter(intrinsics->OffsetInvocationCountInMethodConstant);
+  }
+
   checkYieldPoint();
   
   if (isSynchro(compilingMethod->access)) {
@@ -1159,9 +1318,14 @@ llvm::Function* JavaJIT::javaCompile() {
                                        	intrinsics->constantZero, "", currentBlock);
     FrameAddr = new PtrToIntInst(FrameAddr, intrinsics->pointerSizeType, "",
                                  currentBlock);
+    Value* mask = intrinsics->constantStackOverflowMask;
+    if (TheCompiler->isStaticCompiling()) {
+      Constant* maskPtr = TheCompiler->getLLVMModule()->getOrInsertGlobal(
+          "vmkitStackOverflowMask", intrinsics->pointerSizeType);
+      mask = new LoadInst(maskPtr, "", currentBlock);
+    }
     Value* stackCheck = 
-      BinaryOperator::CreateAnd(FrameAddr, intrinsics->constantStackOverflowMask,
-                                "", currentBlock);
+      BinaryOperator::CreateAnd(FrameAddr, mask, "", currentBlock);
 
     stackCheck = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, stackCheck,
                               intrinsics->constantPtrZero, "");
@@ -1599,6 +1763,139 @@ Instruction* JavaJIT::lowerDoubleOps(const UTF8* name,
   return NULL;
 }
 
+bool JavaJIT::lowerArraycopy(Value* func, std::vector<Value*>& args,
+                             CommonClass* srcType, CommonClass* dstType) {
+  if (!srcType->isArray() || !dstType->isArray()) return false;
+  CommonClass* srcBase = srcType->asArrayClass()->baseClass();
+  CommonClass* dstBase = dstType->asArrayClass()->baseClass();
+  bool primitive = srcBase->isPrimitive();
+  if (primitive != dstBase->isPrimitive()) return false;
+  if (primitive && srcBase != dstBase) return false;
+
+  Value* src = args[0];
+  Value* srcPos = args[1];
+  Value* dst = args[2];
+  Value* dstPos = args[3];
+  Value* length = args[4];
+
+  // Null arrays, failed checks and exceptions are left to the method.
+  BasicBlock* slowBlock = createBasicBlock("arraycopy slow path");
+  BasicBlock* endBlock = createBasicBlock("arraycopy end");
+  BasicBlock* nextBlock = createBasicBlock("arraycopy not null");
+
+  Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, src,
+                             intrinsics->JavaObjectNullConstant, "");
+  Value* test2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, dst,
+                              intrinsics->JavaObjectNullConstant, "");
+  test = BinaryOperator::CreateOr(test, test2, "", currentBlock);
+  BranchInst::Create(slowBlock, nextBlock, test, currentBlock);
+  currentBlock = nextBlock;
+
+  // The types of the stack are not merged at join points, so they only
+  // select the copy: the classes of the arrays are always checked. Arrays of
+  // primitives must both have the static class. The elements of an array of
+  // references are assignable to the destination if it has the class of the
+  // source, or is an Object[].
+  Value* srcVT = CallInst::Create(intrinsics->GetVTFunction, src, "",
+                                  currentBlock);
+  Value* dstVT = CallInst::Create(intrinsics->GetVTFunction, dst, "",
+                                  currentBlock);
+  if (primitive) {
+    Value* arrayVT = TheCompiler->getVirtualTable(srcType->virtualVT);
+    test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, srcVT, arrayVT, "");
+    test2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, dstVT, arrayVT, "");
+    test = BinaryOperator::CreateAnd(test, test2, "", currentBlock);
+  } else {
+    Value* objectArrayVT =
+      TheCompiler->getVirtualTable(upcalls->ArrayOfObject->virtualVT);
+    test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, srcVT, dstVT, "");
+    test2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, dstVT,
+                         objectArrayVT, "");
+    test = BinaryOperator::CreateOr(test, test2, "", currentBlock);
+    // Only arrays of references have the VT of their element class.
+    Value* baseVT = CallInst::Create(intrinsics->GetBaseClassVTFromVTFunction,
+                                     srcVT, "", currentBlock);
+    test2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, baseVT,
+                         Constant::getNullValue(baseVT->getType()), "");
+    test = BinaryOperator::CreateAnd(test, test2, "", currentBlock);
+  }
+  nextBlock = createBasicBlock("arraycopy assignable");
+  BranchInst::Create(nextBlock, slowBlock, test, currentBlock);
+  currentBlock = nextBlock;
+
+  // Positions and length are positive, so their sums do not wrap as
+  // unsigned integers.
+  test = BinaryOperator::CreateOr(srcPos, dstPos, "", currentBlock);
+  test = BinaryOperator::CreateOr(test, length, "", currentBlock);
+  test = new ICmpInst(*currentBlock, ICmpInst::ICMP_SLT, test,
+                      intrinsics->constantZero, "");
+  Value* end = BinaryOperator::CreateAdd(srcPos, length, "", currentBlock);
+  test2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_UGT, end, arraySize(src),
+                       "");
+  test = BinaryOperator::CreateOr(test, test2, "", currentBlock);
+  end = BinaryOperator::CreateAdd(dstPos, length, "", currentBlock);
+  test2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_UGT, end, arraySize(dst),
+                       "");
+  test = BinaryOperator::CreateOr(test, test2, "", currentBlock);
+  nextBlock = createBasicBlock("arraycopy in bounds");
+  BranchInst::Create(slowBlock, nextBlock, test, currentBlock);
+  currentBlock = nextBlock;
+
+  uint32 logSize = primitive ? srcBase->asPrimitiveClass()->logSize :
+                               vmkit::kWordSizeLog2;
+  // Byte offsets of arrays of 8-byte elements do not fit in 32 bits: compute
+  // them in pointer width. Positions and length are known to be positive.
+  Type* ptrSizeType = intrinsics->pointerSizeType;
+  Value* shift = ConstantInt::get(ptrSizeType, logSize);
+  Value* srcOffset = CastInst::CreateZExtOrBitCast(srcPos, ptrSizeType, "",
+                                                   currentBlock);
+  srcOffset = BinaryOperator::CreateShl(srcOffset, shift, "", currentBlock);
+  Value* dstOffset = CastInst::CreateZExtOrBitCast(dstPos, ptrSizeType, "",
+                                                   currentBlock);
+  dstOffset = BinaryOperator::CreateShl(dstOffset, shift, "", currentBlock);
+  Value* size = CastInst::CreateZExtOrBitCast(length, ptrSizeType, "",
+                                              currentBlock);
+  size = BinaryOperator::CreateShl(size, shift, "", currentBlock);
+
+  Value* indexes[3] = { intrinsics->constantZero,
+                        intrinsics->JavaArrayElementsOffsetConstant,
+                        srcOffset };
+  Value* array = new BitCastInst(src, intrinsics->JavaArrayUInt8Type, "",
+                                 currentBlock);
+  Value* srcPtr = GetElementPtrInst::Create(array, indexes, "", currentBlock);
+  indexes[2] = dstOffset;
+  array = new BitCastInst(dst, intrinsics->JavaArrayUInt8Type, "",
+                          currentBlock);
+  Value* dstPtr = GetElementPtrInst::Create(array, indexes, "", currentBlock);
+
+  if (!primitive && vmkit::Collector::needsWriteBarrier()) {
+    // One barrier for all the references.
+    Value* barrierArgs[5] = {
+      new BitCastInst(src, intrinsics->ptrType, "", currentBlock),
+      new BitCastInst(srcPtr, intrinsics->ptrPtrType, "", currentBlock),
+      new BitCastInst(dst, intrinsics->ptrType, "", currentBlock),
+      new BitCastInst(dstPtr, intrinsics->ptrPtrType, "", currentBlock),
+      length
+    };
+    CallInst::Create(intrinsics->ArrayCopyWriteBarrierFunction, barrierArgs,
+                     "", currentBlock);
+  } else {
+    Value* moveArgs[5] = { dstPtr, srcPtr, size, intrinsics->constantOne,
+                           ConstantInt::getFalse(*llvmContext) };
+    Function* moveFunction = ptrSizeType->isIntegerTy(32) ?
+      intrinsics->llvm_memmove_i32 : intrinsics->llvm_memmove_i64;
+    CallInst::Create(moveFunction, moveArgs, "", currentBlock);
+  }
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = slowBlock;
+  invoke(func, args, "", currentBlock);
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = endBlock;
+  return true;
+}
+
 
 Instruction* JavaJIT::invokeInline(JavaMethod* meth, 
                                    std::vector<Value*>& args,
@@ -1727,10 +2024,23 @@ void JavaJIT::invokeStatic(uint16 index) {
     func = TheCompiler->getMethod(meth, NULL);
   }
 
+  // The static types of the arrays given to System.arraycopy, before the
+  // arguments are popped.
+  CommonClass* srcType = NULL;
+  CommonClass* dstType = NULL;
+  if (meth != NULL && meth == upcalls->SystemArraycopy) {
+    srcType = stack[stack.size() - 5].type;
+    dstType = stack[stack.size() - 3].type;
+  }
+
   std::vector<Value*> args; // size = [signature->nbIn + 2]; 
   FunctionType::param_iterator it  = staticType->param_end();
   makeArgs(it, index, args, signature->nbArguments);
 
+  if (srcType != NULL && lowerArraycopy(func, args, srcType, dstType)) {
+    return;
+  }
+
   if (className->equals(loader->mathName)) {
     val = lowerMathOps(name, args);
   } else if (className->equals(loader->VMFloatName)) {
@@ -2215,111 +2525,84 @@ void JavaJIT::invokeInterface(uint16 index) {
   targetObject = new LoadInst(
           targetObject, "", false, currentBlock);
   if (!thisReference) JITVerifyNull(targetObject);
-  // TODO: The following code needs more testing.
-#if 0
+
   BasicBlock* endBlock = createBasicBlock("end interface invoke");
-  PHINode * node = PHINode::Create(virtualPtrType, "", endBlock);
+  PHINode* node = PHINode::Create(virtualPtrType, 0, "", endBlock);
 
-  BasicBlock* label_bb = createBasicBlock("bb");
-  BasicBlock* label_bb4 = createBasicBlock("bb4");
-  BasicBlock* label_bb6 = createBasicBlock("bb6");
-  BasicBlock* label_bb7 = createBasicBlock("bb7");
-    
-  // Block entry (label_entry)
+  // If the IMT entry is not a conflict table, it is the code to call.
   Value* VT = CallInst::Create(intrinsics->GetVTFunction, targetObject, "",
                                currentBlock);
   Value* IMT = CallInst::Create(intrinsics->GetIMTFunction, VT, "",
                                 currentBlock);
-
-
   Value* indices[2] = { intrinsics->constantZero, Index };
-  Instruction* ptr_18 = GetElementPtrInst::Create(IMT, indices, "",
-                                                  currentBlock);
-  Instruction* int32_19 = new LoadInst(ptr_18, "", false, currentBlock);
-  int32_19 = new PtrToIntInst(int32_19, intrinsics->pointerSizeType, "",
+  Value* IMTEntry = GetElementPtrInst::Create(IMT, indices, "", currentBlock);
+  IMTEntry = new LoadInst(IMTEntry, "", false, currentBlock);
+  IMTEntry = new PtrToIntInst(IMTEntry, intrinsics->pointerSizeType, "",
                               currentBlock);
-  Value* one = ConstantInt::get(intrinsics->pointerSizeType, 1);
-  Value* zero = ConstantInt::get(intrinsics->pointerSizeType, 0);
-  BinaryOperator* int32_20 = BinaryOperator::Create(Instruction::And, int32_19,
-                                                    one, "", currentBlock);
-  ICmpInst* int1_toBool = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ,
-                                       int32_20, zero, "toBool");
-  BranchInst::Create(label_bb, label_bb4, int1_toBool, currentBlock);
-    
-  // Block bb (label_bb)
-  currentBlock = label_bb;
-  CastInst* ptr_22 = new IntToPtrInst(int32_19, virtualPtrType, "", currentBlock);
-  
-  node->addIncoming(ptr_22, currentBlock);
+  Value* isTable = BinaryOperator::CreateAnd(IMTEntry,
+                                             intrinsics->constantPtrOne, "",
+                                             currentBlock);
+  isTable = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, isTable,
+                         intrinsics->constantPtrZero, "");
+
+  BasicBlock* directBlock = createBasicBlock("IMT entry");
+  BasicBlock* tableBlock = createBasicBlock("IMT conflict");
+  BranchInst::Create(tableBlock, directBlock, isTable, currentBlock);
+
+  currentBlock = directBlock;
+  node->addIncoming(new IntToPtrInst(IMTEntry, virtualPtrType, "",
+                                     currentBlock), currentBlock);
   BranchInst::Create(endBlock, currentBlock);
-    
-  // Block bb4 (label_bb4)
-  currentBlock = label_bb4;
-  Constant* MinusTwo = ConstantInt::get(intrinsics->pointerSizeType, -2);
-  BinaryOperator* int32_25 = BinaryOperator::Create(Instruction::And, int32_19,
-                                                    MinusTwo, "", currentBlock);
-  PointerType* Ty = PointerType::getUnqual(intrinsics->JavaMethodType);
-  CastInst* ptr_26 = new IntToPtrInst(int32_25, Ty, "", currentBlock);
-  LoadInst* int32_27 = new LoadInst(ptr_26, "", false, currentBlock);
-  ICmpInst* int1_28 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, int32_27,
-                                   Meth, "");
-  BranchInst::Create(label_bb6, label_bb7, int1_28, currentBlock);
-    
-  // Block bb6 (label_bb6)
-  currentBlock = label_bb6;
-  PHINode* ptr_table_0_lcssa = PHINode::Create(Ty, 2, "table.0.lcssa",
-                                               currentBlock);
-  ptr_table_0_lcssa->reserveOperandSpace(2);
-  ptr_table_0_lcssa->addIncoming(ptr_26, label_bb4);
-   
-  GetElementPtrInst* ptr_31 = GetElementPtrInst::Create(ptr_table_0_lcssa,
-                                                        intrinsics->constantOne, "",
-                                                        currentBlock);
 
-  LoadInst* int32_32 = new LoadInst(ptr_31, "", false, currentBlock);
-  CastInst* ptr_33 = new BitCastInst(int32_32, virtualPtrType, "",
-                                     currentBlock);
-  node->addIncoming(ptr_33, currentBlock);
+  // Otherwise, look for the virtual table of the receiver in the inline
+  // cache of the call site. A hit gives the entry of the conflict table.
+  currentBlock = tableBlock;
+  Value* Cache = TheCompiler->newInterfaceCallCache(compilingClass);
+  if (Cache != NULL) {
+    Value* VTPtr = new BitCastInst(VT, intrinsics->ptrType, "", currentBlock);
+    PointerType* slotType = PointerType::getUnqual(virtualPtrType);
+    for (uint32 i = 0; i < InterfaceCallCache::NumEntries; ++i) {
+      Value* CachedVT = GetElementPtrInst::Create(
+          Cache, ConstantInt::get(Type::getInt32Ty(*llvmContext), i), "",
+          currentBlock);
+      CachedVT = new LoadInst(CachedVT, "", false, currentBlock);
+      Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, CachedVT,
+                                 VTPtr, "");
+
+      BasicBlock* hitBlock = createBasicBlock("inline cache hit");
+      BasicBlock* nextBlock = createBasicBlock("inline cache next");
+      BranchInst::Create(hitBlock, nextBlock, test, currentBlock);
+
+      currentBlock = hitBlock;
+      Value* Slot = GetElementPtrInst::Create(
+          Cache, ConstantInt::get(Type::getInt32Ty(*llvmContext),
+                                  InterfaceCallCache::NumEntries + i), "",
+          currentBlock);
+      Slot = new LoadInst(Slot, "", false, currentBlock);
+      Slot = new BitCastInst(Slot, slotType, "", currentBlock);
+      node->addIncoming(new LoadInst(Slot, "", false, currentBlock),
+                        currentBlock);
+      BranchInst::Create(endBlock, currentBlock);
 
-  BranchInst::Create(endBlock, currentBlock);
-    
-  // Block bb7 (label_bb7)
-  currentBlock = label_bb7;
-  PHINode* int32_indvar = PHINode::Create(Type::getInt32Ty(*llvmContext),
-                                          "indvar", currentBlock);
-  int32_indvar->reserveOperandSpace(2);
-  int32_indvar->addIncoming(intrinsics->constantZero, label_bb4);
-    
-  BinaryOperator* int32_table_010_rec =
-    BinaryOperator::Create(Instruction::Shl, int32_indvar, intrinsics->constantOne,
-                           "table.010.rec", currentBlock);
-
-  BinaryOperator* int32__rec =
-    BinaryOperator::Create(Instruction::Add, int32_table_010_rec,
-                           intrinsics->constantTwo, ".rec", currentBlock);
-  GetElementPtrInst* ptr_37 = GetElementPtrInst::Create(ptr_26, int32__rec, "",
-                                                        currentBlock);
-  LoadInst* int32_38 = new LoadInst(ptr_37, "", false, currentBlock);
-  ICmpInst* int1_39 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, int32_38,
-                                   Meth, "");
-  BinaryOperator* int32_indvar_next =
-    BinaryOperator::Create(Instruction::Add, int32_indvar, intrinsics->constantOne,
-                           "indvar.next", currentBlock);
-  BranchInst::Create(label_bb6, label_bb7, int1_39, currentBlock);
-  
-  int32_indvar->addIncoming(int32_indvar_next, currentBlock);
-  ptr_table_0_lcssa->addIncoming(ptr_37, currentBlock);
-      
-  currentBlock = endBlock;
-#else
+      currentBlock = nextBlock;
+    }
+  } else {
+    Cache = Constant::getNullValue(intrinsics->ptrPtrType);
+  }
+
+  // Miss: search the conflict table and update the inline cache.
   std::vector<Value*> Args;
   Args.push_back(targetObject);
   Args.push_back(Meth);
   Args.push_back(Index);
-  Value* node = invoke(intrinsics->ResolveInterfaceFunction,
-                       Args, "invokeinterface", currentBlock);
-  node = new BitCastInst(node, virtualPtrType, "", currentBlock);
-#endif
+  Args.push_back(Cache);
+  Value* res = invoke(intrinsics->ResolveInterfaceFunction,
+                      Args, "invokeinterface", currentBlock);
+  node->addIncoming(new BitCastInst(res, virtualPtrType, "", currentBlock),
+                    currentBlock);
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = endBlock;
 
   std::vector<Value*> args; // size = [signature->nbIn + 3];
   FunctionType::param_iterator it  = virtualType->param_end();
@@ -2639,9 +2922,3 @@ void JavaJIT::finishExceptions() {
   }
 }
 
-
-#ifdef USE_OPENJDK
-#include "JavaJITOpenJDK.inc"
-#else
-#include "JavaJITClasspath.inc"
-#endif
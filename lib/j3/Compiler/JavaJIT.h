@@ -107,6 +107,7 @@ public:
     overridesThis = false;
     nbHandlers = 0;
     jmpBuffer = NULL;
+    profiling = false;
   }
 
   /// javaCompile - Compile the Java method.
@@ -118,6 +119,10 @@ public:
   /// isCustomizable - Whether we found the method to be customizable.
   bool isCustomizable;
 
+  /// profiling - Are we compiling baseline code? Baseline code does not
+  /// inline and counts invocations and loop back edges.
+  bool profiling;
+
   // The number of handlers in that method.
   uint32_t nbHandlers;
 
@@ -552,8 +557,11 @@ private:
   llvm::Instruction* lowerDoubleOps(const UTF8* name, 
                                     std::vector<llvm::Value*>& args);
  
-  /// lowerArraycopy - Create a fast path for System.arraycopy.
-  void lowerArraycopy(std::vector<llvm::Value*>& args);
+  /// lowerArraycopy - Copy inline between arrays whose static types allow
+  /// it, calling System.arraycopy when the runtime checks of the copy fail.
+  /// Returns false if the static types do not allow an inline copy.
+  bool lowerArraycopy(llvm::Value* func, std::vector<llvm::Value*>& args,
+                      CommonClass* srcType, CommonClass* dstType);
 
   /// invoke - invoke the LLVM method of a Java method.
   llvm::Instruction* invoke(llvm::Value *F, std::vector<llvm::Value*>&args,
@@ -570,6 +578,16 @@ private:
 //===--------------------- Yield point support  ---------------------------===//
 
   void checkYieldPoint();
+
+//===--------------------- Tiered compilation support  --------------------===//
+
+  /// forwardToOptimizedCode - Emit code that calls the optimized code of the
+  /// method instead, once the method has been recompiled.
+  void forwardToOptimizedCode();
+
+  /// incrementCounter - Emit code to increment a counter of the method, and
+  /// to call j3HotMethod when the counter reaches the hot threshold.
+  void incrementCounter(llvm::Constant* counterOffset);
 };
 
 enum Opcode {
@@ -37,6 +37,8 @@
 #include "j3/JavaJITCompiler.h"
 #include "j3/J3Intrinsics.h"
 
+#include "JavaCompileQueue.h"
+
 using namespace j3;
 using namespace llvm;
 
@@ -152,6 +154,14 @@ Constant* JavaJITCompiler::getNativeFunction(JavaMethod* meth, void* ptr) {
   return ConstantExpr::getIntToPtr(CI, valPtrType);
 }
 
+Constant* JavaJITCompiler::newInterfaceCallCache(Class* cl) {
+  InterfaceCallCache* cache = new(cl->classLoader->allocator,
+                                  "InterfaceCallCache") InterfaceCallCache();
+  ConstantInt* CI = ConstantInt::get(Type::getInt64Ty(getLLVMContext()),
+                                     uint64_t(cache));
+  return ConstantExpr::getIntToPtr(CI, JavaIntrinsics.ptrPtrType);
+}
+
 JavaJITCompiler::JavaJITCompiler(
   const std::string &ModuleID, bool compiling_garbage_collector) :
   JavaLLVMCompiler(ModuleID, compiling_garbage_collector), listener(this) {
@@ -183,6 +193,9 @@ JavaJITCompiler::JavaJITCompiler(
       JavaIntrinsics.VTAllocateFunction, (void*)(word_t)VTgcmalloc);
   executionEngine->updateGlobalMapping(
       JavaIntrinsics.ArrayWriteBarrierFunction, (void*)(word_t)arrayWriteBarrier);
+  executionEngine->updateGlobalMapping(
+      JavaIntrinsics.ArrayCopyWriteBarrierFunction,
+      (void*)(word_t)arrayCopyWriteBarrier);
   executionEngine->updateGlobalMapping(
       JavaIntrinsics.FieldWriteBarrierFunction, (void*)(word_t)fieldWriteBarrier);
   executionEngine->updateGlobalMapping(
@@ -217,6 +230,7 @@ void JavaJITCompiler::makeVT(Class* cl) {
       JavaMethod& meth = current->virtualMethods[i];
       if (meth.offset != 0 || current->super != NULL) {
         functions[meth.offset] = getPointerOrStub(meth, JavaMethod::Virtual);
+        meth.addCodeSlot(&functions[meth.offset]);
       }
     }
     current = current->super;
@@ -266,6 +280,7 @@ void JavaJITCompiler::makeIMT(Class* cl) {
                                                    false, true, 0);
       if (meth) {
         IMT->contents[i] = getPointerOrStub(*meth, JavaMethod::Interface);
+        meth->addCodeSlot(&IMT->contents[i]);
       } else {
         IMT->contents[i] = (word_t)ThrowUnfoundInterface;
       }
@@ -290,6 +305,7 @@ void JavaJITCompiler::makeIMT(Class* cl) {
         if (methods[0]) {
           IMT->contents[i] = getPointerOrStub(*(methods[0]),
                                               JavaMethod::Interface);
+          methods[0]->addCodeSlot(&IMT->contents[i]);
         } else {
           IMT->contents[i] = (word_t)ThrowUnfoundInterface;
         }
@@ -314,6 +330,7 @@ void JavaJITCompiler::makeIMT(Class* cl) {
           table[j] = (word_t)Imeth;
           if (Cmeth) {
             table[j + 1] = getPointerOrStub(*Cmeth, JavaMethod::Interface);
+            Cmeth->addCodeSlot(&table[j + 1]);
           } else {
             table[j + 1] = (word_t)ThrowUnfoundInterface;
           }
@@ -331,8 +348,32 @@ void JavaJITCompiler::setMethod(Function* func, void* ptr, const char* name) {
   executionEngine->updateGlobalMapping(func, ptr);
 }
 
+JavaCompileQueue* JavaJITCompiler::compileQueue = NULL;
+
+void JavaJITCompiler::startCompilerThreads(Jnjvm* vm, uint32_t nbThreads) {
+  assert(compileQueue == NULL && "Compiler threads already started");
+  if (nbThreads == 0) return;
+  JavaCompileQueue* queue = new JavaCompileQueue(vm, this, nbThreads);
+  // Make sure the queue is fully initialized before other threads see it.
+  __sync_synchronize();
+  compileQueue = queue;
+}
+
 void* JavaJITCompiler::materializeFunction(JavaMethod* meth, Class* customizeFor) {
-  vmkit::VmkitModule::protectIR();
+  // Compiler threads compile what they need themselves: they can not wait
+  // on each other.
+  JavaCompileQueue* queue = compileQueue;
+  if (queue != NULL && !queue->isCompilerThread(JavaThread::get())) {
+    void* res = queue->compile(meth, customizeFor);
+    if (res != NULL) return res;
+    // The compiler thread failed. Compile the method here, so that the
+    // error is reported to the caller.
+  }
+  return compileMethod(meth, customizeFor);
+}
+
+void* JavaJITCompiler::compileMethod(JavaMethod* meth, Class* customizeFor) {
+  protectIR();
   Function* func = parseFunction(meth, customizeFor);
   void* res = executionEngine->getPointerToGlobal(func);
 
@@ -345,15 +386,59 @@ void* JavaJITCompiler::materializeFunction(JavaMethod* meth, Class* customizeFor
     // Now that it's compiled, we don't need the IR anymore
     func->deleteBody();
   }
-  vmkit::VmkitModule::unprotectIR();
+  unprotectIR();
   if (customizeFor == NULL || !getMethodInfo(meth)->isCustomizable) {
-    meth->code = res;
+    // Another compiler may have installed code in the meantime, possibly the
+    // optimized code of the method. Keep it: baseline code forwards to it.
+    void* old = __sync_val_compare_and_swap(&meth->code, (void*)NULL, res);
+    if (old != NULL) res = old;
   }
   return res;
 }
 
+uint32 JavaJITCompiler::hotThreshold = 0;
+
+void JavaJITCompiler::enableTieredCompilation(uint32_t threshold) {
+  hotThreshold = threshold;
+  JavaMethod::recordCodeSlots = (threshold != 0);
+}
+
+void JavaJITCompiler::optimizeMethod(JavaMethod* meth) {
+  JavaCompileQueue* queue = compileQueue;
+  if (queue != NULL && !queue->isCompilerThread(JavaThread::get())) {
+    // Keep running the baseline code while a compiler thread optimizes
+    // the method.
+    queue->optimize(meth);
+  } else {
+    recompileMethod(meth);
+  }
+}
+
+void* JavaJITCompiler::recompileMethod(JavaMethod* meth) {
+  Function* func = parseOptimizedFunction(meth);
+
+  protectIR();
+  void* res = executionEngine->getPointerToGlobal(func);
+  llvm::GCFunctionInfo& GFI = GCInfo->getFunctionInfo(*func);
+
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  vmkit::VmkitModule::addToVM(vm, &GFI, (JIT*)executionEngine, allocator, meth);
+
+  // Now that it's compiled, we don't need the IR anymore
+  func->deleteBody();
+
+  // Code generated from now on by this compiler calls the optimized code
+  // directly.
+  Function* baseline = getMethod(meth, NULL);
+  setMethod(baseline, res, baseline->getName().data());
+  unprotectIR();
+
+  meth->setOptimizedCode(res);
+  return res;
+}
+
 void* JavaJITCompiler::GenerateStub(llvm::Function* F) {
-  vmkit::VmkitModule::protectIR();
+  protectIR();
   void* res = executionEngine->getPointerToGlobal(F);
  
   // If the stub was already generated through an equivalent signature,
@@ -367,7 +452,7 @@ void* JavaJITCompiler::GenerateStub(llvm::Function* F) {
     // Now that it's compiled, we don't need the IR anymore
     F->deleteBody();
   }
-  vmkit::VmkitModule::unprotectIR();
+  unprotectIR();
   return res;
 }
 
@@ -376,6 +461,7 @@ extern "C" int StartJnjvmWithJIT(int argc, char** argv, char* mainClass) {
   llvm::llvm_shutdown_obj X; 
    
   vmkit::VmkitModule::initialise(argc, argv);
+  vmkit::Thread::initialise(argc, argv);
   vmkit::Collector::initialise(argc, argv);
  
   vmkit::ThreadAllocator allocator;
@@ -389,6 +389,9 @@ void JavaJIT::compileOpcodes(Reader& reader, uint32 codeLength) {
       }
 
       if (opinfo->backEdge) {
+        if (profiling) {
+          incrementCounter(intrinsics->OffsetBackEdgeCountInMethodConstant);
+        }
         checkYieldPoint();
       }
     }
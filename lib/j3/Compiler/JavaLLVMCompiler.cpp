@@ -37,18 +37,18 @@ JavaLLVMCompiler::JavaLLVMCompiler(
   
 void JavaLLVMCompiler::resolveVirtualClass(Class* cl) {
   // Lock here because we may be called by a class resolver
-  vmkit::VmkitModule::protectIR();
+  protectIR();
   LLVMClassInfo* LCI = (LLVMClassInfo*)getClassInfo(cl);
   LCI->getVirtualType();
-  vmkit::VmkitModule::unprotectIR();
+  unprotectIR();
 }
 
 void JavaLLVMCompiler::resolveStaticClass(Class* cl) {
   // Lock here because we may be called by a class initializer
-  vmkit::VmkitModule::protectIR();
+  protectIR();
   LLVMClassInfo* LCI = (LLVMClassInfo*)getClassInfo(cl);
   LCI->getStaticType();
-  vmkit::VmkitModule::unprotectIR();
+  unprotectIR();
 }
 
 Function* JavaLLVMCompiler::getMethod(JavaMethod* meth, Class* customizeFor) {
@@ -61,7 +61,7 @@ Function* JavaLLVMCompiler::parseFunction(JavaMethod* meth, Class* customizeFor)
   Function* func = LMI->getMethod(customizeFor);
   
   // We are jitting. Take the lock.
-  vmkit::VmkitModule::protectIR();
+  protectIR();
   if (func->getLinkage() == GlobalValue::ExternalWeakLinkage) {
     JavaJIT jit(this, meth, func, LMI->isCustomizable ? customizeFor : NULL);
     if (isNative(meth->access)) {
@@ -69,8 +69,12 @@ Function* JavaLLVMCompiler::parseFunction(JavaMethod* meth, Class* customizeFor)
       vmkit::VmkitModule::runPasses(func, JavaNativeFunctionPasses);
       vmkit::VmkitModule::runPasses(func, J3FunctionPasses);
     } else {
+      // With tiered compilation, methods are first compiled quickly, with
+      // counters, and recompiled by parseOptimizedFunction once hot.
+      jit.profiling = (getHotThreshold() != 0);
       jit.javaCompile();
-      vmkit::VmkitModule::runPasses(func, JavaFunctionPasses);
+      vmkit::VmkitModule::runPasses(func, jit.profiling ?
+          JavaBaselineFunctionPasses : JavaFunctionPasses);
       vmkit::VmkitModule::runPasses(func, J3FunctionPasses);
     }
     func->setLinkage(GlobalValue::ExternalLinkage);
@@ -82,7 +86,33 @@ Function* JavaLLVMCompiler::parseFunction(JavaMethod* meth, Class* customizeFor)
       LMI->isCustomizable = true;
     }
   }
-  vmkit::VmkitModule::unprotectIR();
+  unprotectIR();
+
+  return func;
+}
+
+Function* JavaLLVMCompiler::parseOptimizedFunction(JavaMethod* meth) {
+  assert(!isAbstract(meth->access) && !isNative(meth->access));
+  LLVMMethodInfo* LMI = getMethodInfo(meth);
+
+  protectIR();
+  // The baseline function of the method already has a body, or code, so
+  // the optimized version gets its own function.
+  Function* func = Function::Create(LMI->getFunctionType(),
+                                    GlobalValue::ExternalLinkage, "",
+                                    TheModule);
+  func->setGC("vmkit");
+  if (useCooperativeGC()) {
+    func->addFnAttr(Attribute::NoInline);
+  }
+  func->addFnAttr(Attribute::NoUnwind);
+  functions.insert(std::make_pair(func, meth));
+
+  JavaJIT jit(this, meth, func, NULL);
+  jit.javaCompile();
+  vmkit::VmkitModule::runPasses(func, JavaFunctionPasses);
+  vmkit::VmkitModule::runPasses(func, J3FunctionPasses);
+  unprotectIR();
 
   return func;
 }
@@ -99,6 +129,7 @@ JavaLLVMCompiler::~JavaLLVMCompiler() {
   delete TheModule;
   delete DebugFactory;
   delete JavaFunctionPasses;
+  delete JavaBaselineFunctionPasses;
   delete J3FunctionPasses;
   delete JavaNativeFunctionPasses;
   delete Context;
@@ -116,6 +147,10 @@ void JavaLLVMCompiler::addJavaPasses() {
   JavaFunctionPasses = new FunctionPassManager(TheModule);
   JavaFunctionPasses->add(new DataLayout(TheModule));
   vmkit::VmkitModule::addCommandLinePasses(JavaFunctionPasses);
+
+  JavaBaselineFunctionPasses = new FunctionPassManager(TheModule);
+  JavaBaselineFunctionPasses->add(new DataLayout(TheModule));
+  vmkit::VmkitModule::addBaselinePasses(JavaBaselineFunctionPasses);
 }
 
 } // end namespace j3
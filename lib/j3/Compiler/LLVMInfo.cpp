@@ -83,6 +83,7 @@ Type* LLVMClassInfo::getVirtualType() {
     
       classDef->virtualSize = (uint32)size;
       classDef->alignment = sl->getAlignment();
+      classDef->makeReferenceMap();
    
       Compiler->makeVT(classDef);
       Compiler->makeIMT(classDef);
@@ -252,7 +253,7 @@ Constant* LLVMFieldInfo::getOffset() {
 llvm::FunctionType* LLVMSignatureInfo::getVirtualType() {
  if (!virtualType) {
     // Lock here because we are called by arbitrary code
-    vmkit::VmkitModule::protectIR();
+    Compiler->protectIR();
     std::vector<llvm::Type*> llvmArgs;
     uint32 size = signature->nbArguments;
     Typedef* const* arguments = signature->getArgumentsType();
@@ -268,7 +269,7 @@ llvm::FunctionType* LLVMSignatureInfo::getVirtualType() {
     LLVMAssessorInfo& LAI =
       Compiler->getTypedefInfo(signature->getReturnType());
     virtualType = FunctionType::get(LAI.llvmType, llvmArgs, false);
-    vmkit::VmkitModule::unprotectIR();
+    Compiler->unprotectIR();
   }
   return virtualType;
 }
@@ -276,7 +277,7 @@ llvm::FunctionType* LLVMSignatureInfo::getVirtualType() {
 llvm::FunctionType* LLVMSignatureInfo::getStaticType() {
  if (!staticType) {
     // Lock here because we are called by arbitrary code
-    vmkit::VmkitModule::protectIR();
+    Compiler->protectIR();
     std::vector<llvm::Type*> llvmArgs;
     uint32 size = signature->nbArguments;
     Typedef* const* arguments = signature->getArgumentsType();
@@ -290,7 +291,7 @@ llvm::FunctionType* LLVMSignatureInfo::getStaticType() {
     LLVMAssessorInfo& LAI =
       Compiler->getTypedefInfo(signature->getReturnType());
     staticType = FunctionType::get(LAI.llvmType, llvmArgs, false);
-    vmkit::VmkitModule::unprotectIR();
+    Compiler->unprotectIR();
   }
   return staticType;
 }
@@ -298,7 +299,7 @@ llvm::FunctionType* LLVMSignatureInfo::getStaticType() {
 llvm::FunctionType* LLVMSignatureInfo::getNativeType() {
   if (!nativeType) {
     // Lock here because we are called by arbitrary code
-    vmkit::VmkitModule::protectIR();
+    Compiler->protectIR();
     std::vector<llvm::Type*> llvmArgs;
     uint32 size = signature->nbArguments;
     Typedef* const* arguments = signature->getArgumentsType();
@@ -326,14 +327,14 @@ llvm::FunctionType* LLVMSignatureInfo::getNativeType() {
       LAI.llvmType == Compiler->getIntrinsics()->JavaObjectType ?
         LAI.llvmTypePtr : LAI.llvmType;
     nativeType = FunctionType::get(RetType, llvmArgs, false);
-    vmkit::VmkitModule::unprotectIR();
+    Compiler->unprotectIR();
   }
   return nativeType;
 }
 
 llvm::FunctionType* LLVMSignatureInfo::getNativeStubType() {
   // Lock here because we are called by arbitrary code
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   std::vector<llvm::Type*> llvmArgs;
   uint32 size = signature->nbArguments;
   Typedef* const* arguments = signature->getArgumentsType();
@@ -362,7 +363,7 @@ llvm::FunctionType* LLVMSignatureInfo::getNativeStubType() {
     LAI.llvmType == Compiler->getIntrinsics()->JavaObjectType ?
       LAI.llvmTypePtr : LAI.llvmType;
   FunctionType* FTy = FunctionType::get(RetType, llvmArgs, false);
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return FTy;
 }
 
@@ -709,7 +710,7 @@ PointerType* LLVMSignatureInfo::getNativePtrType() {
 FunctionType* LLVMSignatureInfo::getVirtualBufType() {
   if (!virtualBufType) {
     // Lock here because we are called by arbitrary code
-    vmkit::VmkitModule::protectIR();
+    Compiler->protectIR();
     std::vector<llvm::Type*> Args;
     Args.push_back(Compiler->getIntrinsics()->ResolvedConstantPoolType); // ctp
     Args.push_back(getVirtualPtrType());
@@ -718,7 +719,7 @@ FunctionType* LLVMSignatureInfo::getVirtualBufType() {
     LLVMAssessorInfo& LAI =
       Compiler->getTypedefInfo(signature->getReturnType());
     virtualBufType = FunctionType::get(LAI.llvmType, Args, false);
-    vmkit::VmkitModule::unprotectIR();
+    Compiler->unprotectIR();
   }
   return virtualBufType;
 }
@@ -726,7 +727,7 @@ FunctionType* LLVMSignatureInfo::getVirtualBufType() {
 FunctionType* LLVMSignatureInfo::getStaticBufType() {
   if (!staticBufType) {
     // Lock here because we are called by arbitrary code
-    vmkit::VmkitModule::protectIR();
+    Compiler->protectIR();
     std::vector<llvm::Type*> Args;
     Args.push_back(Compiler->getIntrinsics()->ResolvedConstantPoolType); // ctp
     Args.push_back(getStaticPtrType());
@@ -734,7 +735,7 @@ FunctionType* LLVMSignatureInfo::getStaticBufType() {
     LLVMAssessorInfo& LAI =
       Compiler->getTypedefInfo(signature->getReturnType());
     staticBufType = FunctionType::get(LAI.llvmType, Args, false);
-    vmkit::VmkitModule::unprotectIR();
+    Compiler->unprotectIR();
   }
   return staticBufType;
 }
@@ -742,84 +743,84 @@ FunctionType* LLVMSignatureInfo::getStaticBufType() {
 Function* LLVMSignatureInfo::getVirtualBuf() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on virtualBufFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!virtualBufFunction) {
     virtualBufFunction = createFunctionCallBuf(true);
     signature->setVirtualCallBuf(Compiler->GenerateStub(virtualBufFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return virtualBufFunction;
 }
 
 Function* LLVMSignatureInfo::getVirtualAP() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on virtualAPFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!virtualAPFunction) {
     virtualAPFunction = createFunctionCallAP(true);
     signature->setVirtualCallAP(Compiler->GenerateStub(virtualAPFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return virtualAPFunction;
 }
 
 Function* LLVMSignatureInfo::getStaticBuf() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on staticBufFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!staticBufFunction) {
     staticBufFunction = createFunctionCallBuf(false);
     signature->setStaticCallBuf(Compiler->GenerateStub(staticBufFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return staticBufFunction;
 }
 
 Function* LLVMSignatureInfo::getStaticAP() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on staticAPFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!staticAPFunction) {
     staticAPFunction = createFunctionCallAP(false);
     signature->setStaticCallAP(Compiler->GenerateStub(staticAPFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return staticAPFunction;
 }
 
 Function* LLVMSignatureInfo::getStaticStub() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on staticStubFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!staticStubFunction) {
     staticStubFunction = createFunctionStub(false, false);
     signature->setStaticCallStub(Compiler->GenerateStub(staticStubFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return staticStubFunction;
 }
 
 Function* LLVMSignatureInfo::getSpecialStub() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on specialStubFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!specialStubFunction) {
     specialStubFunction = createFunctionStub(true, false);
     signature->setSpecialCallStub(Compiler->GenerateStub(specialStubFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return specialStubFunction;
 }
 
 Function* LLVMSignatureInfo::getVirtualStub() {
   // Lock here because we are called by arbitrary code. Also put that here
   // because we are waiting on virtualStubFunction to have an address.
-  vmkit::VmkitModule::protectIR();
+  Compiler->protectIR();
   if (!virtualStubFunction) {
     virtualStubFunction = createFunctionStub(false, true);
     signature->setVirtualCallStub(Compiler->GenerateStub(virtualStubFunction));
   }
-  vmkit::VmkitModule::unprotectIR();
+  Compiler->unprotectIR();
   return virtualStubFunction;
 }
 
@@ -41,7 +41,14 @@
 ;;; field 9:  void*  routine
 ;;; field 10: void*  lastKnownFrame
 ;;; field 11: void*  lastExceptionBuffer
-%Thread = type { %CircularBase, i32, i8*, i8*, i1, i1, i1, i8*, i8*, i8*, i8*, i8* }
+;;; field 12: void*  frameInfoIPs[16]
+;;; field 13: void*  frameInfos[16]
+;;; field 14: void*  rootSlots
+;;; field 15: uint32 nbRootSlots
+;;; field 16: uint32 rootSlotsCapacity
+;;; field 17: bool   rootSlotsReady
+%Thread = type { %CircularBase, i32, i8*, i8*, i1, i1, i1, i8*, i8*, i8*, i8*, i8*,
+                 [16 x i8*], [16 x i8*], i8*, i32, i32, i1 }
 
 %JavaThread = type { %MutatorThread, i8*, %JavaObject* }
 
@@ -56,7 +63,7 @@
                     i16 }
 
 %JavaMethod = type { i8*, i16, %Attribute*, i16, %JavaClass*,
-                     %UTF8*, %UTF8*, i8, i8*, i32 }
+                     %UTF8*, %UTF8*, i8, i8*, i32, i32, i32, i8, i8* }
 
 %JavaClassPrimitive = type { %JavaCommonClass, i32 }
 %JavaClassArray = type { %JavaCommonClass, %JavaCommonClass* }
@@ -248,7 +255,8 @@ declare float @getFinalFloatField(float*) readnone
 declare i8* @j3ResolveVirtualStub(%JavaObject*)
 declare i8* @j3ResolveSpecialStub()
 declare i8* @j3ResolveStaticStub()
-declare i8* @j3ResolveInterface(%JavaObject*, %JavaMethod*, i32)
+declare i8* @j3ResolveInterface(%JavaObject*, %JavaMethod*, i32, i8**)
+declare void @j3HotMethod(%JavaMethod*)
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;; Exception methods ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -5,4 +5,7 @@
 ;;; field 2: MutatorContext
 ;;; field 3: realRoutine
 ;;; field 4: CollectionAttempts
-%MutatorThread = type { %Thread, %ThreadAllocator, i8*, i8*, i32 }
+;;; field 5: CollectorContext
+;;; field 6: TLABCursor
+;;; field 7: TLABLimit
+%MutatorThread = type { %Thread, %ThreadAllocator, i8*, i8*, i32, i8*, i8*, i8* }
@@ -0,0 +1,199 @@
+//===------ ClasspathIndex.cpp - Index of the classes of a classpath ------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+
+#include "ClasspathIndex.h"
+#include "JnjvmClassLoader.h"
+#include "Reader.h"
+#include "Zip.h"
+
+using namespace j3;
+
+ClasspathIndex::ClasspathIndex(vmkit::BumpPtrAllocator& A) : allocator(A) {
+  tableSize = 1024;
+  nbEntries = 0;
+  table = (ClasspathEntry**)allocator.Allocate(
+      tableSize * sizeof(ClasspathEntry*), "Classpath index");
+  prefetchHead = 0;
+  prefetchTail = 0;
+  prefetchThread = NULL;
+}
+
+uint32 ClasspathIndex::hashName(const char* name, uint32 length) {
+  return ZipArchive::hashName(name, length);
+}
+
+uint32 ClasspathIndex::hashName(const UTF8* name) {
+  // Hash the characters as the loader converts them to file names.
+  uint32 hash = 2166136261U;
+  for (sint32 i = 0; i < name->size; ++i) {
+    hash = (hash ^ (uint8)(char)name->elements[i]) * 16777619U;
+  }
+  return hash;
+}
+
+void ClasspathIndex::grow() {
+  ClasspathEntry** oldTable = table;
+  uint32 oldSize = tableSize;
+  tableSize <<= 1;
+  table = (ClasspathEntry**)allocator.Allocate(
+      tableSize * sizeof(ClasspathEntry*), "Classpath index");
+  for (uint32 i = 0; i < oldSize; ++i) {
+    ClasspathEntry* entry = oldTable[i];
+    if (entry == NULL) continue;
+    uint32 index = entry->hash;
+    while (table[index & (tableSize - 1)] != NULL) ++index;
+    table[index & (tableSize - 1)] = entry;
+  }
+  allocator.Deallocate(oldTable);
+}
+
+void ClasspathIndex::addEntry(ClasspathEntry* entry) {
+  if (2 * (nbEntries + 1) > tableSize) grow();
+  uint32 index = entry->hash;
+  while (true) {
+    index &= tableSize - 1;
+    ClasspathEntry* cur = table[index];
+    if (cur == NULL) {
+      table[index] = entry;
+      ++nbEntries;
+      return;
+    }
+    if (cur->hash == entry->hash && cur->length == entry->length &&
+        !memcmp(cur->name, entry->name, entry->length)) {
+      return;
+    }
+    ++index;
+  }
+}
+
+void ClasspathIndex::addArchive(ZipArchive* archive) {
+  static const uint32 suffix = strlen(".class");
+  for (uint32 i = 0; i < archive->nbFiles; ++i) {
+    ZipFile* file = archive->files[i];
+    uint32 length = file->filenameLength;
+    if (length <= suffix ||
+        strcmp(file->filename + length - suffix, ".class")) {
+      continue;
+    }
+    ClasspathEntry* entry =
+      new(allocator, "ClasspathEntry") ClasspathEntry();
+    entry->name = file->filename;
+    entry->length = length - suffix;
+    entry->hash = hashName(entry->name, entry->length);
+    entry->archive = archive;
+    entry->file = file;
+    addEntry(entry);
+  }
+}
+
+void ClasspathIndex::addShared(const char* name, uint32 length,
+                               ClassBytes* bytes) {
+  ClasspathEntry* entry = new(allocator, "ClasspathEntry") ClasspathEntry();
+  entry->name = name;
+  entry->length = length;
+  entry->hash = hashName(name, length);
+  entry->bytes = bytes;
+  addEntry(entry);
+}
+
+ClasspathEntry* ClasspathIndex::lookup(const UTF8* name) {
+  uint32 hash = hashName(name);
+  uint32 index = hash;
+  while (true) {
+    index &= tableSize - 1;
+    ClasspathEntry* entry = table[index];
+    if (entry == NULL) return NULL;
+    if (entry->hash == hash && entry->length == (uint32)name->size) {
+      sint32 i = 0;
+      while (i < name->size && entry->name[i] == (char)name->elements[i]) {
+        ++i;
+      }
+      if (i == name->size) return entry;
+    }
+    ++index;
+  }
+}
+
+ClassBytes* ClasspathIndex::openShared(const UTF8* name) {
+  ClasspathEntry* entry = lookup(name);
+  return entry != NULL ? entry->bytes : NULL;
+}
+
+ClassBytes* ClasspathIndex::openClass(JnjvmClassLoader* loader,
+                                      const UTF8* name) {
+  ClasspathEntry* entry = lookup(name);
+  if (entry == NULL) return NULL;
+  if (entry->bytes != NULL) return entry->bytes;
+
+  ZipFile* file = entry->file;
+  ClassBytes* res = file->prefetched;
+  if (res == NULL) res = entry->archive->readFile(loader->allocator, file);
+  if (prefetchThread != NULL) prefetchNext(entry->archive, file);
+  return res;
+}
+
+void ClasspathIndex::prefetchNext(ZipArchive* archive, ZipFile* file) {
+  static const uint32 suffix = strlen(".class");
+  uint32 last = file->index + Reader::prefetchCount;
+  if (last >= archive->nbFiles) last = archive->nbFiles - 1;
+
+  prefetchLock.lock();
+  for (uint32 i = file->index + 1; i <= last; ++i) {
+    if (prefetchTail - prefetchHead == PrefetchQueueSize) break;
+    ZipFile* next = archive->files[i];
+    // Files read without a copy do not benefit from prefetching.
+    if (next->prefetched != NULL || archive->isSlice(next)) continue;
+    if (next->filenameLength <= suffix ||
+        strcmp(next->filename + next->filenameLength - suffix, ".class")) {
+      continue;
+    }
+    prefetchArchives[prefetchTail % PrefetchQueueSize] = archive;
+    prefetchFiles[prefetchTail % PrefetchQueueSize] = next;
+    ++prefetchTail;
+  }
+  prefetchCond.signal();
+  prefetchLock.unlock();
+}
+
+void ClasspathIndex::startPrefetchThread(Jnjvm* vm) {
+  prefetchThread = new ClasspathPrefetchThread(vm, this);
+  prefetchThread->start(
+      (void (*)(vmkit::Thread*))ClasspathPrefetchThread::prefetchStart);
+}
+
+void ClasspathPrefetchThread::prefetchStart(ClasspathPrefetchThread* th) {
+  ClasspathIndex* index = th->index;
+
+  while (true) {
+    index->prefetchLock.lock();
+    while (index->prefetchHead == index->prefetchTail) {
+      index->prefetchCond.wait(&index->prefetchLock);
+    }
+    uint32 pos = index->prefetchHead % ClasspathIndex::PrefetchQueueSize;
+    ZipArchive* archive = index->prefetchArchives[pos];
+    ZipFile* file = index->prefetchFiles[pos];
+    ++index->prefetchHead;
+    index->prefetchLock.unlock();
+
+    if (file->prefetched != NULL) continue;
+
+    // Inflating does not touch Java objects: let collections run meanwhile.
+    th->enterUncooperativeCode();
+    ClassBytes* bytes = new (index->allocator, file->ucsize)
+      ClassBytes(file->ucsize);
+    if (archive->readFile(bytes, file) != 0) {
+      // Publish the bytes once they are all written.
+      __sync_synchronize();
+      file->prefetched = bytes;
+    }
+    th->leaveUncooperativeCode();
+  }
+}
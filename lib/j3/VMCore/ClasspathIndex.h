@@ -0,0 +1,186 @@
+//===------- ClasspathIndex.h - Index of the classes of a classpath -------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef J3_CLASSPATH_INDEX_H
+#define J3_CLASSPATH_INDEX_H
+
+#include "vmkit/Allocator.h"
+#include "vmkit/Cond.h"
+#include "vmkit/Locks.h"
+
+#include "JavaThread.h"
+#include "UTF8.h"
+
+namespace j3 {
+
+class ClassBytes;
+class ClasspathIndex;
+class Jnjvm;
+class JnjvmClassLoader;
+class ZipArchive;
+struct ZipFile;
+
+/// ClasspathEntry - A class file of an archive of a classpath, or a class
+/// of a shared archive.
+///
+class ClasspathEntry : public vmkit::PermanentObject {
+public:
+  /// name - The name of the class, which is not null-terminated.
+  ///
+  const char* name;
+
+  /// length - The length of the name.
+  ///
+  uint32 length;
+
+  /// hash - The hash of the name.
+  ///
+  uint32 hash;
+
+  /// archive - The archive containing the class, or NULL if the class is in
+  /// a shared archive.
+  ///
+  ZipArchive* archive;
+
+  /// file - The file of the class in the archive.
+  ///
+  ZipFile* file;
+
+  /// bytes - The bytes of the class, if the class is in a shared archive.
+  ///
+  ClassBytes* bytes;
+};
+
+/// ClasspathPrefetchThread - A thread inflating the classes that are likely
+/// to be loaded next, so that the loader finds their bytes ready.
+///
+class ClasspathPrefetchThread : public JavaThread {
+public:
+  /// index - The index whose classes this thread prefetches.
+  ///
+  ClasspathIndex* index;
+
+  ClasspathPrefetchThread(Jnjvm* vm, ClasspathIndex* i) : JavaThread(vm) {
+    index = i;
+  }
+
+  /// prefetchStart - The main loop of the thread.
+  ///
+  static void prefetchStart(ClasspathPrefetchThread* th);
+};
+
+/// ClasspathIndex - Open addressing hash table of all the classes of the
+/// archives of a classpath, built once when the classpath is analysed.
+/// Looking up a class does not walk archives one after the other, and the
+/// first entry of a name hides the others. Directories are not indexed:
+/// their files may change while the VM runs, and walking them would cost
+/// time at startup. The loader looks them up before the archives.
+///
+class ClasspathIndex : public vmkit::PermanentObject {
+  friend class ClasspathPrefetchThread;
+
+  /// PrefetchQueueSize - The maximum number of files waiting to be
+  /// prefetched. Requests are dropped when the queue is full.
+  ///
+  static const uint32 PrefetchQueueSize = 256;
+
+  /// allocator - The allocator of the entries.
+  ///
+  vmkit::BumpPtrAllocator& allocator;
+
+  /// table - The entries, indexed by the hash of the class name.
+  ///
+  ClasspathEntry** table;
+
+  /// tableSize - The number of slots in the table, a power of two.
+  ///
+  uint32 tableSize;
+
+  /// nbEntries - The number of entries in the table. The table is kept at
+  /// most half full.
+  ///
+  uint32 nbEntries;
+
+  /// prefetchLock - Lock protecting the prefetch queue.
+  ///
+  vmkit::LockNormal prefetchLock;
+
+  /// prefetchCond - Condition to wake up the prefetch thread.
+  ///
+  vmkit::Cond prefetchCond;
+
+  /// prefetchArchives, prefetchFiles - The files to prefetch, in a circular
+  /// buffer.
+  ///
+  ZipArchive* prefetchArchives[PrefetchQueueSize];
+  ZipFile* prefetchFiles[PrefetchQueueSize];
+
+  /// prefetchHead, prefetchTail - The first and last positions of the queue.
+  ///
+  uint32 prefetchHead;
+  uint32 prefetchTail;
+
+  /// prefetchThread - The thread prefetching classes, if any.
+  ///
+  ClasspathPrefetchThread* prefetchThread;
+
+  /// hashName - The hash of a class name.
+  ///
+  static uint32 hashName(const char* name, uint32 length);
+  static uint32 hashName(const UTF8* name);
+
+  /// addEntry - Add an entry, unless it is hidden by an entry of the same
+  /// name.
+  ///
+  void addEntry(ClasspathEntry* entry);
+
+  /// grow - Double the size of the table.
+  ///
+  void grow();
+
+  /// prefetchNext - Queue the files following the file in its archive.
+  ///
+  void prefetchNext(ZipArchive* archive, ZipFile* file);
+
+public:
+  ClasspathIndex(vmkit::BumpPtrAllocator& A);
+
+  /// addArchive - Add the classes of an archive.
+  ///
+  void addArchive(ZipArchive* archive);
+
+  /// addShared - Add a class of a shared archive. Classes of a shared
+  /// archive must be added first, they then hide the classes of archives.
+  /// The loader looks them up with openShared before the directories.
+  ///
+  void addShared(const char* name, uint32 length, ClassBytes* bytes);
+
+  /// lookup - Find the entry of a class, or NULL if the class is not in the
+  /// classpath.
+  ///
+  ClasspathEntry* lookup(const UTF8* name);
+
+  /// openShared - Get the bytes of a class of a shared archive, or NULL if
+  /// the class is not in a shared archive.
+  ///
+  ClassBytes* openShared(const UTF8* name);
+
+  /// openClass - Get the bytes of a class, or NULL if the class is not in
+  /// an archive of the classpath.
+  ///
+  ClassBytes* openClass(JnjvmClassLoader* loader, const UTF8* name);
+
+  /// startPrefetchThread - Start the thread prefetching classes.
+  ///
+  void startPrefetchThread(Jnjvm* vm);
+};
+
+} // end namespace j3
+
+#endif
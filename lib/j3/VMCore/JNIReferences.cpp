@@ -0,0 +1,136 @@
+//===--------- JNIReferences.cpp - Management of JNI references -----------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "JavaObject.h"
+#include "JNIReferences.h"
+
+using namespace j3;
+
+JavaObject** JNIGlobalReferenceChunk::allocate() {
+  JavaObject** res = NULL;
+  lock.acquire();
+  if (freeList != NULL) {
+    res = freeList;
+    freeList = (JavaObject**)((word_t)*res & ~(word_t)1);
+    *res = NULL;
+  } else if (top < capacity()) {
+    // The memory of the chunk is not cleared, and the slot is traced as
+    // soon as top covers it.
+    res = &references[top];
+    *res = NULL;
+    __sync_synchronize();
+    ++top;
+  }
+  lock.release();
+  return res;
+}
+
+JNIGlobalReferenceChunk* JNIGlobalReferences::getFreeChunk() {
+  JNIGlobalReferenceChunk* chunk = NULL;
+  lock.acquire();
+  if (freeChunks != NULL) {
+    chunk = freeChunks;
+    freeChunks = chunk->nextFree;
+    // The chunk may get free slots again, and must then be listed again.
+    // Clear the flag before the chunk can be seen unlisted: a slot freed
+    // meanwhile would otherwise not list the chunk. The chunk lock is never
+    // held while taking the lock of the table, so taking it here is safe.
+    chunk->lock.acquire();
+    chunk->listed = false;
+    chunk->lock.release();
+    lock.release();
+    return chunk;
+  }
+
+  void* mem = NULL;
+  if (posix_memalign(&mem, JNIGlobalReferenceChunk::Size,
+                     JNIGlobalReferenceChunk::Size) != 0) {
+    fprintf(stderr, "Can not allocate JNI global references.\n");
+    abort();
+  }
+  chunk = (JNIGlobalReferenceChunk*)mem;
+  chunk->lock.locked = 0;
+  chunk->freeList = NULL;
+  chunk->top = 0;
+  chunk->listed = false;
+  chunk->nextFree = NULL;
+  chunk->next = chunks;
+  chunks = chunk;
+  lock.release();
+  return chunk;
+}
+
+JavaObject** JNIGlobalReferences::addJNIReference(
+    JavaObject* obj, JNIGlobalReferenceChunk** cache) {
+  llvm_gcroot(obj, 0);
+  JNIGlobalReferenceChunk* chunk = *cache;
+  JavaObject** res = (chunk != NULL) ? chunk->allocate() : NULL;
+  while (res == NULL) {
+    chunk = getFreeChunk();
+    res = chunk->allocate();
+  }
+  *cache = chunk;
+
+  // The slot is NULL until the write, so a collection meanwhile ignores it.
+  // The barrier may collect, so it must not be done with a lock held.
+  vmkit::Collector::objectReferenceNonHeapWriteBarrier((gc**)res, (gc*)obj);
+  return res;
+}
+
+void JNIGlobalReferences::removeJNIReference(JavaObject** obj) {
+  JNIGlobalReferenceChunk* chunk = JNIGlobalReferenceChunk::owner(obj);
+  bool list = false;
+  chunk->lock.acquire();
+  assert(!JNIGlobalReferenceChunk::isFree(*obj) &&
+         "Global reference deleted twice");
+  *obj = (JavaObject*)((word_t)chunk->freeList | 1);
+  chunk->freeList = obj;
+  if (!chunk->listed) {
+    chunk->listed = true;
+    list = true;
+  }
+  chunk->lock.release();
+
+  if (list) {
+    lock.acquire();
+    chunk->nextFree = freeChunks;
+    freeChunks = chunk;
+    lock.release();
+  }
+}
+
+void JNIGlobalReferences::tracer(word_t closure) {
+  for (JNIGlobalReferenceChunk* chunk = chunks; chunk != NULL;
+       chunk = chunk->next) {
+    for (uint32 i = 0; i < chunk->top; ++i) {
+      JavaObject** obj = chunk->references + i;
+      if (*obj == NULL || JNIGlobalReferenceChunk::isFree(*obj)) continue;
+      vmkit::Collector::markAndTraceRoot(NULL, obj, closure);
+    }
+  }
+}
+
+void JNIGlobalReferences::scanWeakReferences(word_t closure) {
+  for (JNIGlobalReferenceChunk* chunk = chunks; chunk != NULL;
+       chunk = chunk->next) {
+    for (uint32 i = 0; i < chunk->top; ++i) {
+      JavaObject** obj = chunk->references + i;
+      if (*obj == NULL || JNIGlobalReferenceChunk::isFree(*obj)) continue;
+      if (vmkit::Collector::isLive((gc*)*obj, closure)) {
+        *obj = (JavaObject*)
+          vmkit::Collector::getForwardedReferent((gc*)*obj, closure);
+      } else {
+        *obj = NULL;
+      }
+    }
+  }
+}
@@ -11,6 +11,7 @@
 #define JNI_REFERENCES_H
 
 #include "vmkit/Allocator.h"
+#include "vmkit/Locks.h"
 
 namespace j3 {
 
@@ -41,51 +42,115 @@ public:
   uint32_t getLength() { return length; }
 };
 
-class JNIGlobalReferences {
-  friend class Jnjvm;
+class JNIGlobalReferences;
+
+/// JNIGlobalReferenceChunk - A block of global references, aligned on its
+/// size so that the chunk of a reference is found by masking its address.
+/// Free slots are chained in a free list, tagged with their low bit so that
+/// the collector tells them from objects.
+///
+class JNIGlobalReferenceChunk {
+  friend class JNIGlobalReferences;
+
+public:
+  /// Size - The size and alignment of a chunk.
+  ///
+  static const uint32_t Size = 4096;
 
 private:
-  JNIGlobalReferences* next;
-  JNIGlobalReferences* prev;
-  uint32_t length;
-  uint32_t count;
-  JavaObject* globalReferences[MAXIMUM_REFERENCES];
+  /// next - The next chunk of the table.
+  ///
+  JNIGlobalReferenceChunk* next;
 
+  /// nextFree - The next chunk with free slots in the table.
+  ///
+  JNIGlobalReferenceChunk* nextFree;
 
-public:
-  JNIGlobalReferences() {
-    next = 0;
-    prev = 0;
-    length = 0;
-    count = 0;
+  /// lock - Lock protecting the free list of the chunk.
+  ///
+  vmkit::SpinLock lock;
+
+  /// freeList - The first free slot, or NULL.
+  ///
+  JavaObject** freeList;
+
+  /// top - The number of slots ever used. The slots above are free and not
+  /// in the free list.
+  ///
+  uint32_t top;
+
+  /// listed - Is the chunk in the list of chunks with free slots?
+  ///
+  bool listed;
+
+  /// references - The slots of the chunk, up to the end of the chunk.
+  ///
+  JavaObject* references[1];
+
+  static uint32_t capacity() {
+    return (Size - sizeof(JNIGlobalReferenceChunk)) / sizeof(JavaObject*) + 1;
+  }
+
+  static bool isFree(JavaObject* obj) {
+    return ((word_t)obj & 1) != 0;
   }
 
-  JavaObject** addJNIReference(JavaObject* obj) {
-    llvm_gcroot(obj, 0);
-    if (length == MAXIMUM_REFERENCES) {
-      if (!next) {
-        next = new JNIGlobalReferences();
-        next->prev = this;
-      }
-      return next->addJNIReference(obj);
-    } else {
-      ++count;
-      vmkit::Collector::objectReferenceNonHeapWriteBarrier(
-          (gc**)&(globalReferences[length]), (gc*)obj);
-      return &globalReferences[length++];
-    }
+  static JNIGlobalReferenceChunk* owner(JavaObject** ref) {
+    return (JNIGlobalReferenceChunk*)((word_t)ref & ~(word_t)(Size - 1));
   }
 
-  void removeJNIReference(JavaObject** obj) {
-    if (((word_t)obj >= (word_t)globalReferences) &&
-        ((word_t)obj) < (word_t)(globalReferences + MAXIMUM_REFERENCES)) {
-      *obj = NULL;
-      --count;
-    } else {
-      assert(next && "No global reference located there");
-      next->removeJNIReference(obj);
-    }
+  /// allocate - Take a slot of the chunk, or return NULL if it is full.
+  ///
+  JavaObject** allocate();
+};
+
+/// JNIGlobalReferences - The global references of a VM, or its weak global
+/// references. Threads allocate from the chunk they last allocated from, so
+/// that they rarely share a lock, and the table lock is only taken to get
+/// another chunk.
+///
+class JNIGlobalReferences {
+private:
+  /// lock - Lock protecting the lists of chunks.
+  ///
+  vmkit::SpinLock lock;
+
+  /// chunks - All the chunks of the table.
+  ///
+  JNIGlobalReferenceChunk* chunks;
+
+  /// freeChunks - The chunks with free slots not cached by a thread.
+  ///
+  JNIGlobalReferenceChunk* freeChunks;
+
+  /// getFreeChunk - Get a chunk with free slots, allocating one if needed.
+  ///
+  JNIGlobalReferenceChunk* getFreeChunk();
+
+public:
+  JNIGlobalReferences() {
+    chunks = 0;
+    freeChunks = 0;
   }
+
+  /// addJNIReference - Add a reference to the object. cache is the chunk the
+  /// thread last allocated from in this table, and it is updated.
+  ///
+  JavaObject** addJNIReference(JavaObject* obj,
+                               JNIGlobalReferenceChunk** cache);
+
+  /// removeJNIReference - Free the slot of a reference.
+  ///
+  void removeJNIReference(JavaObject** obj);
+
+  /// tracer - Trace the references as roots.
+  ///
+  void tracer(word_t closure);
+
+  /// scanWeakReferences - Clear the references to dead objects and update
+  /// the references to moved objects.
+  ///
+  void scanWeakReferences(word_t closure);
 };
 
 }
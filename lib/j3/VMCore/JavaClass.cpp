@@ -63,6 +63,13 @@ extern "C" void JavaObjectTracer(JavaObject*);
 extern "C" void ArrayObjectTracer(JavaObject*);
 extern "C" void RegularObjectTracer(JavaObject*);
 extern "C" void ReferenceObjectTracer(JavaObject*);
+extern "C" void NoReferenceObjectTracer(JavaObject*);
+extern "C" void FixedReferenceObjectTracer1(JavaObject*);
+extern "C" void FixedReferenceObjectTracer2(JavaObject*);
+extern "C" void FixedReferenceObjectTracer3(JavaObject*);
+extern "C" void FixedReferenceObjectTracer4(JavaObject*);
+extern "C" void BitmapObjectTracer(JavaObject*);
+extern "C" void OffsetsObjectTracer(JavaObject*);
 
 
 extern "C" bool CheckIfObjectIsAssignableToArrayPosition(JavaObject * obj, JavaObject* array) {
@@ -280,6 +287,10 @@ Class::Class(JnjvmClassLoader* loader, const UTF8* n, ClassBytes* B) :
   staticFields = 0;
   ownerClass = 0;
   innerAccess = 0;
+  memberIndex = 0;
+  referenceOffsets = 0;
+  nbReferenceOffsets = 0;
+  referenceBitmap = 0;
   access = JNJVM_CLASS;
   memset(IsolateInfo, 0, sizeof(TaskClassMirror) * NR_ISOLATES);
 }
@@ -323,6 +334,41 @@ void* JavaMethod::compiledPtr(Class* customizeFor) {
   return code;
 }
 
+bool JavaMethod::recordCodeSlots = false;
+
+void JavaMethod::addCodeSlot(word_t* slot) {
+  // Entries filled with a stub or with the optimized code are never
+  // patched.
+  if (!recordCodeSlots || tier == OptimizedTier) return;
+  if (code == NULL || *slot != (word_t)code) return;
+  CodeSlot* cur = (CodeSlot*)
+    classDef->classLoader->allocator.Allocate(sizeof(CodeSlot), "Code slot");
+  cur->slot = slot;
+  CodeSlot* head;
+  do {
+    head = codeSlots;
+    cur->next = head;
+  } while (!__sync_bool_compare_and_swap(&codeSlots, head, cur));
+}
+
+void JavaMethod::setOptimizedCode(void* optimized) {
+  word_t baseline = (word_t)code;
+  code = optimized;
+  // Baseline code starts forwarding calls once it sees the new tier, so
+  // the code must be visible before the tier.
+  __sync_synchronize();
+  tier = OptimizedTier;
+
+  if (baseline == 0) return;
+
+  // Patch the entries recorded when they were filled with the baseline
+  // code. Other references, e.g. direct calls and entries filled
+  // concurrently, go through the baseline code, which forwards the call.
+  for (CodeSlot* cur = codeSlots; cur != NULL; cur = cur->next) {
+    __sync_bool_compare_and_swap(cur->slot, baseline, (word_t)optimized);
+  }
+}
+
 void JavaMethod::setNative() {
   access |= ACC_NATIVE;
 }
@@ -338,6 +384,129 @@ void JavaVirtualTable::setNativeDestructor(word_t ptr, const char* name) {
 	}
 }
 
+uint32 MemberIndex::hash(const UTF8* name, const UTF8* type, uint32 kind) {
+  uint32 res = 2166136261U ^ kind;
+  for (sint32 i = 0; i < name->size; ++i) {
+    res = (res ^ name->elements[i]) * 16777619U;
+  }
+  for (sint32 i = 0; i < type->size; ++i) {
+    res = (res ^ type->elements[i]) * 16777619U;
+  }
+  return res;
+}
+
+MemberIndex::Entry* MemberIndex::lookup(const UTF8* name, const UTF8* type,
+                                        uint32 kind) {
+  uint32 index = hash(name, type, kind);
+  while (true) {
+    index &= size - 1;
+    Entry* entry = &entries[index];
+    if (entry->member == NULL) return NULL;
+    if (entry->kind == kind && entry->name->equals(name) &&
+        entry->type->equals(type)) {
+      return entry;
+    }
+    ++index;
+  }
+}
+
+void MemberIndex::insert(const UTF8* name, const UTF8* type, uint32 kind,
+                         void* member, Class* cl) {
+  uint32 index = hash(name, type, kind);
+  while (true) {
+    index &= size - 1;
+    Entry* entry = &entries[index];
+    if (entry->member == NULL) {
+      entry->name = name;
+      entry->type = type;
+      entry->member = member;
+      entry->cl = cl;
+      entry->kind = kind;
+      ++nbEntries;
+      return;
+    }
+    if (entry->kind == kind && entry->name->equals(name) &&
+        entry->type->equals(type)) {
+      return;
+    }
+    ++index;
+  }
+}
+
+MemberIndex* MemberIndex::create(Class* cl) {
+  MemberIndex* super = NULL;
+  if (cl->super != NULL) {
+    super = cl->super->getMemberIndex();
+    if (super == NULL) return NULL;
+  }
+  
+  uint32 count = cl->nbVirtualMethods + cl->nbStaticMethods +
+                 cl->nbVirtualFields + cl->nbStaticFields;
+  if (super) count += super->nbEntries;
+  for (uint16 i = 0; i < cl->nbInterfaces; ++i) {
+    MemberIndex* I = cl->interfaces[i]->getMemberIndex();
+    if (I == NULL) return NULL;
+    count += I->nbEntries;
+  }
+
+  uint32 size = 8;
+  while (size < 2 * count) size <<= 1;
+  vmkit::BumpPtrAllocator& allocator = cl->classLoader->allocator;
+  MemberIndex* res = new(allocator, "MemberIndex") MemberIndex();
+  res->size = size;
+  res->nbEntries = 0;
+  res->entries = (Entry*)allocator.Allocate(size * sizeof(Entry),
+                                            "MemberIndex entries");
+
+  // Insert the entries in the order Class::lookupMethodDontThrow looks them
+  // up: the class, then its super class, then its interfaces for static
+  // members.
+  for (uint32 i = 0; i < cl->nbVirtualMethods; ++i) {
+    JavaMethod* meth = &cl->virtualMethods[i];
+    res->insert(meth->name, meth->type, VirtualMethod, meth, cl);
+  }
+  for (uint32 i = 0; i < cl->nbStaticMethods; ++i) {
+    JavaMethod* meth = &cl->staticMethods[i];
+    res->insert(meth->name, meth->type, StaticMethod, meth, cl);
+  }
+  for (uint32 i = 0; i < cl->nbVirtualFields; ++i) {
+    JavaField* field = &cl->virtualFields[i];
+    res->insert(field->name, field->type, VirtualField, field, cl);
+  }
+  for (uint32 i = 0; i < cl->nbStaticFields; ++i) {
+    JavaField* field = &cl->staticFields[i];
+    res->insert(field->name, field->type, StaticField, field, cl);
+  }
+
+  if (super) {
+    for (uint32 i = 0; i < super->size; ++i) {
+      Entry* entry = &super->entries[i];
+      if (entry->member == NULL) continue;
+      res->insert(entry->name, entry->type, entry->kind, entry->member,
+                  entry->cl);
+    }
+  }
+
+  for (uint16 i = 0; i < cl->nbInterfaces; ++i) {
+    MemberIndex* I = cl->interfaces[i]->getMemberIndex();
+    for (uint32 j = 0; j < I->size; ++j) {
+      Entry* entry = &I->entries[j];
+      if (entry->member == NULL) continue;
+      if (entry->kind != StaticMethod && entry->kind != StaticField) continue;
+      res->insert(entry->name, entry->type, entry->kind, entry->member,
+                  entry->cl);
+    }
+  }
+
+  return res;
+}
+
+void Class::buildMemberIndex() {
+  MemberIndex* index = MemberIndex::create(this);
+  // Another thread may have built the index meanwhile. Keep the first one.
+  if (index != NULL) __sync_bool_compare_and_swap(&memberIndex, NULL, index);
+}
+
 JavaMethod* Class::lookupInterfaceMethodDontThrow(const UTF8* name,
                                                   const UTF8* type) {
   JavaMethod* cur = lookupMethodDontThrow(name, type, false, false, 0);
@@ -375,6 +544,15 @@ JavaMethod* Class::lookupMethodDontThrow(const UTF8* name, const UTF8* type,
                                          Class** methodCl) {
   // This is a dirty hack because of a dirty usage pattern. See UPCALL_METHOD macro...
   if (this == NULL) return NULL;
+
+  MemberIndex* index = getMemberIndex();
+  if (index != NULL) {
+    MemberIndex::Entry* entry = index->lookup(name, type,
+        isStatic ? MemberIndex::StaticMethod : MemberIndex::VirtualMethod);
+    if (entry == NULL || (!recurse && entry->cl != this)) return NULL;
+    if (methodCl) *methodCl = entry->cl;
+    return (JavaMethod*)entry->member;
+  }
   
   JavaMethod* methods = 0;
   uint32 nb = 0;
@@ -437,6 +615,15 @@ JavaField*
 Class::lookupFieldDontThrow(const UTF8* name, const UTF8* type,
                                   bool isStatic, bool recurse,
                                   Class** definingClass) {
+  MemberIndex* index = getMemberIndex();
+  if (index != NULL) {
+    MemberIndex::Entry* entry = index->lookup(name, type,
+        isStatic ? MemberIndex::StaticField : MemberIndex::VirtualField);
+    if (entry == NULL || (!recurse && entry->cl != this)) return NULL;
+    if (definingClass) *definingClass = entry->cl;
+    return (JavaField*)entry->member;
+  }
+
   JavaField* fields = 0;
   uint32 nb = 0;
   if (isStatic) {
@@ -690,6 +877,10 @@ void JavaMethod::initialise(Class* cl, const UTF8* N, const UTF8* T, uint16 A) {
   access = A;
   isCustomizable = false;
   offset = 0;
+  invocationCount = 0;
+  backEdgeCount = 0;
+  tier = BaselineTier;
+  codeSlots = NULL;
 }
 
 void JavaField::initialise(Class* cl, const UTF8* N, const UTF8* T, uint16 A) {
@@ -853,6 +1044,58 @@ void Class::makeVT() {
   virtualVT = new(allocator, virtualTableSize) JavaVirtualTable(this);
 }
 
+void Class::makeReferenceMap() {
+  nbReferenceOffsets = 0;
+  for (Class* cl = this; cl->super != NULL; cl = cl->super) {
+    for (uint32 i = 0; i < cl->nbVirtualFields; ++i) {
+      if (cl->virtualFields[i].isReference()) ++nbReferenceOffsets;
+    }
+  }
+
+  referenceOffsets = NULL;
+  if (nbReferenceOffsets != 0) {
+    referenceOffsets = (uint32*)classLoader->allocator.Allocate(
+        nbReferenceOffsets * sizeof(uint32), "Reference offsets");
+  }
+
+  uint32 index = 0;
+  for (Class* cl = this; cl->super != NULL; cl = cl->super) {
+    for (uint32 i = 0; i < cl->nbVirtualFields; ++i) {
+      JavaField& field = cl->virtualFields[i];
+      if (field.isReference()) referenceOffsets[index++] = field.ptrOffset;
+    }
+  }
+  std::sort(referenceOffsets, referenceOffsets + nbReferenceOffsets);
+
+  referenceBitmap = 0;
+  for (uint32 i = 0; i < nbReferenceOffsets; ++i) {
+    uint32 word = referenceOffsets[i] / sizeof(word_t);
+    if (word >= 64) {
+      referenceBitmap = 0;
+      break;
+    }
+    referenceBitmap |= (uint64)1 << word;
+  }
+
+  // Keep the tracers of java.lang.Object, of references, which do not trace
+  // their referent, and of classes with a native tracer.
+  if (virtualVT->tracer != (word_t)RegularObjectTracer) return;
+
+  switch (nbReferenceOffsets) {
+    case 0: virtualVT->tracer = (word_t)NoReferenceObjectTracer; break;
+    case 1: virtualVT->tracer = (word_t)FixedReferenceObjectTracer1; break;
+    case 2: virtualVT->tracer = (word_t)FixedReferenceObjectTracer2; break;
+    case 3: virtualVT->tracer = (word_t)FixedReferenceObjectTracer3; break;
+    case 4: virtualVT->tracer = (word_t)FixedReferenceObjectTracer4; break;
+    default:
+      if (referenceBitmap != 0) {
+        virtualVT->tracer = (word_t)BitmapObjectTracer;
+      } else {
+        virtualVT->tracer = (word_t)OffsetsObjectTracer;
+      }
+  }
+}
+
 static void computeMirandaMethods(Class* current,
     Class* baseClass, std::vector<JavaMethod*>& mirandaMethods) {
   for (uint32 i = 0; i < current->nbInterfaces; i++) {
@@ -1032,6 +1275,7 @@ void Class::resolveClass() {
   if (isResolved() || isErroneous()) return;
   resolveParents();
   loadExceptions();
+  buildMemberIndex();
   // Do a compare and swap in case another thread initialized the class.
   __sync_val_compare_and_swap(
       &(getCurrentTaskClassMirror().status), loaded, resolved);
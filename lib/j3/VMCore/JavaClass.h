@@ -426,6 +426,65 @@ public:
 };
 
 
+/// MemberIndex - Open addressing hash table of the methods and fields that a
+/// class defines or inherits, keyed by name, type and kind. An entry hides
+/// the entries of the same key in super classes and interfaces, following
+/// the lookup order of Class::lookupMethodDontThrow, so a lookup through the
+/// hierarchy is a single probe. Keys are compared by content: the UTF8s of
+/// two class loaders are not the same objects.
+///
+class MemberIndex : public vmkit::PermanentObject {
+public:
+  enum Kind {
+    VirtualMethod = 0,
+    StaticMethod = 1,
+    VirtualField = 2,
+    StaticField = 3
+  };
+
+  /// Entry - A method or a field, and the class defining it.
+  ///
+  class Entry {
+  public:
+    const UTF8* name;
+    const UTF8* type;
+    void* member;
+    Class* cl;
+    uint32 kind;
+  };
+
+  /// size - The number of entries in the table, a power of two.
+  ///
+  uint32 size;
+
+  /// nbEntries - The number of entries in use. The table is at most half
+  /// full.
+  ///
+  uint32 nbEntries;
+
+  /// entries - The entries of the table.
+  ///
+  Entry* entries;
+
+  /// hash - The hash of a key.
+  ///
+  static uint32 hash(const UTF8* name, const UTF8* type, uint32 kind);
+
+  /// lookup - Find the entry of a key, or NULL.
+  ///
+  Entry* lookup(const UTF8* name, const UTF8* type, uint32 kind);
+
+  /// insert - Add an entry, unless an entry of the same key exists.
+  ///
+  void insert(const UTF8* name, const UTF8* type, uint32 kind, void* member,
+              Class* cl);
+
+  /// create - Build the index of a class, whose super classes and interfaces
+  /// are resolved. Returns NULL if one of them has no index.
+  ///
+  static MemberIndex* create(Class* cl);
+};
+
 /// Class - This class is the representation of Java regular classes (i.e not
 /// array or primitive). Theses classes have a constant pool.
 ///
@@ -532,6 +591,47 @@ public:
 
   uint16_t minJDKVersionMajor, minJDKVersionMinor, minJDKVersionBuild;
 
+  /// memberIndex - The index of the methods and fields of this class, built
+  /// when the class is resolved.
+  ///
+  MemberIndex* memberIndex;
+
+  /// getMemberIndex - Get the index of the methods and fields of this class,
+  /// or NULL if the class is not resolved yet.
+  ///
+  MemberIndex* getMemberIndex() {
+    if (memberIndex == NULL && isResolved()) buildMemberIndex();
+    return memberIndex;
+  }
+
+  /// buildMemberIndex - Build the index of the methods and fields of this
+  /// class, once its super classes and interfaces are resolved.
+  ///
+  void buildMemberIndex();
+
+  /// referenceOffsets - The offsets of the reference fields of instances of
+  /// this class, including inherited fields, in increasing order. Built
+  /// with the layout of the instances.
+  ///
+  uint32* referenceOffsets;
+
+  /// nbReferenceOffsets - The number of reference fields of instances of
+  /// this class.
+  ///
+  uint32 nbReferenceOffsets;
+
+  /// referenceBitmap - If all the reference fields of instances of this
+  /// class are in their first 64 words, bit i is set when word i of an
+  /// instance is a reference. Zero otherwise.
+  ///
+  uint64 referenceBitmap;
+
+  /// makeReferenceMap - Build the reference map of this class, once the
+  /// offsets of its fields are known, and select the tracer of its virtual
+  /// table that uses it.
+  ///
+  void makeReferenceMap();
+
   /// getVirtualSize - Get the virtual size of instances of this class.
   ///
   uint32 getVirtualSize() const { return virtualSize; }
@@ -634,6 +734,10 @@ public:
   /// tracer - Tracer function of instances of Class.
   ///
   void tracer(word_t closure);
+
+  /// traceStaticFields - Trace the reference static fields of this class.
+  ///
+  void traceStaticFields(word_t closure);
   
   ~Class();
   Class();
@@ -895,6 +999,11 @@ public:
   ///
   void* compiledPtr(Class* customizeFor = NULL);
 
+  /// setOptimizedCode - Install the optimized code of this method, and patch
+  /// the recorded entries that still point to the baseline code.
+  ///
+  void setOptimizedCode(void* optimized);
+
   /// setNative - Set the method as native.
   ///
   void setNative();
@@ -940,6 +1049,55 @@ public:
   ///
   uint32 offset;
 
+  /// invocationCount - The number of calls to the baseline code of this
+  /// method.
+  ///
+  uint32 invocationCount;
+
+  /// backEdgeCount - The number of loop back edges taken by the baseline
+  /// code of this method.
+  ///
+  uint32 backEdgeCount;
+
+  /// Tier - The tiers of the code of a method. Baseline code is compiled
+  /// without optimizations and counts invocations and back edges. Once hot,
+  /// the method is recompiled with inlining and the standard optimizations.
+  ///
+  enum Tier {
+    BaselineTier = 0,
+    RecompilingTier = 1,
+    OptimizedTier = 2
+  };
+
+  /// tier - The tier of the code of this method. Baseline code forwards
+  /// calls to the code of the method once it is OptimizedTier.
+  ///
+  uint8 tier;
+
+  /// CodeSlot - An entry of a table that holds the baseline code of a
+  /// method.
+  ///
+  struct CodeSlot {
+    word_t* slot;
+    CodeSlot* next;
+  };
+
+  /// codeSlots - The entries of virtual tables, interface tables and
+  /// constant pools filled with the baseline code of this method. They are
+  /// patched when the method is recompiled.
+  ///
+  CodeSlot* codeSlots;
+
+  /// recordCodeSlots - True when methods may be recompiled, so that the
+  /// entries holding their code must be recorded.
+  ///
+  static bool recordCodeSlots;
+
+  /// addCodeSlot - Record an entry that was just filled with the code of
+  /// this method.
+  ///
+  void addCodeSlot(word_t* slot);
+
   /// lookupAttribute - Look up an attribute in the method's attributes. Returns
   /// null if the attribute is not found.
   ///
@@ -62,6 +62,15 @@ uint32_t JavaObject::hashCode(JavaObject* self) {
   do {
     header = self->header();
     if ((header & HashMask) != 0) break;
+    word_t biasedOwner = vmkit::ThinLock::getBiasedOwnerID(header);
+    if (biasedOwner != 0 &&
+        biasedOwner != JavaThread::get()->getThreadID()) {
+      // The owner of a biased lock writes the header without atomic
+      // operations, and would lose the hash code.
+      vmkit::ThinLock::revokeBias(
+          self, JavaThread::get()->getJVM()->lockSystem, false);
+      continue;
+    }
     word_t newHeader = header | val;
     assert((newHeader & ~HashMask) == header);
     __sync_val_compare_and_swap(&(self->header()), header, newHeader);
@@ -226,6 +226,31 @@ public:
 
 };
 
+/// InterfaceCallCache - The inline cache of an invokeinterface call site
+/// whose IMT entry is a conflict table. The cache maps the virtual table of
+/// receivers to the entry of the conflict table that holds the code to call,
+/// so that calls see the entry when it gets patched.
+///
+class InterfaceCallCache : public vmkit::PermanentObject {
+public:
+  /// NumEntries - Number of receiver virtual tables a call site caches.
+  ///
+  static const uint32_t NumEntries = 4;
+
+  /// VTs - The cached virtual tables. Compiled code compares the virtual
+  /// table of the receiver with each of them.
+  ///
+  JavaVirtualTable* VTs[NumEntries];
+
+  /// slots - The entries of the conflict tables of the cached virtual tables.
+  ///
+  word_t* slots[NumEntries];
+
+  /// add - Cache the entry for the virtual table, if the cache is not full.
+  ///
+  void add(JavaVirtualTable* VT, word_t* slot);
+};
+
 
 /// JavaObject - This class represents a Java object.
 ///
@@ -57,6 +57,13 @@ void Jnjvm::clearObjectReferent(gc* _obj) {
   JavaObjectReference::setReferent(obj, NULL);
 }
 
+uint64_t Jnjvm::getObjectReferenceTimestamp(gc* _obj) {
+  JavaObjectReference* obj = (JavaObjectReference*)_obj;
+  llvm_gcroot(obj, 0);
+  llvm_gcroot(_obj, 0);
+  return JavaObjectReference::getTimestamp(this, obj);
+}
+
 typedef void (*destructor_t)(void*);
 
 void invokeFinalizer(gc* _obj) {
@@ -21,11 +21,15 @@ class Jnjvm;
 class JavaFinalizerThread : public vmkit::FinalizerThread<JavaThread>{
 	public:
 		JavaFinalizerThread(Jnjvm* vm) : FinalizerThread<JavaThread>(vm) {}
+		JavaFinalizerThread(Jnjvm* vm, JavaFinalizerThread* owner) :
+			FinalizerThread<JavaThread>(vm, owner) {}
 };
 
 class JavaReferenceThread : public vmkit::ReferenceThread<JavaThread> {
 public:
 	JavaReferenceThread(Jnjvm* vm) : ReferenceThread<JavaThread>(vm) {}
+	JavaReferenceThread(Jnjvm* vm, JavaReferenceThread* owner) :
+		ReferenceThread<JavaThread>(vm, owner) {}
 };
 
 } // namespace j3
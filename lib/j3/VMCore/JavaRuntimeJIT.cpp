@@ -409,13 +409,16 @@ extern "C" void* j3ResolveVirtualStub(JavaObject* obj) {
   assert(lookup->virtualVT && "Class has no VT");
   assert(lookup->virtualTableSize > Virt->offset && 
          "The method's offset is greater than the virtual table size");
-  ((void**)obj->getVirtualTable())[Virt->offset] = result;
+  word_t* functions = (word_t*)obj->getVirtualTable();
+  functions[Virt->offset] = (word_t)result;
+  Virt->addCodeSlot(&functions[Virt->offset]);
   
   if (isInterface(origMeth->classDef->access)) {
     InterfaceMethodTable* IMT = cl->virtualVT->IMT;
     uint32_t index = InterfaceMethodTable::getIndex(Virt->name, Virt->type);
     if ((IMT->contents[index] & 1) == 0) {
       IMT->contents[index] = (word_t)result;
+      Virt->addCodeSlot(&IMT->contents[index]);
     } else { 
       JavaMethod* Imeth = 
         ctpCl->asClass()->lookupInterfaceMethodDontThrow(utf8, sign->keyName);
@@ -424,6 +427,7 @@ extern "C" void* j3ResolveVirtualStub(JavaObject* obj) {
       uint32 i = 0;
       while (table[i] != (word_t)Imeth) { i += 2; }
       table[i + 1] = (word_t)result;
+      Virt->addCodeSlot(&table[i + 1]);
     }
   }
 
@@ -459,6 +463,7 @@ extern "C" void* j3ResolveStaticStub() {
     
   // Update the entry in the constant pool.
   ctpInfo->ctpRes[ctpIndex] = result;
+  callee->addCodeSlot((word_t*)&ctpInfo->ctpRes[ctpIndex]);
 
   return result;
 }
@@ -500,34 +505,70 @@ extern "C" void* j3ResolveSpecialStub() {
     
   // Update the entry in the constant pool.
   ctpInfo->ctpRes[ctpIndex] = result;
+  callee->addCodeSlot((word_t*)&ctpInfo->ctpRes[ctpIndex]);
 
   return result;
 }
 
-// Does not throw an exception.
-extern "C" void* j3ResolveInterface(JavaObject* obj, JavaMethod* meth, uint32_t index) {
+void InterfaceCallCache::add(JavaVirtualTable* VT, word_t* slot) {
+  // A claimed entry has a virtual table that never matches a receiver.
+  JavaVirtualTable* claimed = (JavaVirtualTable*)1;
+  for (uint32 i = 0; i < NumEntries; ++i) {
+    if (VTs[i] == VT) return;
+    if (VTs[i] == NULL &&
+        __sync_bool_compare_and_swap(&VTs[i], (JavaVirtualTable*)NULL,
+                                     claimed)) {
+      slots[i] = slot;
+      // Compiled code reads the slot once it sees the virtual table.
+      __sync_synchronize();
+      VTs[i] = VT;
+      return;
+    }
+  }
+  // The call site is megamorphic: calls not in the cache go through the
+  // resolver.
+}
+
+// Does not throw an exception. Compiled code only calls the resolver when
+// the IMT entry is a conflict table and the receiver is not in the inline
+// cache of the call site, if any.
+extern "C" void* j3ResolveInterface(JavaObject* obj, JavaMethod* meth,
+                                    uint32_t index, InterfaceCallCache* cache) {
   llvm_gcroot(obj, 0);
-  word_t result = 0;
-  InterfaceMethodTable* IMT = JavaObject::getClass(obj)->virtualVT->IMT;
+  JavaVirtualTable* VT = JavaObject::getClass(obj)->virtualVT;
+  InterfaceMethodTable* IMT = VT->IMT;
+  assert(JavaObject::instanceOf(obj, meth->classDef));
+  assert(meth->classDef->isInterface() ||
+      (meth->classDef == meth->classDef->classLoader->bootstrapLoader->upcalls->OfObject));
+  assert(index == InterfaceMethodTable::getIndex(meth->name, meth->type));
+
   if ((IMT->contents[index] & 1) == 0) {
-    result = IMT->contents[index];
-  } else {
-    word_t* table = (word_t*)(IMT->contents[index] & ~1);
-    uint32 i = 0;
-    while (table[i] != (word_t)meth && table[i] != 0) { i += 2; }
-    assert(table[i] != 0);
-    result = table[i + 1];
+    assert((IMT->contents[index] != 0) && "Bad IMT");
+    return (void*)IMT->contents[index];
   }
-  // TODO(ngeoffray): This code is too performance critical to get asserts.
-  // Ideally, it would be inlined by the compiler, so this method is
-  // only for debugging.
-  //
-  // assert(JavaObject::instanceOf(obj, meth->classDef));
-  // assert(meth->classDef->isInterface() ||
-  //    (meth->classDef == meth->classDef->classLoader->bootstrapLoader->upcalls->OfObject));
-  // assert(index == InterfaceMethodTable::getIndex(meth->name, meth->type));
-  // assert((result != 0) && "Bad IMT");
-  return (void*)result;
+
+  word_t* table = (word_t*)(IMT->contents[index] & ~1);
+  uint32 i = 0;
+  while (table[i] != (word_t)meth && table[i] != 0) { i += 2; }
+  assert(table[i] != 0);
+  assert((table[i + 1] != 0) && "Bad IMT");
+
+  if (cache != NULL) cache->add(VT, &table[i + 1]);
+  return (void*)table[i + 1];
+}
+
+// Does not throw an exception.
+extern "C" void j3HotMethod(JavaMethod* meth) {
+  // Only the first thread to find the method hot recompiles it.
+  if (!__sync_bool_compare_and_swap(&meth->tier, JavaMethod::BaselineTier,
+                                    JavaMethod::RecompilingTier)) {
+    return;
+  }
+
+  // If the method can not be recompiled, it keeps running its baseline code.
+  TRY {
+    meth->classDef->classLoader->getCompiler()->optimizeMethod(meth);
+  } IGNORE;
 }
 
 #if JNJVM_EXECUTE > 0
@@ -14,6 +14,7 @@
 
 #include "JavaClass.h"
 #include "JavaObject.h"
+#include "JavaReferenceQueue.h"
 #include "JavaThread.h"
 #include "JavaString.h"
 #include "JavaUpcalls.h"
@@ -28,6 +29,9 @@ JavaThread::JavaThread(vmkit::VirtualMachine* isolate) : MutatorThread() {
   pendingException = NULL;
   jniEnv = ((Jnjvm*)isolate)->jniEnv;
   localJNIRefs = new JNILocalReferences();
+  globalRefChunk = NULL;
+  weakGlobalRefChunk = NULL;
+  referenceBuffer = NULL;
   currentAddedReferences = NULL;
   javaThread = NULL;
   vmThread = NULL;
@@ -43,6 +47,14 @@ void JavaThread::initialise(JavaObject* thread, JavaObject* vmth) {
 
 JavaThread::~JavaThread() {
   delete localJNIRefs;
+  releaseReferenceBuffer();
+}
+
+void JavaThread::releaseReferenceBuffer() {
+  if (referenceBuffer != NULL) {
+    getJVM()->getReferenceThread()->releaseBuffer(referenceBuffer);
+    referenceBuffer = NULL;
+  }
 }
 
 void JavaThread::throwException(JavaObject* obj) {
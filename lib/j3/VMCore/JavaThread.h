@@ -22,6 +22,10 @@
 #include "JavaObject.h"
 #include "JNIReferences.h"
 
+namespace vmkit {
+  class ReferenceBuffer;
+}
+
 namespace j3 {
 
 class Class;
@@ -130,6 +134,17 @@ public:
   ///
   JNILocalReferences* localJNIRefs;
 
+  /// globalRefChunk, weakGlobalRefChunk - The chunks the thread last
+  /// allocated global references from.
+  ///
+  JNIGlobalReferenceChunk* globalRefChunk;
+  JNIGlobalReferenceChunk* weakGlobalRefChunk;
+
+  /// referenceBuffer - The buffer of the references the thread registered
+  /// since the last collection, allocated on first use.
+  ///
+  vmkit::ReferenceBuffer* referenceBuffer;
+
   /// JNIlocalFrames - vector of JNI Frames
   /// pair represents { oldAddedReferences, capacity }
   ///
@@ -173,6 +188,11 @@ public:
   JavaThread(vmkit::VirtualMachine* isolate);
 
   void initialise(JavaObject* thread, JavaObject* vmth);
+
+  /// releaseReferenceBuffer - Give back the reference buffer of the thread
+  /// when it stops executing Java code.
+  ///
+  void releaseReferenceBuffer();
   
   /// get - Get the current thread as a J3 object.
   ///
@@ -3030,15 +3030,49 @@ jsize GetStringLength(JNIEnv *env, jstring _str) {
 
 
 const jchar *GetStringChars(JNIEnv *env, jstring str, jboolean *isCopy) {
-  NYI();
-  abort();
-  return 0;
+  JavaString* s = 0;
+  const ArrayUInt16* value = 0;
+  llvm_gcroot(s, 0);
+  llvm_gcroot(value, 0);
+
+  BEGIN_JNI_EXCEPTION
+
+  s = *(JavaString**)str;
+  value = JavaString::getValue(s);
+  const jchar* chars = ArrayUInt16::getElements(value) + s->offset;
+
+  if (vmkit::Collector::pin((gc*)value)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI(chars);
+  }
+
+  if (isCopy) (*isCopy) = true;
+  jchar* buffer = (jchar*)malloc(s->count * sizeof(jchar));
+  memcpy(buffer, chars, s->count * sizeof(jchar));
+  RETURN_FROM_JNI(buffer);
+
+  END_JNI_EXCEPTION
+  RETURN_FROM_JNI(0);
 }
 
 
 void ReleaseStringChars(JNIEnv *env, jstring str, const jchar *chars) {
-  NYI();
-  abort();
+  JavaString* s = 0;
+  const ArrayUInt16* value = 0;
+  llvm_gcroot(s, 0);
+  llvm_gcroot(value, 0);
+
+  BEGIN_JNI_EXCEPTION
+
+  s = *(JavaString**)str;
+  value = JavaString::getValue(s);
+  if (chars != ArrayUInt16::getElements(value) + s->offset) {
+    free((void*)chars);
+  }
+
+  END_JNI_EXCEPTION
+
+  RETURN_VOID_FROM_JNI;
 }
 
 
@@ -3351,180 +3385,180 @@ jdoubleArray NewDoubleArray(JNIEnv *env, jsize len) {
 }
 
 
-jboolean* GetBooleanArrayElements(JNIEnv *env, jbooleanArray _array,
-				                          jboolean *isCopy) {
-  ArrayUInt8* array = 0;
+/// getArrayElements - Get the elements of a primitive array. The elements
+/// are returned in place if the collector pins the array, and copied to a
+/// malloc'ed buffer otherwise.
+///
+static void* getArrayElements(JavaObject* array, uint32 logSize,
+                              jboolean* isCopy) {
   llvm_gcroot(array, 0);
-  
-  BEGIN_JNI_EXCEPTION
- 
-  // Local object references.
-  array = *(ArrayUInt8**)_array;
+
+  if (vmkit::Collector::pin((gc*)array)) {
+    if (isCopy) (*isCopy) = false;
+    return JavaArray::getElements(array);
+  }
 
   if (isCopy) (*isCopy) = true;
 
-  sint32 len = ArrayUInt8::getSize(array) * sizeof(uint8);
+  sint32 len = JavaArray::getSize(array) << logSize;
   void* buffer = malloc(len);
-  memcpy(buffer, ArrayUInt8::getElements(array), len);
+  memcpy(buffer, JavaArray::getElements(array), len);
+  return buffer;
+}
 
-  RETURN_FROM_JNI((jboolean*)buffer);
 
-  END_JNI_EXCEPTION
-  RETURN_FROM_JNI(0);
+/// releaseArrayElements - Release the elements returned by getArrayElements,
+/// copying them back to the array if they were copied.
+///
+static void releaseArrayElements(JavaObject* array, void* elems,
+                                 uint32 logSize, jint mode) {
+  llvm_gcroot(array, 0);
+
+  if (elems == JavaArray::getElements(array)) return;
+
+  if (mode != JNI_ABORT) {
+    sint32 len = JavaArray::getSize(array) << logSize;
+    memcpy(JavaArray::getElements(array), elems, len);
+  }
+
+  if (mode != JNI_COMMIT) free(elems);
 }
 
 
-jbyte *GetByteArrayElements(JNIEnv *env, jbyteArray _array, jboolean *isCopy) {
-  ArraySInt8* array = 0;
+jboolean* GetBooleanArrayElements(JNIEnv *env, jbooleanArray _array,
+                                  jboolean *isCopy) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
 
   BEGIN_JNI_EXCEPTION
 
   // Local object references.
-  array = *(ArraySInt8**)_array;
-
-  if (isCopy) (*isCopy) = true;
-
-  sint32 len = ArraySInt8::getSize(array) * sizeof(uint8);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArraySInt8::getElements(array), len);
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jbyte*)buffer);
+  jboolean* res = (jboolean*)getArrayElements(array, 0, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
 }
 
 
-jchar *GetCharArrayElements(JNIEnv *env, jcharArray _array, jboolean *isCopy) {
-  ArrayUInt16* array = 0;
+jbyte* GetByteArrayElements(JNIEnv *env, jbyteArray _array, jboolean *isCopy) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
 
   BEGIN_JNI_EXCEPTION
-  
+
   // Local object references.
-  array = *(ArrayUInt16**)_array;
+  array = *(JavaObject**)_array;
 
-  if (isCopy) (*isCopy) = true;
+  jbyte* res = (jbyte*)getArrayElements(array, 0, isCopy);
+  RETURN_FROM_JNI(res);
 
-  sint32 len = ArrayUInt16::getSize(array) * sizeof(uint16);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArrayUInt16::getElements(array), len);
+  END_JNI_EXCEPTION
+  RETURN_FROM_JNI(0);
+}
 
-  RETURN_FROM_JNI((jchar*)buffer);
+
+jchar* GetCharArrayElements(JNIEnv *env, jcharArray _array, jboolean *isCopy) {
+  JavaObject* array = 0;
+  llvm_gcroot(array, 0);
+
+  BEGIN_JNI_EXCEPTION
+
+  // Local object references.
+  array = *(JavaObject**)_array;
+
+  jchar* res = (jchar*)getArrayElements(array, 1, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
 }
 
 
-jshort *GetShortArrayElements(JNIEnv *env, jshortArray _array,
+jshort* GetShortArrayElements(JNIEnv *env, jshortArray _array,
                               jboolean *isCopy) {
-  ArraySInt16* array = 0;
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
-  
-  // Local object references.
-  array = *(ArraySInt16**)_array;
-  
-  if (isCopy) (*isCopy) = true;
 
-  sint32 len = ArraySInt16::getSize(array) * sizeof(sint16);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArraySInt16::getElements(array), len);
+  // Local object references.
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jshort*)buffer);
+  jshort* res = (jshort*)getArrayElements(array, 1, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
 }
 
 
-jint *GetIntArrayElements(JNIEnv *env, jintArray _array, jboolean *isCopy) {
-  ArraySInt32* array = 0;
+jint* GetIntArrayElements(JNIEnv *env, jintArray _array, jboolean *isCopy) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
 
   BEGIN_JNI_EXCEPTION
-  
-  // Local object references.
-  array = *(ArraySInt32**)_array;
 
-  if (isCopy) (*isCopy) = true;
-
-  sint32 len = ArraySInt32::getSize(array) * sizeof(sint32);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArraySInt32::getElements(array), len);
+  // Local object references.
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jint*)buffer);
+  jint* res = (jint*)getArrayElements(array, 2, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
 }
 
 
-jlong *GetLongArrayElements(JNIEnv *env, jlongArray _array, jboolean *isCopy) {
-  ArrayLong* array = 0;
+jlong* GetLongArrayElements(JNIEnv *env, jlongArray _array, jboolean *isCopy) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
 
   BEGIN_JNI_EXCEPTION
-  
-  // Local object references.
-  array = *(ArrayLong**)_array;
-
-  if (isCopy) (*isCopy) = true;
 
-  sint32 len = ArrayLong::getSize(array) * sizeof(sint64);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArrayLong::getElements(array), len);
+  // Local object references.
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jlong*)buffer);
+  jlong* res = (jlong*)getArrayElements(array, 3, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
 }
 
 
-jfloat *GetFloatArrayElements(JNIEnv *env, jfloatArray _array,
+jfloat* GetFloatArrayElements(JNIEnv *env, jfloatArray _array,
                               jboolean *isCopy) {
-  ArrayFloat* array = 0;
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
 
   BEGIN_JNI_EXCEPTION
-  
-  // Local object references.
-  array = *(ArrayFloat**)_array;
-
-  if (isCopy) (*isCopy) = true;
 
-  sint32 len = ArrayFloat::getSize(array) * sizeof(float);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArrayFloat::getElements(array), len);
+  // Local object references.
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jfloat*)buffer);
+  jfloat* res = (jfloat*)getArrayElements(array, 2, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
 }
 
 
-jdouble *GetDoubleArrayElements(JNIEnv *env, jdoubleArray _array,
-				jboolean *isCopy) {
-  ArrayDouble* array = 0;
+jdouble* GetDoubleArrayElements(JNIEnv *env, jdoubleArray _array,
+                                jboolean *isCopy) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
-  
-  // Local object references.
-  array = *(ArrayDouble**)_array;
-  
-  if (isCopy) (*isCopy) = true;
 
-  sint32 len = ArrayDouble::getSize(array) * sizeof(double);
-  void* buffer = malloc(len);
-  memcpy(buffer, ArrayDouble::getElements(array), len);
+  // Local object references.
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jdouble*)buffer);
+  jdouble* res = (jdouble*)getArrayElements(array, 3, isCopy);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
@@ -3532,193 +3566,129 @@ jdouble *GetDoubleArrayElements(JNIEnv *env, jdoubleArray _array,
 
 
 void ReleaseBooleanArrayElements(JNIEnv *env, jbooleanArray _array,
-				 jboolean *elems, jint mode) {
-  ArrayUInt8* array = 0;
+                                 jboolean *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
-  
-  array = *(ArrayUInt8**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArrayUInt8::getSize(array);
-    memcpy(ArrayUInt8::getElements(array), elems, len);
 
-    if (mode == 0) free(elems);
-  }
-  
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 0, mode);
+
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
-void ReleaseByteArrayElements(JNIEnv *env, jbyteArray _array, jbyte *elems,
-			      jint mode) {
-  ArraySInt16* array = 0;
+void ReleaseByteArrayElements(JNIEnv *env, jbyteArray _array,
+                              jbyte *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
 
-  array = *(ArraySInt16**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArraySInt16::getSize(array);
-    memcpy(ArraySInt16::getElements(array), elems, len);
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 0, mode);
 
-    if (mode == 0) free(elems);
-  }
-  
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
-void ReleaseCharArrayElements(JNIEnv *env, jcharArray _array, jchar *elems,
-			      jint mode) {
-  ArrayUInt16* array = 0;
+void ReleaseCharArrayElements(JNIEnv *env, jcharArray _array,
+                              jchar *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
-  BEGIN_JNI_EXCEPTION
 
-  array = *(ArrayUInt16**)_array;
+  BEGIN_JNI_EXCEPTION
 
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArrayUInt16::getSize(array) << 1;
-    memcpy(ArrayUInt16::getElements(array), elems, len);
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 1, mode);
 
-    if (mode == 0) free(elems);
-  }
-  
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
-void ReleaseShortArrayElements(JNIEnv *env, jshortArray _array, jshort *elems,
-			       jint mode) {
-  ArraySInt16* array = 0;
+void ReleaseShortArrayElements(JNIEnv *env, jshortArray _array,
+                               jshort *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
 
-  array = *(ArraySInt16**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArraySInt16::getSize(array) << 1;
-    memcpy(ArraySInt16::getElements(array), elems, len);
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 1, mode);
 
-    if (mode == 0) free(elems);
-  }
-  
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
-void ReleaseIntArrayElements(JNIEnv *env, jintArray _array, jint *elems,
-			     jint mode) {
-  ArraySInt32* array = 0;
+void ReleaseIntArrayElements(JNIEnv *env, jintArray _array,
+                             jint *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
-    
-  array = *(ArraySInt32**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArraySInt32::getSize(array) << 2;
-    memcpy(ArraySInt32::getElements(array), elems, len);
 
-    if (mode == 0) free(elems);
-  }
-  
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 2, mode);
+
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
-void ReleaseLongArrayElements(JNIEnv *env, jlongArray _array, jlong *elems,
-			      jint mode) {
-  ArrayLong* array = 0;
+void ReleaseLongArrayElements(JNIEnv *env, jlongArray _array,
+                              jlong *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
-    
-  array = *(ArrayLong**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArrayLong::getSize(array) << 3;
-    memcpy(ArrayLong::getElements(array), elems, len);
 
-    if (mode == 0) free(elems);
-  }
-  
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 3, mode);
+
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
-void ReleaseFloatArrayElements(JNIEnv *env, jfloatArray _array, jfloat *elems,
-			       jint mode) {
-  ArrayFloat* array = 0;
+void ReleaseFloatArrayElements(JNIEnv *env, jfloatArray _array,
+                               jfloat *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
 
   BEGIN_JNI_EXCEPTION
-    
-  array = *(ArrayFloat**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArrayFloat::getSize(array) << 2;
-    memcpy(ArrayFloat::getElements(array), elems, len);
 
-    if (mode == 0) free(elems);
-  }
-  
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 2, mode);
+
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
 
 void ReleaseDoubleArrayElements(JNIEnv *env, jdoubleArray _array,
-				jdouble *elems, jint mode) {
-  ArrayDouble* array = 0;
+                                jdouble *elems, jint mode) {
+  JavaObject* array = 0;
   llvm_gcroot(array, 0);
-  
+
   BEGIN_JNI_EXCEPTION
-    
-  array = *(ArrayDouble**)_array;
-  
-  if (mode == JNI_ABORT) {
-    free(elems);
-  } else {
-    sint32 len = ArrayDouble::getSize(array) << 3;
-    memcpy(ArrayDouble::getElements(array), elems, len);
 
-    if (mode == 0) free(elems);
-  }
-  
+  array = *(JavaObject**)_array;
+  releaseArrayElements(array, elems, 3, mode);
+
   END_JNI_EXCEPTION
-  
+
   RETURN_VOID_FROM_JNI;
 }
 
@@ -4144,15 +4114,16 @@ void *GetPrimitiveArrayCritical(JNIEnv *env, jarray _array, jboolean *isCopy) {
   
   array = *(JavaObject**)_array;
 
-  if (isCopy) (*isCopy) = true;
+  if (isCopy) (*isCopy) = false;
 
-  UserClassArray* cl = JavaObject::getClass(array)->asArrayClass();
-  uint32 logSize = cl->baseClass()->asPrimitiveClass()->logSize;
-  sint32 len = JavaArray::getSize(array) << logSize;
-  void* buffer = malloc(len);
-  memcpy(buffer, JavaArray::getElements(array), len);
+  // If the collector may move the array, do not collect until the array is
+  // released.
+  if (!vmkit::Collector::pin((gc*)array)) {
+    th->getJVM()->enterCriticalRegion();
+  }
 
-  RETURN_FROM_JNI((jchar*)buffer);
+  void* res = JavaArray::getElements(array);
+  RETURN_FROM_JNI(res);
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
@@ -4168,15 +4139,10 @@ void ReleasePrimitiveArrayCritical(JNIEnv *env, jarray _array, void *carray,
   
   array = *(JavaObject**)_array;
 
-  if (mode == JNI_ABORT) {
-    free(carray);
-  } else {
-    UserClassArray* cl = JavaObject::getClass(array)->asArrayClass();
-    uint32 logSize = cl->baseClass()->asPrimitiveClass()->logSize;
-    sint32 len = JavaArray::getSize(array) << logSize;
-    memcpy(JavaArray::getElements(array), carray, len);
-
-    if (mode == 0) free(carray);
+  // No collection ran since the array was pinned, so the collector gives the
+  // same answer.
+  if (!vmkit::Collector::pin((gc*)array)) {
+    th->getJVM()->leaveCriticalRegion();
   }
   
   END_JNI_EXCEPTION
@@ -4186,58 +4152,85 @@ void ReleasePrimitiveArrayCritical(JNIEnv *env, jarray _array, void *carray,
 
 
 const jchar *GetStringCritical(JNIEnv *env, jstring string, jboolean *isCopy) {
-  NYI();
-  abort();
-  return 0;
+  JavaString* str = 0;
+  const ArrayUInt16* value = 0;
+  llvm_gcroot(str, 0);
+  llvm_gcroot(value, 0);
+
+  BEGIN_JNI_EXCEPTION
+
+  str = *(JavaString**)string;
+  value = JavaString::getValue(str);
+
+  if (isCopy) (*isCopy) = false;
+
+  if (!vmkit::Collector::pin((gc*)value)) {
+    th->getJVM()->enterCriticalRegion();
+  }
+
+  const jchar* res = ArrayUInt16::getElements(value) + str->offset;
+  RETURN_FROM_JNI(res);
+
+  END_JNI_EXCEPTION
+  RETURN_FROM_JNI(0);
 }
 
 
 void ReleaseStringCritical(JNIEnv *env, jstring string, const jchar *cstring) {
-  NYI();
-  abort();
-}
+  JavaString* str = 0;
+  const ArrayUInt16* value = 0;
+  llvm_gcroot(str, 0);
+  llvm_gcroot(value, 0);
 
-/// FIXME : I copied the code of strong references. We need to implement real
-/// 		weak references.
-///
-jweak NewWeakGlobalRef(JNIEnv* env, jobject obj) {
-	JavaObject* Obj = NULL;
-	  llvm_gcroot(Obj, 0);
+  BEGIN_JNI_EXCEPTION
 
-	  BEGIN_JNI_EXCEPTION
+  str = *(JavaString**)string;
+  value = JavaString::getValue(str);
 
-	  // Local object references.
-	  if (obj) {
-	    Obj = *(JavaObject**)obj;
+  if (!vmkit::Collector::pin((gc*)value)) {
+    th->getJVM()->leaveCriticalRegion();
+  }
+
+  END_JNI_EXCEPTION
 
-	    Jnjvm* vm = JavaThread::get()->getJVM();
+  RETURN_VOID_FROM_JNI;
+}
+
+jweak NewWeakGlobalRef(JNIEnv* env, jobject obj) {
+  JavaObject* Obj = NULL;
+  llvm_gcroot(Obj, 0);
 
+  BEGIN_JNI_EXCEPTION
 
-	    vm->globalRefsLock.lock();
-	    JavaObject** res = vm->globalRefs.addJNIReference(Obj);
-	    vm->globalRefsLock.unlock();
+  // Local object references.
+  if (obj) {
+    Obj = *(JavaObject**)obj;
 
-	    RETURN_FROM_JNI((jweak)(jobject)res);
-	  } else {
-	    RETURN_FROM_JNI(0);
-	  }
+    Jnjvm* vm = th->getJVM();
+    JavaObject** res =
+      vm->weakGlobalRefs.addJNIReference(Obj, &th->weakGlobalRefChunk);
 
-	  END_JNI_EXCEPTION
-	  RETURN_FROM_JNI(0);
+    RETURN_FROM_JNI((jweak)(jobject)res);
+  } else {
+    RETURN_FROM_JNI(0);
+  }
+
+  END_JNI_EXCEPTION
+  RETURN_FROM_JNI(0);
 }
 
 
 void DeleteWeakGlobalRef(JNIEnv* env, jweak ref) {
-	BEGIN_JNI_EXCEPTION
+  BEGIN_JNI_EXCEPTION
 
-	  Jnjvm* vm = myVM(env);
-	  vm->globalRefsLock.lock();
-	  vm->globalRefs.removeJNIReference((JavaObject**)ref);
-	  vm->globalRefsLock.unlock();
+  if (ref) {
+    Jnjvm* vm = myVM(env);
+    vm->weakGlobalRefs.removeJNIReference((JavaObject**)ref);
+  }
 
-	  END_JNI_EXCEPTION
+  END_JNI_EXCEPTION
 
-	  RETURN_VOID_FROM_JNI;
+  RETURN_VOID_FROM_JNI;
 }
 
 
@@ -4251,12 +4244,8 @@ jobject NewGlobalRef(JNIEnv* env, jobject obj) {
   if (obj) {
     Obj = *(JavaObject**)obj;
 
-    Jnjvm* vm = JavaThread::get()->getJVM();
-
-
-    vm->globalRefsLock.lock();
-    JavaObject** res = vm->globalRefs.addJNIReference(Obj);
-    vm->globalRefsLock.unlock();
+    Jnjvm* vm = th->getJVM();
+    JavaObject** res = vm->globalRefs.addJNIReference(Obj, &th->globalRefChunk);
 
     RETURN_FROM_JNI((jobject)res);
   } else {
@@ -4272,10 +4261,10 @@ void DeleteGlobalRef(JNIEnv* env, jobject globalRef) {
   
   BEGIN_JNI_EXCEPTION
   
-  Jnjvm* vm = myVM(env);
-  vm->globalRefsLock.lock();
-  vm->globalRefs.removeJNIReference((JavaObject**)globalRef);
-  vm->globalRefsLock.unlock();
+  if (globalRef) {
+    Jnjvm* vm = myVM(env);
+    vm->globalRefs.removeJNIReference((JavaObject**)globalRef);
+  }
   
   END_JNI_EXCEPTION
   
@@ -4299,12 +4288,6 @@ jboolean ExceptionCheck(JNIEnv *env) {
 
 
 
-jlong GetDirectBufferCapacity(JNIEnv* env, jobject buf) {
-  NYI();
-  abort();
-  return 0;
-}
-
 jobjectRefType GetObjectRefType(JNIEnv* env, jobject obj) {
   NYI();
   abort();
@@ -21,6 +21,7 @@
 #include "vmkit/Thread.h"
 #include "VmkitGC.h"
 
+#include "ClasspathIndex.h"
 #include "ClasspathReflect.h"
 #include "JavaArray.h"
 #include "JavaClass.h"
@@ -35,6 +36,7 @@
 #include "LockedMap.h"
 #include "Reader.h"
 #include "JavaReferenceQueue.h"
+#include "SharedArchive.h"
 #include "VMStaticInstance.h"
 #include "Zip.h"
 
@@ -867,7 +869,7 @@ void ClArgumentsInfo::extractClassFromJar(Jnjvm* vm, int argc, char** argv,
 
   vm->setClasspath(jarFile);
   
-  bytes = Reader::openFile(vm->bootstrapLoader, jarFile);
+  bytes = Reader::openArchive(vm->bootstrapLoader, jarFile);
 
   if (bytes == NULL) {
     printf("Unable to access jarfile %s\n", jarFile);
@@ -956,6 +958,11 @@ void ClArgumentsInfo::printInformation() {
 void ClArgumentsInfo::readArgs(Jnjvm* vm) {
   className = 0;
   appArgumentsPos = 0;
+  compilerThreads = 0;
+  hotThreshold = 0;
+  collectorThreads = 0;
+  finalizerThreads = 1;
+  referenceThreads = 1;
   sint32 i = 1;
   if (i == argc) printInformation();
   while (i < argc) {
@@ -1042,10 +1049,12 @@ void ClArgumentsInfo::readArgs(Jnjvm* vm) {
       nyi();
     } else if (!(strcmp(cur, "-verbose:class"))) {
       nyi();
-    } else if (!(strcmp(cur, "-verbosegc"))) {
-      nyi();
-    } else if (!(strcmp(cur, "-verbose:gc"))) {
+    } else if (!(strcmp(cur, "-verbosegc")) ||
+               !(strcmp(cur, "-verbose:gc"))) {
       vmkit::Collector::verbose = 1;
+      if (vmkit::Collector::logFile == NULL) {
+        vmkit::Collector::logFile = stderr;
+      }
     } else if (!(strcmp(cur, "-verbose:jni"))) {
       nyi();
     } else if (!(strcmp(cur, "-version"))) {
@@ -1058,6 +1067,68 @@ void ClArgumentsInfo::readArgs(Jnjvm* vm) {
       printInformation();
     } else if (!(strcmp(cur, "-X"))) {
       nyi();
+    } else if (!(strncmp(cur, "-Xjit-threads:", 14))) {
+      uint32 len = strlen(cur);
+      if (len == 14) {
+        printInformation();
+      } else {
+        compilerThreads = atoi(&cur[14]);
+      }
+    } else if (!(strcmp(cur, "-Xgc-threads"))) {
+      collectorThreads = vmkit::System::GetNumberOfProcessors();
+    } else if (!(strncmp(cur, "-Xgc-threads:", 13))) {
+      uint32 len = strlen(cur);
+      if (len == 13) {
+        printInformation();
+      } else {
+        collectorThreads = atoi(&cur[13]);
+      }
+    } else if (!(strncmp(cur, "-Xfinalizer-threads:", 20))) {
+      uint32 len = strlen(cur);
+      if (len == 20 || atoi(&cur[20]) < 1) {
+        printInformation();
+      } else {
+        finalizerThreads = atoi(&cur[20]);
+      }
+    } else if (!(strncmp(cur, "-Xreference-threads:", 20))) {
+      uint32 len = strlen(cur);
+      if (len == 20 || atoi(&cur[20]) < 1) {
+        printInformation();
+      } else {
+        referenceThreads = atoi(&cur[20]);
+      }
+    } else if (!(strncmp(cur, "-Xsoftref-ms-per-mb:", 20))) {
+      uint32 len = strlen(cur);
+      if (len == 20) {
+        printInformation();
+      } else {
+        vm->softReferenceMSPerMB = atoi(&cur[20]);
+      }
+    } else if (!(strcmp(cur, "-Xlog:gc"))) {
+      vmkit::Collector::logFile = stdout;
+    } else if (!(strncmp(cur, "-Xlog:gc=", 9))) {
+      uint32 len = strlen(cur);
+      if (len == 9) {
+        printInformation();
+      } else {
+        FILE* fp = fopen(&cur[9], "w");
+        if (fp == NULL) {
+          fprintf(stderr, "Can not open the GC log %s.\n", &cur[9]);
+        } else {
+          vmkit::Collector::logFile = fp;
+        }
+      }
+    } else if (!(strcmp(cur, "-Xgc-self-scan"))) {
+      vm->rendezvous.selfScanStacks = true;
+    } else if (!(strcmp(cur, "-Xjit-tiered"))) {
+      hotThreshold = 10000;
+    } else if (!(strncmp(cur, "-Xjit-tiered:", 13))) {
+      uint32 len = strlen(cur);
+      if (len == 13) {
+        printInformation();
+      } else {
+        hotThreshold = atoi(&cur[13]);
+      }
     } else if (!(strcmp(cur, "-agentlib"))) {
       nyi();
     } else if (!(strcmp(cur, "-agentpath"))) {
@@ -1109,6 +1180,44 @@ void Jnjvm::loadBootstrap() {
   referenceThread = new JavaReferenceThread(this);
   referenceThread->start(
       (void (*)(vmkit::Thread*))JavaReferenceThread::enqueueStart);
+
+  // Threads helping them, which take objects from their queues in batches.
+  for (uint32 i = 1; i < argumentsInfo.finalizerThreads; ++i) {
+    JavaFinalizerThread* worker =
+      new JavaFinalizerThread(this, finalizerThread);
+    finalizerThread->addWorker(worker);
+    worker->start(
+        (void (*)(vmkit::Thread*))JavaFinalizerThread::finalizerStart);
+  }
+
+  for (uint32 i = 1; i < argumentsInfo.referenceThreads; ++i) {
+    JavaReferenceThread* worker =
+      new JavaReferenceThread(this, referenceThread);
+    referenceThread->addWorker(worker);
+    worker->start(
+        (void (*)(vmkit::Thread*))JavaReferenceThread::enqueueStart);
+  }
+
+  // Prefetching of boot classes, if enabled.
+  if (Reader::prefetchCount) {
+    loader->classpathIndex->startPrefetchThread(this);
+  }
+
+  // Compiler threads, if the compiler supports them.
+  if (argumentsInfo.compilerThreads) {
+    loader->getCompiler()->startCompilerThreads(this,
+                                                argumentsInfo.compilerThreads);
+  }
+
+  // Parallel collection, if the collector supports it.
+  if (argumentsInfo.collectorThreads > 1) {
+    vmkit::Collector::startCollectorThreads(argumentsInfo.collectorThreads);
+  }
+
+  // Tiered compilation, if the compiler supports it.
+  if (argumentsInfo.hotThreshold) {
+    loader->getCompiler()->enableTieredCompilation(argumentsInfo.hotThreshold);
+  }
   
   // Initialize the bootstrap class loader if it's not
   // done already.
@@ -1278,6 +1387,21 @@ void Jnjvm::mainJavaStart(JavaThread* thread) {
 
   Jnjvm* vm = thread->getJVM();
   vm->argumentsInfo.readArgs(vm);
+
+  // -Xshare:dump writes the classes loaded by the bootstrap of the VM
+  // instead of running an application.
+  if (SharedArchive::dumpArchive) {
+    vm->mainThread = thread;
+    TRY {
+      vm->loadBootstrap();
+      SharedArchive::dump(vm);
+    } CATCH {
+      fprintf(stderr, "Exception while dumping the shared archive.\n");
+    } END_CATCH;
+    vm->threadSystem.leave();
+    return;
+  }
+
   if (vm->argumentsInfo.className == NULL) {
     vm->threadSystem.leave();
     return;
@@ -1385,28 +1509,48 @@ void Jnjvm::startCollection() {
   referenceThread->SoftReferencesQueue.acquire();
   referenceThread->WeakReferencesQueue.acquire();
   referenceThread->PhantomReferencesQueue.acquire();
+  referenceThread->BuffersLock.acquire();
+  arrayScanNanos = 0;
+  arrayChunksScanned = 0;
 }
 
 void Jnjvm::endCollection() {
+  softReferenceFreeMemory = vmkit::Collector::getFreeMemory();
+  JavaObjectReference::setClock(this, vmkit::System::GetTimeMillis());
+  if (vmkit::Collector::verbose) {
+    fprintf(stderr, "[Soft references: %lld kept, %lld cleared]\n",
+            (long long)softReferencesKept, (long long)softReferencesCleared);
+    fprintf(stderr, "[Reference arrays: %lld us, %lld chunks]\n",
+            (long long)(arrayScanNanos / 1000), (long long)arrayChunksScanned);
+  }
   finalizerThread->FinalizationQueueLock.release();
   referenceThread->ToEnqueueLock.release();
   referenceThread->SoftReferencesQueue.release();
   referenceThread->WeakReferencesQueue.release();
   referenceThread->PhantomReferencesQueue.release();
+  referenceThread->BuffersLock.release();
   finalizerThread->FinalizationCond.broadcast();
   referenceThread->EnqueueCond.broadcast();
 }
   
 void Jnjvm::scanWeakReferencesQueue(word_t closure) {
+  referenceThread->flushBuffers();
   referenceThread->WeakReferencesQueue.scan(referenceThread, closure);
 }
   
 void Jnjvm::scanSoftReferencesQueue(word_t closure) {
+  // The references registered since the last collection are in the buffers
+  // of the threads. The first scan adds them to the queues.
+  referenceThread->flushBuffers();
   referenceThread->SoftReferencesQueue.scan(referenceThread, closure);
 }
   
 void Jnjvm::scanPhantomReferencesQueue(word_t closure) {
+  referenceThread->flushBuffers();
   referenceThread->PhantomReferencesQueue.scan(referenceThread, closure);
+  // Weak global references are cleared after finalization, like phantom
+  // references.
+  weakGlobalRefs.scanWeakReferences(closure);
 }
 
 void Jnjvm::scanFinalizationQueue(word_t closure) {
@@ -1451,6 +1595,14 @@ void Jnjvm::traceObject(gc* _obj, word_t closure) {
   obj->tracer(closure);
 }
 
+extern "C" void ArrayObjectChunkTracer(ArrayObject* obj, uint32 start,
+                                       word_t closure);
+
+// This method is called during GC so no llvm_gcroot needed.
+void Jnjvm::traceArrayChunk(gc* array, uint32_t start, word_t closure) {
+  ArrayObjectChunkTracer((ArrayObject*)array, start, closure);
+}
+
 // This method is called during GC so no llvm_gcroot needed.
 bool Jnjvm::isCorruptedType(gc* obj) {
 	JavaObject* _obj = 0;
@@ -1510,6 +1662,7 @@ const char* Jnjvm::getObjectTypeName(gc* object) {
 
 // Helper function to run J3 without JIT.
 extern "C" int StartJnjvmWithoutJIT(int argc, char** argv, char* mainClass) {
+  vmkit::Thread::initialise(argc, argv);
   vmkit::Collector::initialise(argc, argv);
  
   vmkit::ThreadAllocator allocator; 
@@ -96,6 +96,11 @@ public:
   uint32 appArgumentsPos;
   char* className;
   char* jarFile;
+  uint32 compilerThreads;
+  uint32 hotThreshold;
+  uint32 collectorThreads;
+  uint32 finalizerThreads;
+  uint32 referenceThreads;
   std::vector< std::pair<char*, char*> > agents;
 
   void readArgs(class Jnjvm *vm);
@@ -135,6 +140,7 @@ private:
   virtual void addFinalizationCandidate(gc* obj);
   virtual void finalizeObject(gc* res);
   virtual void traceObject(gc* obj, word_t closure);
+  virtual void traceArrayChunk(gc* array, uint32_t start, word_t closure);
   virtual void setType(gc* header, void* type);
 //  virtual void setType(void* header, void* type);
   virtual void* getType(gc* obj);
@@ -146,6 +152,7 @@ private:
   virtual void clearObjectReferent(gc* ref);
   virtual gc** getObjectReferentPtr(gc* _obj);
   virtual void setObjectReferent(gc* _obj, gc* val);
+  virtual uint64_t getObjectReferenceTimestamp(gc* _obj);
 
   /// CreateError - Creates a Java object of the specified exception class
   /// and calling its <init> function.
@@ -193,6 +200,10 @@ public:
   /// tracer - Traces instances of this class.
   ///
   virtual void tracer(word_t closure);
+
+  /// staticRootsTracer - Traces the static fields of the core classes.
+  ///
+  virtual void staticRootsTracer(word_t closure);
   
   /// dirSeparator - Directory separator for file paths, e.g. '\' for windows,
   /// '/' for Unix.
@@ -249,9 +260,10 @@ public:
   ///
   JNIGlobalReferences globalRefs;
 
-  /// globalRefsLock - Lock for adding a new global reference.
+  /// weakGlobalRefs - Weak global references of JNI, cleared when their
+  /// object is collected.
   ///
-  vmkit::LockNormal globalRefsLock;
+  JNIGlobalReferences weakGlobalRefs;
   
   /// appClassLoader - The bootstrap class loader.
   ///
@@ -30,6 +30,7 @@
 #include "vmkit/Allocator.h"
 
 #include "Classpath.h"
+#include "ClasspathIndex.h"
 #include "ClasspathReflect.h"
 #include "JavaClass.h"
 #include "j3/JavaCompiler.h"
@@ -42,6 +43,7 @@
 #include "JnjvmClassLoader.h"
 #include "LockedMap.h"
 #include "Reader.h"
+#include "SharedArchive.h"
 #include "Zip.h"
 
 
@@ -64,6 +66,7 @@ JnjvmBootstrapLoader::JnjvmBootstrapLoader(vmkit::BumpPtrAllocator& Alloc,
   javaTypes = new(allocator, "TypeMap") TypeMap(); 
   javaSignatures = new(allocator, "SignMap") SignMap();
   strings = new(allocator, "StringList") StringList();
+  classpathIndex = new(allocator, "ClasspathIndex") ClasspathIndex(allocator);
   
   bootClasspathEnv = ClasslibBootEnv;
   libClasspathEnv = ClasslibLibEnv;
@@ -80,6 +83,9 @@ JnjvmBootstrapLoader::JnjvmBootstrapLoader(vmkit::BumpPtrAllocator& Alloc,
   if (!bootLoaded) {
     classes = new(allocator, "ClassMap") ClassMap();
     hashUTF8 = new(allocator, "UTF8Map") UTF8Map(allocator);
+    // Map the shared archive before interning any UTF8, so that the UTF8s
+    // of the archive are the interned ones.
+    if (SharedArchive::useArchive) SharedArchive::attach(this);
     // Analyze the boot classpath, we know bootstrap classes are not in the
     // executable.
     analyseClasspathEnv(bootClasspathEnv);
@@ -257,6 +263,10 @@ ClassBytes* JnjvmBootstrapLoader::openName(const UTF8* utf8) {
       UTF8Buffer(utf8).toCompileName("_bytes")->cString()));
   if (res != NULL) return res;
 
+  res = classpathIndex->openShared(utf8);
+  if (res != NULL) return res;
+
+  // Directories are not indexed, their files are opened on each lookup.
   vmkit::ThreadAllocator threadAllocator;
 
   char* asciiz = (char*)threadAllocator.Allocate(utf8->size + 1);
@@ -277,17 +287,7 @@ ClassBytes* JnjvmBootstrapLoader::openName(const UTF8* utf8) {
     if (res != NULL) return res;
   }
 
-  for (std::vector<ZipArchive*>::iterator i = bootArchives.begin(),
-       e = bootArchives.end(); i != e; ++i) {
-    
-    ZipArchive* archive = *i;
-    char* buf = (char*)threadAllocator.Allocate(alen + 7);
-    sprintf(buf, "%s.class", asciiz);
-    res = Reader::openZip(this, archive, buf);
-    if (res != NULL) return res;
-  }
-
-  return NULL;
+  return classpathIndex->openClass(this, utf8);
 }
 
 
@@ -976,12 +976,13 @@ void JnjvmBootstrapLoader::analyseClasspathEnv(const char* str) {
             temp[len + 1] = 0;
             bootClasspath.push_back(temp);
           } else {
-            bytes = Reader::openFile(this, rp);
+            bytes = Reader::openArchive(this, rp);
             if (bytes) {
               ZipArchive *archive = new(allocator, "ZipArchive")
                 ZipArchive(bytes, allocator);
               if (archive) {
                 bootArchives.push_back(archive);
+                classpathIndex->addArchive(archive);
               }
             }
           }
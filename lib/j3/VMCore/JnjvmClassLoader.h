@@ -33,6 +33,7 @@ class UserClassArray;
 class ClassBytes;
 class ClassMap;
 class Classpath;
+class ClasspathIndex;
 class UserCommonClass;
 class JavaCompiler;
 class JavaMethod;
@@ -377,11 +378,22 @@ private:
   ClassBytes* openName(const UTF8* utf8);
   
 public:
+
+  /// classpathIndex - Index of the classes of bootArchives and of the
+  /// shared archive.
+  ///
+  ClasspathIndex* classpathIndex;
   
-  /// tracer - Traces instances of this class.
+  /// tracer - Traces instances of this class. The static fields of the
+  /// classes are traced by traceStaticFields.
   ///
   virtual void tracer(word_t closure);
 
+  /// traceStaticFields - Trace the static fields of the classes of this
+  /// loader.
+  ///
+  void traceStaticFields(word_t closure);
+
   /// libClasspathEnv - The paths for dynamic libraries of Classpath, separated
   /// by ':'.
   ///
@@ -8,10 +8,17 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "types.h"
 
+#include "vmkit/System.h"
+
 #include "JnjvmClassLoader.h"
 #include "Reader.h"
 #include "Zip.h"
@@ -22,6 +29,31 @@ const int Reader::SeekSet = SEEK_SET;
 const int Reader::SeekCur = SEEK_CUR;
 const int Reader::SeekEnd = SEEK_END;
 
+bool Reader::mapArchives = true;
+uint32 Reader::prefetchCount = 0;
+
+void Reader::initialise(int argc, char** argv) {
+  for (int i = vmkit::System::NextVMOption(argc, argv, 0); i < argc;
+       i = vmkit::System::NextVMOption(argc, argv, i)) {
+    if (!strcmp(argv[i], "-Xzip:copy")) {
+      mapArchives = false;
+    } else if (!strcmp(argv[i], "-Xzip:map")) {
+      mapArchives = true;
+    } else if (!strcmp(argv[i], "-Xzip:prefetch")) {
+      prefetchCount = 8;
+    } else if (!strncmp(argv[i], "-Xzip:prefetch:", 15)) {
+      const char* value = argv[i] + 15;
+      char* end = NULL;
+      long count = strtol(value, &end, 10);
+      if (end == value || *end != 0 || count < 0) {
+        fprintf(stderr, "Invalid prefetch count: %s\n", argv[i]);
+      } else {
+        prefetchCount = count < MaxPrefetchCount ? count : MaxPrefetchCount;
+      }
+    }
+  }
+}
+
 ClassBytes* Reader::openFile(JnjvmClassLoader* loader, const char* path) {
   ClassBytes* res = NULL;
   FILE* fp = fopen(path, "r");
@@ -39,15 +71,33 @@ ClassBytes* Reader::openFile(JnjvmClassLoader* loader, const char* path) {
   return res;
 }
 
+ClassBytes* Reader::openArchive(JnjvmClassLoader* loader, const char* path) {
+  if (!mapArchives) return openFile(loader, path);
+
+  ClassBytes* res = NULL;
+  int fd = open(path, O_RDONLY);
+  if (fd != -1) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr != MAP_FAILED) {
+        // The mapping is never removed: archives live as long as the VM,
+        // and entries stored without compression point into it.
+        res = new (loader->allocator) ClassBytes(st.st_size, (uint8*)addr);
+      }
+    }
+    close(fd);
+  }
+  // Fall back to reading the file if it can not be mapped.
+  if (res == NULL) res = openFile(loader, path);
+  return res;
+}
+
 ClassBytes* Reader::openZip(JnjvmClassLoader* loader, ZipArchive* archive,
                             const char* filename) {
-  ClassBytes* res = 0;
   ZipFile* file = archive->getFile(filename);
   if (file != 0) {
-    res = new (loader->allocator, file->ucsize) ClassBytes(file->ucsize);
-    if (archive->readFile(res, file) != 0) {
-      return res;
-    }
+    return archive->readFile(loader->allocator, file);
   }
   return NULL;
 }
@@ -22,19 +22,33 @@ class JnjvmClassLoader;
 class ZipArchive;
 
 
+/// ClassBytes - The bytes of a file. The bytes either follow the object, or
+/// live elsewhere, for example in an archive mapped in memory.
+///
 class ClassBytes {
  public:
   ClassBytes(int l) {
     size = l;
+    elements = inlineElements;
+  }
+
+  ClassBytes(int l, uint8_t* e) {
+    size = l;
+    elements = e;
   }
 
   void* operator new(size_t sz, vmkit::BumpPtrAllocator& allocator, int n) {
-    return allocator.Allocate(sizeof(uint32_t) + n * sizeof(uint8_t),
+    return allocator.Allocate(sizeof(ClassBytes) + n * sizeof(uint8_t),
                               "Class bytes");
   }
 
+  void* operator new(size_t sz, vmkit::BumpPtrAllocator& allocator) {
+    return allocator.Allocate(sizeof(ClassBytes), "Class bytes slice");
+  }
+
   uint32_t size;
-  uint8_t elements[1];
+  uint8_t* elements;
+  uint8_t inlineElements[1];
 };
 
 class Reader {
@@ -71,7 +85,33 @@ public:
   static const int SeekCur;
   static const int SeekEnd;
 
+  /// mapArchives - Should archives be mapped in memory instead of read?
+  /// True by default, -Xzip:copy reads them.
+  ///
+  static bool mapArchives;
+
+  /// prefetchCount - The number of files following a class in its archive
+  /// that are inflated in advance when the class is loaded. Zero disables
+  /// prefetching, -Xzip:prefetch[:<n>] enables it.
+  ///
+  static uint32 prefetchCount;
+
+  /// MaxPrefetchCount - The largest value of prefetchCount, the size of the
+  /// queue of the prefetch thread.
+  ///
+  static const uint32 MaxPrefetchCount = 256;
+
+  /// initialise - Parse the options of the readers.
+  ///
+  static void initialise(int argc, char** argv);
+
   static ClassBytes* openFile(JnjvmClassLoader* loader, const char* path);
+
+  /// openArchive - Open a file containing an archive. If mapArchives is
+  /// true, the file is mapped read-only and shared with other processes
+  /// through the page cache.
+  ///
+  static ClassBytes* openArchive(JnjvmClassLoader* loader, const char* path);
   static ClassBytes* openZip(JnjvmClassLoader* loader, ZipArchive* archive,
                              const char* filename);
   
@@ -0,0 +1,315 @@
+//===------- SharedArchive.cpp - Archive of classes shared by runs --------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "ClasspathIndex.h"
+#include "JavaClass.h"
+#include "JavaThread.h"
+#include "Jnjvm.h"
+#include "JnjvmClassLoader.h"
+#include "LockedMap.h"
+#include "Reader.h"
+#include "SharedArchive.h"
+#include "vmkit/System.h"
+
+using namespace j3;
+
+bool SharedArchive::dumpArchive = false;
+bool SharedArchive::useArchive = false;
+const char* SharedArchive::archivePath = "j3-classes.jsa";
+const char* SharedArchive::classList = NULL;
+
+/// SharedArchiveHeader - The header of an archive. The UTF8 section holds
+/// UTF8s laid out as in memory, each aligned on four bytes. The class
+/// section holds one SharedArchiveClass per class.
+///
+struct SharedArchiveHeader {
+  uint32 magic;
+  uint32 version;
+  uint64 stamp;
+  uint32 size;
+  uint32 utf8Offset;
+  uint32 utf8End;
+  uint32 classOffset;
+  uint32 nbClasses;
+};
+
+/// SharedArchiveClass - A class of an archive. Offsets are from the start of
+/// the file.
+///
+struct SharedArchiveClass {
+  uint32 name;
+  uint32 nameLength;
+  uint32 bytes;
+  uint32 size;
+};
+
+void SharedArchive::initialise(int argc, char** argv) {
+  bool bootclasspath = false;
+  for (int i = vmkit::System::NextVMOption(argc, argv, 0); i < argc;
+       i = vmkit::System::NextVMOption(argc, argv, i)) {
+    const char* cur = argv[i];
+    if (!strcmp(cur, "-Xshare:dump")) {
+      dumpArchive = true;
+    } else if (!strcmp(cur, "-Xshare:on")) {
+      useArchive = true;
+    } else if (!strcmp(cur, "-Xshare:off")) {
+      useArchive = false;
+    } else if (!strncmp(cur, "-Xshare:file:", 13)) {
+      archivePath = cur + 13;
+    } else if (!strncmp(cur, "-Xshare:classlist:", 18)) {
+      classList = cur + 18;
+    } else if (!strncmp(cur, "-Xbootclasspath", 15)) {
+      bootclasspath = true;
+    }
+  }
+
+  // The boot classpath is only known once the arguments are read, after the
+  // bootstrap loader has interned its first UTF8s.
+  if (bootclasspath) {
+    if (dumpArchive || useArchive) {
+      fprintf(stderr, "Class sharing is disabled with -Xbootclasspath.\n");
+    }
+    dumpArchive = false;
+    useArchive = false;
+  }
+
+  // Do not use the archive being dumped.
+  if (dumpArchive) useArchive = false;
+}
+
+uint64 SharedArchive::classpathStamp(const char* classpath) {
+  uint64 stamp = 14695981039346656037ULL;
+  if (classpath == NULL) return stamp;
+
+  const char* cur = classpath;
+  while (true) {
+    const char* end = strchr(cur, Jnjvm::envSeparator[0]);
+    uint32 length = end ? end - cur : strlen(cur);
+    char path[PATH_MAX];
+    if (length != 0 && length < PATH_MAX) {
+      memcpy(path, cur, length);
+      path[length] = 0;
+      uint64 values[2] = { 0, 0 };
+      struct stat st;
+      if (stat(path, &st) == 0) {
+        values[0] = st.st_size;
+        values[1] = st.st_mtime;
+      }
+      for (uint32 i = 0; i < length; ++i) {
+        stamp = (stamp ^ (uint8)path[i]) * 1099511628211ULL;
+      }
+      for (uint32 i = 0; i < 2; ++i) {
+        stamp = (stamp ^ values[i]) * 1099511628211ULL;
+      }
+    }
+    if (end == NULL) break;
+    cur = end + 1;
+  }
+  return stamp;
+}
+
+/// checkUTF8s - Check that the UTF8s between start and end of an archive
+/// are within these bounds, so that a corrupt or truncated archive is not
+/// read past its UTF8 section.
+///
+static bool checkUTF8s(const uint8* base, uint64 start, uint64 end) {
+  if (start & 3) return false;
+  uint64 offset = start;
+  while (offset < end) {
+    if (offset + sizeof(int32_t) > end) return false;
+    sint32 length = ((const UTF8*)(base + offset))->size;
+    if (length < 0) return false;
+    offset += sizeof(int32_t) + (uint64)length * sizeof(uint16);
+    if (offset > end) return false;
+    offset = (offset + 3) & ~(uint64)3;
+  }
+  return true;
+}
+
+bool SharedArchive::attach(JnjvmBootstrapLoader* loader) {
+  int fd = open(archivePath, O_RDONLY);
+  if (fd == -1) return false;
+
+  struct stat st;
+  uint8* base = NULL;
+  if (fstat(fd, &st) == 0 &&
+      (uint64)st.st_size >= sizeof(SharedArchiveHeader)) {
+    void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) base = (uint8*)addr;
+  }
+  close(fd);
+  if (base == NULL) return false;
+
+  SharedArchiveHeader* header = (SharedArchiveHeader*)base;
+  uint64 size = st.st_size;
+  if (header->magic != Magic || header->version != Version ||
+      header->size != size || header->utf8Offset > header->utf8End ||
+      header->utf8End > size || header->classOffset > size ||
+      (size - header->classOffset) / sizeof(SharedArchiveClass) <
+          header->nbClasses ||
+      header->stamp != classpathStamp(loader->bootClasspathEnv) ||
+      !checkUTF8s(base, header->utf8Offset, header->utf8End)) {
+    fprintf(stderr, "Ignoring the shared archive %s: it does not match this "
+                    "VM or its boot classpath.\n", archivePath);
+    munmap(base, size);
+    return false;
+  }
+
+  // The UTF8s of the archive become the interned UTF8s of the loader.
+  vmkit::UTF8Map* map = loader->hashUTF8;
+  map->lock.lock();
+  uint64 offset = header->utf8Offset;
+  while (offset < header->utf8End) {
+    const UTF8* utf8 = (const UTF8*)(base + offset);
+    vmkit::UTF8MapKey key(utf8->elements, utf8->size);
+    map->map[key] = utf8;
+    offset += sizeof(int32_t) + utf8->size * sizeof(uint16);
+    offset = (offset + 3) & ~(uint64)3;
+  }
+  map->lock.unlock();
+
+  SharedArchiveClass* classes =
+    (SharedArchiveClass*)(base + header->classOffset);
+  for (uint32 i = 0; i < header->nbClasses; ++i) {
+    SharedArchiveClass* cl = &classes[i];
+    if ((uint64)cl->name + cl->nameLength > size ||
+        (uint64)cl->bytes + cl->size > size) {
+      continue;
+    }
+    ClassBytes* bytes = new (loader->allocator)
+      ClassBytes(cl->size, base + cl->bytes);
+    loader->classpathIndex->addShared((const char*)(base + cl->name),
+                                      cl->nameLength, bytes);
+  }
+
+  return true;
+}
+
+static void align(std::vector<uint8>& buffer) {
+  while (buffer.size() & 3) buffer.push_back(0);
+}
+
+static uint32 append(std::vector<uint8>& buffer, const void* data,
+                     uint32 size) {
+  uint32 offset = buffer.size();
+  buffer.insert(buffer.end(), (const uint8*)data, (const uint8*)data + size);
+  return offset;
+}
+
+void SharedArchive::dump(Jnjvm* vm) {
+  JnjvmBootstrapLoader* loader = vm->bootstrapLoader;
+
+  if (classList != NULL) {
+    FILE* fp = fopen(classList, "r");
+    if (fp == NULL) {
+      fprintf(stderr, "Can not open the class list %s.\n", classList);
+    } else {
+      char line[1024];
+      while (fgets(line, sizeof(line), fp) != NULL) {
+        uint32 length = strlen(line);
+        while (length > 0 && (line[length - 1] == '\n' ||
+                              line[length - 1] == '\r' ||
+                              line[length - 1] == ' ')) {
+          line[--length] = 0;
+        }
+        if (length == 0 || line[0] == '#') continue;
+        const UTF8* name = loader->asciizConstructUTF8(line);
+        TRY {
+          loader->loadName(name, true, false, NULL);
+        } IGNORE;
+      }
+      fclose(fp);
+    }
+  }
+
+  std::vector<uint8> buffer;
+  SharedArchiveHeader header;
+  memset(&header, 0, sizeof(header));
+  append(buffer, &header, sizeof(header));
+
+  // UTF8s, laid out as in memory.
+  vmkit::UTF8Map* map = loader->hashUTF8;
+  map->lock.lock();
+  align(buffer);
+  header.utf8Offset = buffer.size();
+  for (vmkit::UTF8Map::iterator i = map->map.begin(), e = map->map.end();
+       i != e; ++i) {
+    const UTF8* utf8 = *i;
+    append(buffer, utf8, sizeof(int32_t) + utf8->size * sizeof(uint16));
+    align(buffer);
+  }
+  header.utf8End = buffer.size();
+  map->lock.unlock();
+
+  // Classes loaded from a file, with their names converted as the loader
+  // converts them to file names.
+  std::vector<Class*> classes;
+  loader->classes->lock.lock();
+  for (ClassMap::iterator i = loader->classes->map.begin(),
+       e = loader->classes->map.end(); i != e; ++i) {
+    CommonClass* cl = i->second;
+    if (cl->isClass() && cl->asClass()->bytes != NULL) {
+      classes.push_back(cl->asClass());
+    }
+  }
+  loader->classes->lock.unlock();
+
+  header.nbClasses = classes.size();
+  header.classOffset = buffer.size();
+  buffer.resize(buffer.size() + classes.size() * sizeof(SharedArchiveClass));
+  for (uint32 i = 0; i < classes.size(); ++i) {
+    Class* cl = classes[i];
+    SharedArchiveClass entry;
+    entry.nameLength = cl->name->size;
+    entry.name = buffer.size();
+    for (sint32 j = 0; j < cl->name->size; ++j) {
+      buffer.push_back((char)cl->name->elements[j]);
+    }
+    entry.size = cl->bytes->size;
+    entry.bytes = append(buffer, cl->bytes->elements, cl->bytes->size);
+    align(buffer);
+    memcpy(&buffer[header.classOffset + i * sizeof(SharedArchiveClass)],
+           &entry, sizeof(entry));
+  }
+
+  header.magic = Magic;
+  header.version = Version;
+  header.stamp = classpathStamp(loader->bootClasspathEnv);
+  header.size = buffer.size();
+  memcpy(&buffer[0], &header, sizeof(header));
+
+  // Write a temporary file and rename it, so that a concurrent run never
+  // maps a partial archive.
+  std::string temp(archivePath);
+  temp += ".tmp";
+  FILE* fp = fopen(temp.c_str(), "w");
+  bool ok = (fp != NULL);
+  if (ok) {
+    ok = (fwrite(&buffer[0], 1, buffer.size(), fp) == buffer.size());
+    ok = (fclose(fp) == 0) && ok;
+  }
+  if (ok) ok = (rename(temp.c_str(), archivePath) == 0);
+  if (!ok) {
+    fprintf(stderr, "Can not write the shared archive %s.\n", archivePath);
+    unlink(temp.c_str());
+    return;
+  }
+  fprintf(stderr, "Dumped %d classes and %d UTF8s to %s.\n",
+          (int)classes.size(), (int)map->map.size(), archivePath);
+}
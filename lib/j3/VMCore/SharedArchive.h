@@ -0,0 +1,84 @@
+//===-------- SharedArchive.h - Archive of classes shared by runs ---------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef J3_SHARED_ARCHIVE_H
+#define J3_SHARED_ARCHIVE_H
+
+#include "types.h"
+
+namespace j3 {
+
+class Jnjvm;
+class JnjvmBootstrapLoader;
+
+/// SharedArchive - A file holding the UTF8s interned by the bootstrap loader
+/// and the bytes of the classes it loaded. It is written by a run with
+/// -Xshare:dump, and runs with -Xshare:on map it instead of interning the
+/// UTF8s again and of looking up and inflating the classes in the boot
+/// archives. The file only contains offsets, so it can be mapped anywhere,
+/// and it is shared read-only between processes.
+///
+/// The archive does not hold parsed classes: archived classes are still
+/// parsed, resolved and given their VTs and IMTs on each run. Classes, VTs
+/// and IMTs point to compiled code, static instances and objects of the
+/// heap, which can not be relocated in a file mapped at any address. Runs
+/// that must skip parsing and resolution use the precompiled classes of
+/// vmjc (Precompiled::Init) instead.
+///
+class SharedArchive {
+public:
+  /// Magic, Version - Identify the files written by this implementation.
+  ///
+  static const uint32 Magic = 0x4A334341;
+  static const uint32 Version = 1;
+
+  /// dumpArchive - Should the VM write an archive and exit? Set with
+  /// -Xshare:dump.
+  ///
+  static bool dumpArchive;
+
+  /// useArchive - Should the bootstrap loader map the archive? Set with
+  /// -Xshare:on, cleared with -Xshare:off.
+  ///
+  static bool useArchive;
+
+  /// archivePath - The file of the archive, set with -Xshare:file:<path>.
+  ///
+  static const char* archivePath;
+
+  /// classList - A file listing the classes to load before dumping, one
+  /// internal name per line, set with -Xshare:classlist:<path>. The classes
+  /// loaded by the bootstrap of the VM are always dumped.
+  ///
+  static const char* classList;
+
+  /// initialise - Parse the -Xshare options.
+  ///
+  static void initialise(int argc, char** argv);
+
+  /// classpathStamp - A hash of the paths, sizes and modification times of
+  /// the entries of a classpath. An archive is only used with the boot
+  /// classpath it was dumped with.
+  ///
+  static uint64 classpathStamp(const char* classpath);
+
+  /// attach - Map the archive, intern its UTF8s in the loader and add its
+  /// classes to the classpath index of the loader. Must be called before
+  /// the loader interns any UTF8. Returns false if there is no valid archive.
+  ///
+  static bool attach(JnjvmBootstrapLoader* loader);
+
+  /// dump - Load the classes of the class list, and write the archive.
+  ///
+  static void dump(Jnjvm* vm);
+};
+
+} // end namespace j3
+
+#endif
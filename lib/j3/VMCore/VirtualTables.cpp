@@ -71,7 +71,9 @@ VirtualTable VMStaticInstance::VT((word_t)VMStaticInstance::staticDestructor,
 // Trace methods for Java objects. There are four types of objects:
 // (1) java.lang.Object and primitive arrays: no need to trace anything.
 // (2) Object whose class is not an array: needs to trace the classloader, and
-//     all the virtual fields.
+//     all the virtual fields. Once the layout of a class is known, its
+//     reference map selects a tracer specialized for its number of
+//     references.
 // (3) Object whose class is an array of objects: needs to trace the class
 //     loader and all elements in the array.
 // (4) Objects that extend java.lang.ref.Reference: must trace the class loader
@@ -103,25 +105,161 @@ extern "C" void RegularObjectTracer(JavaObject* obj, word_t closure) {
   }
 }
 
+/// Trace the class loader of an object of a class with a reference map.
+static inline Class* traceClassLoader(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  Class* cl = JavaObject::getClass(obj)->asClass();
+  assert(cl && "Not a class in reference map tracer");
+  vmkit::Collector::markAndTraceRoot(obj,
+      cl->classLoader->getJavaClassLoaderPtr(), closure);
+  return cl;
+}
+
+/// Method for scanning objects without reference fields.
+extern "C" void NoReferenceObjectTracer(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  traceClassLoader(obj, closure);
+}
+
+/// Method for scanning objects with N reference fields. The loop is unrolled
+/// by the compiler.
+template <uint32 N>
+static inline void traceFixedReferences(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  Class* cl = traceClassLoader(obj, closure);
+  assert(cl->nbReferenceOffsets == N && "Wrong number of references");
+  uint32* offsets = cl->referenceOffsets;
+  for (uint32 i = 0; i < N; ++i) {
+    vmkit::Collector::markAndTrace(
+        obj, (JavaObject**)((word_t)obj + offsets[i]), closure);
+  }
+}
+
+extern "C" void FixedReferenceObjectTracer1(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  traceFixedReferences<1>(obj, closure);
+}
+
+extern "C" void FixedReferenceObjectTracer2(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  traceFixedReferences<2>(obj, closure);
+}
+
+extern "C" void FixedReferenceObjectTracer3(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  traceFixedReferences<3>(obj, closure);
+}
+
+extern "C" void FixedReferenceObjectTracer4(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  traceFixedReferences<4>(obj, closure);
+}
+
+/// Method for scanning objects whose reference fields are all in their first
+/// 64 words.
+extern "C" void BitmapObjectTracer(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  Class* cl = traceClassLoader(obj, closure);
+  uint64 bitmap = cl->referenceBitmap;
+  JavaObject** words = (JavaObject**)obj;
+  while (bitmap != 0) {
+    uint32 word = __builtin_ctzll(bitmap);
+    vmkit::Collector::markAndTrace(obj, words + word, closure);
+    bitmap &= bitmap - 1;
+  }
+}
+
+/// Method for scanning other objects, with the offsets of their reference
+/// fields.
+extern "C" void OffsetsObjectTracer(JavaObject* obj, word_t closure) {
+  llvm_gcroot(obj, 0);
+  Class* cl = traceClassLoader(obj, closure);
+  uint32* offsets = cl->referenceOffsets;
+  for (uint32 i = 0; i < cl->nbReferenceOffsets; ++i) {
+    vmkit::Collector::markAndTrace(
+        obj, (JavaObject**)((word_t)obj + offsets[i]), closure);
+  }
+}
+
+/// The number of elements of a reference array traced as one unit of work.
+/// Larger arrays are split, so that collector threads trace their chunks in
+/// parallel.
+static const uint32 ArrayChunkSize = 4096;
+
+/// Trace the elements of a reference array from start to end. Runs of eight
+/// null elements are skipped with a single test.
+static inline void traceArrayElements(ArrayObject* obj, uint32 start,
+                                      uint32 end, word_t closure) {
+  llvm_gcroot(obj, 0);
+  JavaObject** elements = ArrayObject::getElements(obj);
+  uint32 i = start;
+  while (i < end) {
+    uint32 last = i + 8 <= end ? i + 8 : end;
+    if (last == i + 8) {
+      word_t any = 0;
+      for (uint32 j = i; j < last; ++j) any |= (word_t)elements[j];
+      if (any == 0) {
+        i = last;
+        continue;
+      }
+    }
+    for (; i < last; ++i) {
+      if (elements[i] != NULL) {
+        vmkit::Collector::markAndTrace(obj, elements + i, closure);
+      }
+    }
+  }
+}
+
+/// Account for the time spent scanning a reference array, with -verbose:gc.
+static inline void recordArrayScan(uint64 startTime, uint32 chunks) {
+  vmkit::VirtualMachine* vm = vmkit::Thread::get()->MyVM;
+  __sync_fetch_and_add(&vm->arrayScanNanos,
+                       vmkit::System::GetTimeNanos() - startTime);
+  if (chunks != 0) __sync_fetch_and_add(&vm->arrayChunksScanned, chunks);
+}
+
 /// Method for scanning an array whose elements are JavaObjects. This method is
-/// called for all non-native Java arrays.
+/// called for all non-native Java arrays. The elements after the first chunk
+/// of a large array are traced later, chunk by chunk, if the closure accepts
+/// chunks.
 extern "C" void ArrayObjectTracer(ArrayObject* obj, word_t closure) {
-  JavaObject* elt = 0;
-  llvm_gcroot(elt, 0);
   llvm_gcroot(obj, 0);
   CommonClass* cl = JavaObject::getClass(obj);
   assert(cl && "No class");
   vmkit::Collector::markAndTraceRoot(obj,
       cl->classLoader->getJavaClassLoaderPtr(), closure);
-  
 
-  for (sint32 i = 0; i < ArrayObject::getSize(obj); i++) {
-    elt = ArrayObject::getElement(obj, i);
-    if (elt != NULL) {
-      vmkit::Collector::markAndTrace(
-          obj, ArrayObject::getElements(obj) + i, closure);
+  uint64 startTime =
+    vmkit::Collector::verbose ? vmkit::System::GetTimeNanos() : 0;
+  uint32 size = ArrayObject::getSize(obj);
+  uint32 end = size;
+  uint32 chunks = 0;
+  if (size > ArrayChunkSize &&
+      vmkit::Collector::pushArrayChunk(obj, ArrayChunkSize, closure)) {
+    end = ArrayChunkSize;
+    chunks = 1;
+    for (uint32 start = 2 * ArrayChunkSize;
+         start < size && start > ArrayChunkSize; start += ArrayChunkSize) {
+      vmkit::Collector::pushArrayChunk(obj, start, closure);
     }
-  } 
+  }
+  traceArrayElements(obj, 0, end, closure);
+  if (vmkit::Collector::verbose) recordArrayScan(startTime, chunks);
+}
+
+/// Method for scanning a chunk of a large array whose elements are
+/// JavaObjects, pushed by ArrayObjectTracer.
+extern "C" void ArrayObjectChunkTracer(ArrayObject* obj, uint32 start,
+                                       word_t closure) {
+  llvm_gcroot(obj, 0);
+  uint64 startTime =
+    vmkit::Collector::verbose ? vmkit::System::GetTimeNanos() : 0;
+  uint32 size = ArrayObject::getSize(obj);
+  assert(start < size && "Chunk out of the array");
+  uint32 end = size - start > ArrayChunkSize ? start + ArrayChunkSize : size;
+  traceArrayElements(obj, start, end, closure);
+  if (vmkit::Collector::verbose) recordArrayScan(startTime, 1);
 }
 
 /// Method for scanning Java java.lang.ref.Reference objects.
@@ -190,7 +328,10 @@ void CommonClass::tracer(word_t closure) {
 
 void Class::tracer(word_t closure) {
   CommonClass::tracer(closure);
-  
+  traceStaticFields(closure);
+}
+
+void Class::traceStaticFields(word_t closure) {
   for (uint32 i = 0; i < NR_ISOLATES; ++i) {
     TaskClassMirror &M = IsolateInfo[i];
     if (M.staticInstance != NULL) {
@@ -227,8 +368,12 @@ void JnjvmClassLoader::tracer(word_t closure) {
   for (ClassMap::iterator i = classes->map.begin(), e = classes->map.end();
        i!= e; ++i) {
     CommonClass* cl = i->second;
-    if (cl->isClass()) cl->asClass()->tracer(closure);
-    else cl->tracer(closure);
+    // The static fields of the bootstrap classes are static roots.
+    if (cl->isClass() && this != bootstrapLoader) {
+      cl->asClass()->tracer(closure);
+    } else {
+      cl->tracer(closure);
+    }
   }
   
   StringList* end = strings;
@@ -257,12 +402,23 @@ void JnjvmBootstrapLoader::tracer(word_t closure) {
   upcalls->OfDouble->tracer(closure);
 }
 
+void JnjvmBootstrapLoader::traceStaticFields(word_t closure) {
+  for (ClassMap::iterator i = classes->map.begin(), e = classes->map.end();
+       i!= e; ++i) {
+    CommonClass* cl = i->second;
+    if (cl->isClass()) cl->asClass()->traceStaticFields(closure);
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // Support for scanning the roots of a program: JVM and threads. The JVM
 // must trace:
 // (1) The bootstrap class loader: where core classes live.
 // (2) The applicative class loader: the JVM may be the only one referencing it.
 // (3) Global references from JNI.
+// The static fields of the core classes are traced separately, as static
+// roots. A generational collection with a non-heap write barrier only traces
+// them when it traces the whole heap.
 //
 // The threads must trace:
 // (1) Their stack (already done by the GC in the case of GCMmap2 or Boehm)
@@ -271,6 +427,10 @@ void JnjvmBootstrapLoader::tracer(word_t closure) {
 //===----------------------------------------------------------------------===//
 
 
+void Jnjvm::staticRootsTracer(word_t closure) {
+  bootstrapLoader->traceStaticFields(closure);
+}
+
 void Jnjvm::tracer(word_t closure) {
   JavaObject* jThread = NULL;
   llvm_gcroot(jThread, 0);
@@ -285,14 +445,7 @@ void Jnjvm::tracer(word_t closure) {
   }
   
   // (3) Trace JNI global references.
-  JNIGlobalReferences* start = &globalRefs;
-  while (start != NULL) {
-    for (uint32 i = 0; i < start->length; ++i) {
-      JavaObject** obj = start->globalReferences + i;
-      vmkit::Collector::markAndTraceRoot(NULL, obj, closure);
-    }
-    start = start->next;
-  }
+  globalRefs.tracer(closure);
   
   // (4) Trace the finalization queue.
   for (uint32 i = 0; i < finalizerThread->CurrentFinalizedIndex; ++i) {
@@ -304,7 +457,9 @@ void Jnjvm::tracer(word_t closure) {
     vmkit::Collector::markAndTraceRoot(NULL, referenceThread->ToEnqueue + i, closure);
   }
  
-  // (6) Trace the locks and their associated object.
+  // (6) Trace the locks and their associated object. Idle locks are given
+  // back to the free list, so that their object goes back to a thin lock and
+  // can be collected.
   uint32 i = 0;
   for (; i < vmkit::LockSystem::GlobalSize; i++) {
     vmkit::FatLock** array = lockSystem.LockTable[i];
@@ -313,6 +468,7 @@ void Jnjvm::tracer(word_t closure) {
     for (; j < vmkit::LockSystem::IndexSize; j++) {
       if (array[j] == NULL) break;
       vmkit::FatLock* lock = array[j];
+      if (lock->deflate(lockSystem)) continue;
       jThread = NULL;
       if (vmkit::Thread *th = lock->getOwner()) {
         if (th->isVmkitThread())
@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <vector>
 #include <zlib.h>
 
 #include "vmkit/Allocator.h"
@@ -19,14 +20,49 @@ using namespace j3;
 
 ZipArchive::ZipArchive(ClassBytes* bytes, vmkit::BumpPtrAllocator& A) : allocator(A) {
   this->bytes = bytes;
+  files = NULL;
+  nbFiles = 0;
+  table = NULL;
+  tableSize = 0;
   findOfscd();
   if (ofscd > -1) addFiles();
+  buildTable();
+}
+
+void ZipArchive::buildTable() {
+  tableSize = 16;
+  while (tableSize < 2 * nbFiles) tableSize <<= 1;
+  table = (ZipFile**)allocator.Allocate(tableSize * sizeof(ZipFile*),
+                                        "Zip table");
+  for (uint32 i = 0; i < nbFiles; ++i) {
+    ZipFile* file = files[i];
+    uint32 index = hashName(file->filename, file->filenameLength);
+    while (true) {
+      index &= tableSize - 1;
+      if (table[index] == NULL) {
+        table[index] = file;
+        break;
+      }
+      // Keep the first entry of a name, as the previous implementation did.
+      if (!strcmp(table[index]->filename, file->filename)) break;
+      ++index;
+    }
+  }
 }
 
 ZipFile* ZipArchive::getFile(const char* filename) {
-  table_iterator End = filetable.end();
-  table_iterator I = filetable.find(filename);
-  return I != End ? I->second : 0;
+  uint32 length = strlen(filename);
+  uint32 index = hashName(filename, length);
+  while (true) {
+    index &= tableSize - 1;
+    ZipFile* file = table[index];
+    if (file == NULL) return NULL;
+    if (file->filenameLength == length &&
+        !memcmp(file->filename, filename, length)) {
+      return file;
+    }
+    ++index;
+  }
 }
 
 
@@ -119,12 +155,16 @@ void ZipArchive::findOfscd() {
 
 void ZipArchive::addFiles() {
   sint32 temp = ofscd;
+  std::vector<ZipFile*> entries;
   
   Reader reader(bytes);
   reader.cursor = temp;
 
   while (true) {
-    if (memcmp(bytes->elements + temp, HDR_CENTRAL, 4)) return;
+    if ((uint32)temp + 4 > bytes->size ||
+        memcmp(bytes->elements + temp, HDR_CENTRAL, 4)) {
+      break;
+    }
     ZipFile* ptr = new(allocator, "ZipFile") ZipFile();
     reader.cursor = temp + 4 + C_COMPRESSION_METHOD;
     ptr->compressionMethod = readEndianDep2(reader);
@@ -144,7 +184,7 @@ void ZipArchive::addFiles() {
 
     if ((ptr->filenameLength > 1024) || 
         (reader.max - temp) < ptr->filenameLength)
-      return;
+      break;
 
     ptr->filename = (char*)allocator.Allocate(ptr->filenameLength + 1,
                                               "Zip file name");
@@ -152,33 +192,67 @@ void ZipArchive::addFiles() {
            ptr->filenameLength);
     ptr->filename[ptr->filenameLength] = 0;
 
-    if (ptr->filename[ptr->filenameLength - 1] != PATH_SEPARATOR) {
-      filetable.insert(std::make_pair(ptr->filename, ptr));
+    if (ptr->filenameLength != 0 &&
+        ptr->filename[ptr->filenameLength - 1] != PATH_SEPARATOR) {
+      ptr->index = entries.size();
+      entries.push_back(ptr);
     }
 
     temp = temp + ptr->filenameLength + ptr->extraFieldLength + 
       ptr->fileCommentLength;
   }
+
+  nbFiles = entries.size();
+  files = (ZipFile**)allocator.Allocate(nbFiles * sizeof(ZipFile*),
+                                        "Zip files");
+  for (uint32 i = 0; i < nbFiles; ++i) files[i] = entries[i];
 }
 
-sint32 ZipArchive::readFile(ClassBytes* array, const ZipFile* file) {
-  uint32 bytesLeft = 0;
+sint32 ZipArchive::getDataOffset(const ZipFile* file) {
   uint32 filenameLength = 0;
   uint32 extraFieldLength = 0;
   uint32 temp = 0;
 
+  if ((uint32)file->rolh + 4 + LOCAL_FILE_HEADER_SIZE > bytes->size) return -1;
+  if (memcmp(bytes->elements + file->rolh, HDR_LOCAL, 4)) return -1;
+
   Reader reader(bytes);
-  reader.cursor = file->rolh;
-  
-  if (!(memcmp(bytes->elements + file->rolh, HDR_LOCAL, 4))) {
-    reader.cursor += 4;
-    temp = reader.cursor;
-    reader.cursor += L_FILENAME_LENGTH;
-    filenameLength = readEndianDep2(reader);
-    extraFieldLength = readEndianDep2(reader);
-
-    reader.cursor = 
-      temp + extraFieldLength + filenameLength + LOCAL_FILE_HEADER_SIZE;
+  reader.cursor = file->rolh + 4;
+  temp = reader.cursor;
+  reader.cursor += L_FILENAME_LENGTH;
+  filenameLength = readEndianDep2(reader);
+  extraFieldLength = readEndianDep2(reader);
+
+  return temp + extraFieldLength + filenameLength + LOCAL_FILE_HEADER_SIZE;
+}
+
+bool ZipArchive::isSlice(const ZipFile* file) {
+  return Reader::mapArchives && file->compressionMethod == ZIP_STORE;
+}
+
+ClassBytes* ZipArchive::readFile(vmkit::BumpPtrAllocator& allocator,
+                                 const ZipFile* file) {
+  if (isSlice(file)) {
+    sint32 offset = getDataOffset(file);
+    if (offset == -1 || (uint32)offset + file->ucsize > bytes->size) {
+      return NULL;
+    }
+    return new (allocator) ClassBytes(file->ucsize, bytes->elements + offset);
+  }
+
+  ClassBytes* res = new (allocator, file->ucsize) ClassBytes(file->ucsize);
+  if (readFile(res, file) != 0) return res;
+  return NULL;
+}
+
+sint32 ZipArchive::readFile(ClassBytes* array, const ZipFile* file) {
+  uint32 bytesLeft = 0;
+
+  Reader reader(bytes);
+  sint32 offset = getDataOffset(file);
+
+  if (offset != -1) {
+    reader.cursor = offset;
 
     if (file->compressionMethod == ZIP_STORE) {
       memcpy(array->elements, bytes->elements + reader.cursor, file->ucsize);
@@ -10,13 +10,11 @@
 #ifndef JNJVM_ZIP_H
 #define JNJVM_ZIP_H
 
-#include <map>
-
 #include "vmkit/Allocator.h"
 
 namespace j3 {
 
-class classBytes;
+class ClassBytes;
 class JnjvmBootstrapLoader;
 
 struct ZipFile : public vmkit::PermanentObject {
@@ -28,6 +26,15 @@ struct ZipFile : public vmkit::PermanentObject {
   uint32 fileCommentLength;
   int rolh;
   int compressionMethod;
+
+  /// index - The index of the file in the central directory.
+  ///
+  uint32 index;
+
+  /// prefetched - The bytes of the file, if a prefetch thread inflated them
+  /// before they were requested.
+  ///
+  ClassBytes* prefetched;
 };
 
 
@@ -36,37 +43,62 @@ class ZipArchive : public vmkit::PermanentObject {
   
   vmkit::BumpPtrAllocator& allocator;
 
-  struct ltstr
-  {
-    bool operator()(const char* s1, const char* s2) const
-    {
-      return strcmp(s1, s2) < 0;
-    }
-  };
-  
   int ofscd;
 
+  /// table - Open addressing hash table of the files, indexed by the hash of
+  /// their name. Its size is a power of two and it is at most half full.
+  ///
+  ZipFile** table;
+
+  /// tableSize - The number of slots in the table.
+  ///
+  uint32 tableSize;
+
 public:
-  std::map<const char*, ZipFile*, ltstr> filetable;
-  typedef std::map<const char*, ZipFile*, ltstr>::iterator table_iterator;
+  /// files - The files of the archive, in the order of the central directory.
+  /// Directories are not included.
+  ///
+  ZipFile** files;
+
+  /// nbFiles - The number of files in the archive.
+  ///
+  uint32 nbFiles;
+
   ClassBytes* bytes;
 
+  /// hashName - Hash a file name, or the first length characters of it.
+  ///
+  static uint32 hashName(const char* name, uint32 length) {
+    uint32 hash = 2166136261U;
+    for (uint32 i = 0; i < length; ++i) {
+      hash = (hash ^ (uint8)name[i]) * 16777619U;
+    }
+    return hash;
+  }
+
 private:
   
   void findOfscd();
   void addFiles();
+  void buildTable();
+
+  /// getDataOffset - The offset in bytes of the data of the file, or -1 if
+  /// the local header of the file is invalid.
+  ///
+  sint32 getDataOffset(const ZipFile* file);
   
   void remove();
 
 public:
   
   ~ZipArchive() {
-    for (table_iterator I = filetable.begin(), E = filetable.end(); I != E; 
-         ++I) {
-      allocator.Deallocate((void*)I->first);
-      I->second->~ZipFile();
-      allocator.Deallocate((void*)I->second);
+    for (uint32 i = 0; i < nbFiles; ++i) {
+      allocator.Deallocate((void*)files[i]->filename);
+      files[i]->~ZipFile();
+      allocator.Deallocate((void*)files[i]);
     }
+    allocator.Deallocate((void*)files);
+    allocator.Deallocate((void*)table);
   }
 
   int getOfscd() { return ofscd; }
@@ -74,6 +106,18 @@ public:
   ZipFile* getFile(const char* filename);
   int readFile(ClassBytes* array, const ZipFile* file);
 
+  /// readFile - Get the bytes of the file, or NULL if they can not be read.
+  /// Unless -Xzip:copy is given, the bytes of a file stored without
+  /// compression are not copied: they point into the bytes of the archive.
+  ///
+  ClassBytes* readFile(vmkit::BumpPtrAllocator& allocator,
+                       const ZipFile* file);
+
+  /// isSlice - Does readFile return the bytes of the file without copying
+  /// them?
+  ///
+  bool isSlice(const ZipFile* file);
+
 };
 
 } // end namespace j3
@@ -101,12 +101,17 @@ void CooperativeCollectionRV::join() {
   assert((th->getLastSP() == 0) && "SP present in cooperative code");
 
   th->inRV = true;
+
+  // The stack of this thread does not change until the end of the
+  // rendezvous: record its roots while other threads are still running.
+  if (selfScanStacks) th->recordStackRoots();
   
   lockRV();
   th->setLastSP(System::GetCallerAddress());
   th->joinedRV = true;
   another_mark();
   waitEndOfRV();
+  th->rootSlotsReady = false;
   th->setLastSP(0);
   unlockRV();
   
@@ -9,6 +9,7 @@
 
 #include <cassert>
 
+#include "vmkit/CollectionRV.h"
 #include "vmkit/Cond.h"
 #include "vmkit/Locks.h"
 #include "vmkit/ObjectLocks.h"
@@ -41,38 +42,18 @@ void ThinLock::overflowThinLock(gc* object, LockSystem& table) {
     yieldedValue = __sync_val_compare_and_swap(&(object->header()), oldValue, newValue);
   } while (((object->header()) & ~NonLockBitsMask) != ID);
   assert(obj->associatedObject == object);
+  // Threads parked on the thin lock can now block on the fat lock.
+  table.unparkAll();
 }
- 
-/// initialise - Initialise the value of the lock.
-///
-#if 0
-// Disable fat lock deflation code in ObjectLocks.cpp
-// Fixes occasional assertion failure when running on multi-core machine.
-void ThinLock::removeFatLock(FatLock* fatLock, LockSystem& table) {
-  gc* object = fatLock->associatedObject;
-  llvm_gcroot(object, 0);
-  word_t ID;
-  word_t oldValue = 0;
-  word_t newValue = 0;
-  word_t yieldedValue = 0;
-
-  ID = fatLock->getID();
-  do {
-    oldValue = object->header();
-    newValue = oldValue & NonLockBitsMask;
-    yieldedValue = __sync_val_compare_and_swap(&object->header(), oldValue, newValue);
-  } while (oldValue != yieldedValue);
-  assert((oldValue & NonLockBitsMask) != ID);
-  fatLock->associatedObject = NULL;
-}
-#endif
   
 FatLock* ThinLock::changeToFatlock(gc* object, LockSystem& table) {
   llvm_gcroot(object, 0);
   if (!(object->header() & FatMask)) {
     FatLock* obj = table.allocate(object);
-    uint32 count = (object->header() & ThinCountMask) >> ThinCountShift;
-    obj->acquireAll(object, count + 1);
+    word_t header = object->header();
+    uint32 count = (header & ThinCountMask) >> ThinCountShift;
+    // A biased lock counts the times it is held, a thin lock starts at 0.
+    obj->acquireAll(object, getBiasedOwnerID(header) ? count : count + 1);
     word_t oldValue = 0;
     word_t newValue = 0;
     word_t yieldedValue = 0;
@@ -83,6 +64,8 @@ FatLock* ThinLock::changeToFatlock(gc* object, LockSystem& table) {
       assert(obj->associatedObject == object);
       yieldedValue = __sync_val_compare_and_swap(&(object->header()), oldValue, newValue);
     } while (((object->header()) & ~NonLockBitsMask) != ID);
+    // Threads parked on the thin lock can now block on the fat lock.
+    table.unparkAll();
     return obj;
   } else {
     FatLock* res = table.getFatLockFromID(object->header());
@@ -92,27 +75,6 @@ FatLock* ThinLock::changeToFatlock(gc* object, LockSystem& table) {
   }
 }
 
-void printDebugMessage(gc* object, LockSystem& table) {
-  gc* assObj = NULL;
-  llvm_gcroot(assObj, 0);
-  llvm_gcroot(object, 0);
-  fprintf(stderr,
-      "WARNING: [%p] has been waiting really long for %p (header = %p)\n",
-      (void*)vmkit::Thread::get(),
-      (void*)object,
-      (void*)object->header());
-  FatLock* obj = table.getFatLockFromID(object->header());
-  if (obj != NULL) {
-    fprintf(stderr,
-        "WARNING: [%p] is waiting on fatlock %p. "
-        "Its associated object is %p. The owner is %p\n",
-        (void*)vmkit::Thread::get(),
-        (void*)obj,
-        (void*)(assObj = obj->getAssociatedObject()),
-        (void*)obj->owner());
-  }
-}
-
 void ThinLock::acquire(gc* object, LockSystem& table) {
   llvm_gcroot(object, 0);
   uint64_t id = vmkit::Thread::get()->getThreadID();
@@ -120,6 +82,19 @@ void ThinLock::acquire(gc* object, LockSystem& table) {
   word_t newValue = 0;
   word_t yieldedValue = 0;
 
+  if (getBiasedOwnerID(object->header()) == id) {
+    // Other threads only change the header of an object biased towards this
+    // thread at a rendezvous.
+    oldValue = object->header();
+    if ((oldValue & ThinCountMask) != ThinCountMask) {
+      object->header() = oldValue + ThinCountAdd;
+    } else {
+      changeToFatlock(object, table)->acquireAll(object, 1);
+    }
+    assert(owner(object, table) && "Not owner after quitting acquire!");
+    return;
+  }
+
   if ((object->header() & System::GetThreadIDMask()) == id) {
     assert(owner(object, table) && "Inconsistent lock");
     if ((object->header() & ThinCountMask) != ThinCountMask) {
@@ -136,22 +111,19 @@ void ThinLock::acquire(gc* object, LockSystem& table) {
     return;
   }
 
-  do {
-    oldValue = object->header() & NonLockBitsMask;
-    newValue = oldValue | id;
-    yieldedValue = __sync_val_compare_and_swap(&(object->header()), oldValue, newValue);
-  } while ((object->header() & ~NonLockBitsMask) == 0);
-
-  if (((object->header()) & ~NonLockBitsMask) == id) {
-    assert(owner(object, table) && "Not owner after quitting acquire!");
-    return;
-  }
-
-  // Simple counter to lively diagnose possible dead locks in this code.
-  int counter = 0;  
+  // Bias an object that has never been locked towards this thread. Revoke
+  // the bias of an object biased towards another thread. Spin on a thin
+  // lock held by another thread, backing off exponentially, for at most
+  // table.spinLimit pauses. Past that, set the contended bit of the lock
+  // and park: the owner inflates the lock when releasing it, and parked
+  // threads then block on the fat lock.
+  uint32 spins = 0;
+  uint32 backoff = 1;
+  bool parked = false;
   while (true) {
-    if (object->header() & FatMask) {
-      FatLock* obj = table.getFatLockFromID(object->header());
+    oldValue = object->header();
+    if (oldValue & FatMask) {
+      FatLock* obj = table.getFatLockFromID(oldValue);
       if (obj != NULL) {
         if (obj->acquire(object, table)) {
           assert((object->header() & FatMask) && "Inconsistent lock");
@@ -160,38 +132,39 @@ void ThinLock::acquire(gc* object, LockSystem& table) {
           break;
         }
       }
-    }
-   
-    counter++;
-    if (counter == 1000) printDebugMessage(object, table);
-
-    while (object->header() & ~NonLockBitsMask) {
-      if (object->header() & FatMask) {
-        break;
+    } else if ((oldValue & ~NonLockBitsMask) == 0 ||
+               (oldValue & ~NonLockBitsMask) == BiasedMask) {
+      if ((oldValue & ~NonLockBitsMask) == 0 && table.canBias(object)) {
+        newValue = oldValue | BiasedMask | id | ThinCountAdd;
       } else {
-        vmkit::Thread::yield();
+        newValue = (oldValue & NonLockBitsMask) | id;
       }
-    }
-    
-    if ((object->header() & ~NonLockBitsMask) == 0) {
-      FatLock* obj = table.allocate(object);
-      obj->internalLock.lock();
-      do {
-        oldValue = object->header() & NonLockBitsMask;
-        newValue = oldValue | obj->getID();
-        assert(obj->associatedObject == object);
-        yieldedValue = __sync_val_compare_and_swap(&object->header(), oldValue, newValue);
-      } while ((object->header() & ~NonLockBitsMask) == 0);
-
-      if ((getFatLock(object, table) != obj)) {
-        assert((object->header() & ~NonLockBitsMask) != obj->getID());
-        obj->internalLock.unlock();
-        table.deallocate(obj);
-      } else {
-        assert((object->header() & ~NonLockBitsMask) == obj->getID());
-        assert(owner(object, table) && "Inconsistent lock");
+      yieldedValue = __sync_val_compare_and_swap(&(object->header()), oldValue, newValue);
+      if (yieldedValue == oldValue) {
+        if (spins != 0 && !parked && table.spinLimit < LockSystem::MaxSpin) {
+          table.spinLimit <<= 1;
+        }
         break;
       }
+    } else if (getBiasedOwnerID(oldValue) == id) {
+      // The revocation rebiased the object towards this thread.
+      assert(!(oldValue & ThinCountMask) && "Inconsistent lock");
+      object->header() = oldValue + ThinCountAdd;
+      break;
+    } else if (getBiasedOwnerID(oldValue) != 0) {
+      revokeBias(object, table, true);
+    } else if (spins < table.spinLimit) {
+      for (uint32 i = 0; i < backoff; ++i) {
+        System::SpinPause();
+      }
+      spins += backoff;
+      if (backoff < LockSystem::MaxBackoff) backoff <<= 1;
+    } else {
+      if (!parked && table.spinLimit > LockSystem::MinSpin) {
+        table.spinLimit >>= 1;
+      }
+      parked = true;
+      table.park(object, oldValue);
     }
   }
 
@@ -208,26 +181,36 @@ void ThinLock::release(gc* object, LockSystem& table, vmkit::Thread* ownerThread
   word_t newValue = 0;
   word_t yieldedValue = 0;
 
-  if ((object->header() & ~NonLockBitsMask) == id) {
-    do {
-      oldValue = object->header();
-      newValue = oldValue & NonLockBitsMask;
-      yieldedValue = __sync_val_compare_and_swap(&object->header(), oldValue, newValue);
-    } while ((object->header() & ~NonLockBitsMask) == id);
-  } else if (object->header() & FatMask) {
-    FatLock* obj = table.getFatLockFromID(object->header());
-    assert(obj && "Lock deallocated while held.");
-    obj->release(object, table, ownerThread);
-  } else {
+  if (getBiasedOwnerID(object->header()) == id) {
     assert(((object->header() & ThinCountMask) > 0) && "Inconsistent state");
-    uint32 count = (object->header() & ThinCountMask);
-    do {
-      oldValue = object->header();
-      newValue = oldValue - ThinCountAdd;
-      yieldedValue = __sync_val_compare_and_swap(&(object->header()), oldValue, newValue);
-    } while ((object->header() & ThinCountMask) == count);
+    object->header() = object->header() - ThinCountAdd;
+    return;
   }
 
+  while (true) {
+    oldValue = object->header();
+    if ((oldValue & ~NonLockBitsMask) == id) {
+      // A released thin lock is not biased again.
+      newValue = (oldValue & NonLockBitsMask) | BiasedMask;
+    } else if (oldValue & FatMask) {
+      FatLock* obj = table.getFatLockFromID(oldValue);
+      assert(obj && "Lock deallocated while held.");
+      obj->release(object, table, ownerThread);
+      return;
+    } else if ((oldValue & ~NonLockBitsMask) == (id | ContendedMask)) {
+      // Other threads gave up spinning on the lock and are parked. Inflate
+      // the lock so that they block on the fat lock, and wake them up.
+      assert((ownerThread == vmkit::Thread::get()) && "Inflating a lock for another thread");
+      FatLock* obj = changeToFatlock(object, table);
+      obj->release(object, table, ownerThread);
+      return;
+    } else {
+      assert(((oldValue & ThinCountMask) > 0) && "Inconsistent state");
+      newValue = oldValue - ThinCountAdd;
+    }
+    yieldedValue = __sync_val_compare_and_swap(&(object->header()), oldValue, newValue);
+    if (yieldedValue == oldValue) return;
+  }
 }
 
 /// owner - Returns true if the current thread is the owner of this object's
@@ -240,7 +223,11 @@ bool ThinLock::owner(gc* object, LockSystem& table) {
   } else {
   	bool res = false;
     uint64 id = vmkit::Thread::get()->getThreadID();
-    res = ((object->header() & System::GetThreadIDMask()) == id);
+    word_t header = object->header();
+    if (getBiasedOwnerID(header) != 0) {
+      return (getBiasedOwnerID(header) == id) && (header & ThinCountMask);
+    }
+    res = ((header & System::GetThreadIDMask()) == id);
     if (res) return true;
   }
   return false;
@@ -253,11 +240,69 @@ vmkit::Thread* ThinLock::getOwner(gc* object, LockSystem& table)
 	FatLock* obj = table.getFatLockFromID(object->header());
 	return (!obj) ? NULL : obj->getOwner();
   } else {
-	uint64_t threadID = object->header() & System::GetThreadIDMask();
+	word_t header = object->header();
+	if (getBiasedOwnerID(header) != 0) {
+	  if (!(header & ThinCountMask)) return NULL;
+	  return vmkit::Thread::getByID(getBiasedOwnerID(header));
+	}
+	uint64_t threadID = header & System::GetThreadIDMask();
 	return vmkit::Thread::getByID(threadID);
   }
 }
 
+void ThinLock::revokeBias(gc* object, LockSystem& table, bool rebias) {
+  llvm_gcroot(object, 0);
+  vmkit::Thread* self = vmkit::Thread::get();
+  CollectionRV& rendezvous = self->MyVM->rendezvous;
+
+  rendezvous.startRV();
+  if (rendezvous.getInitiator() != NULL) {
+    // A collection or another revocation is running. Join it, the caller
+    // then looks at the header again.
+    rendezvous.cancelRV();
+    rendezvous.join();
+    return;
+  }
+  rendezvous.synchronize();
+
+  // Other threads are stopped, or run uncooperative code which does not
+  // lock objects.
+  word_t header = object->header();
+  word_t ownerID = getBiasedOwnerID(header);
+  if (ownerID != 0) {
+    BiasInfo* info = table.getBiasInfo(
+        (void*)VirtualTable::getVirtualTable(object), true);
+    if (info != NULL) {
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+      uint32_t now = tv.tv_sec;
+      if (info->revocations < LockSystem::BulkRevokeThreshold &&
+          now - info->lastRevocation > LockSystem::BiasDecayTime) {
+        info->revocations = 0;
+      }
+      info->revocations++;
+      info->lastRevocation = now;
+    }
+
+    word_t nonLock = header & NonLockBitsMask;
+    word_t count = header & ThinCountMask;
+    if (count != 0) {
+      // The owner holds the lock: give it a thin lock.
+      object->header() = nonLock | ownerID | (count - ThinCountAdd);
+    } else if (rebias && info != NULL &&
+               info->revocations >= LockSystem::BulkRebiasThreshold &&
+               info->revocations < LockSystem::BulkRevokeThreshold) {
+      // Objects of the class move from thread to thread: keep them biased,
+      // towards their new user.
+      object->header() = nonLock | BiasedMask | self->getThreadID();
+    } else {
+      object->header() = nonLock | BiasedMask;
+    }
+  }
+
+  rendezvous.finishRV();
+}
+
 /// getFatLock - Get the fat lock is the lock is a fat lock, 0 otherwise.
 FatLock* ThinLock::getFatLock(gc* object, LockSystem& table) {
   llvm_gcroot(object, 0);
@@ -303,15 +348,6 @@ void FatLock::release(gc* obj, LockSystem& table, vmkit::Thread* ownerThread) {
   llvm_gcroot(obj, 0);
   assert(associatedObject && "No associated object when releasing");
   assert(associatedObject == obj && "Mismatch object in lock");
-#if 0
-  // Disable fat lock deflation code in ObjectLocks.cpp
-  // Fixes occasional assertion failure when running on multi-core machine.
-  if (!waitingThreads && !lockingThreads &&
-      internalLock.recursionCount() == 1) {
-    vmkit::ThinLock::removeFatLock(this, table);
-    table.deallocate(this);
-  }
-#endif
   internalLock.unlock(ownerThread);
 }
 
@@ -350,6 +386,27 @@ bool FatLock::acquire(gc* obj, LockSystem& table) {
   return true;
 }
 
+bool FatLock::deflate(LockSystem& table) {
+  gc* obj = associatedObject;
+  llvm_gcroot(obj, 0);
+  if (obj == NULL || associatedObjectIsDead()) return false;
+
+  // The lock is not installed in its object yet: a thread is inflating it.
+  if ((obj->header() & ~ThinLock::NonLockBitsMask) != getID()) return false;
+
+  // Threads blocked on the lock or waiting on it run uncooperative code
+  // during the collection, and have incremented these counters.
+  spinLock.lock();
+  bool idle = (getOwner() == NULL) && (lockingThreads == 0) &&
+              (waitingThreads == 0) && (firstThread == NULL);
+  spinLock.unlock();
+  if (!idle) return false;
+
+  obj->header() =
+    (obj->header() & ThinLock::NonLockBitsMask) | ThinLock::BiasedMask;
+  table.deallocate(this);
+  return true;
+}
 
 void LockSystem::deallocate(FatLock* lock) {
   lock->associatedObject = NULL;
@@ -367,6 +424,61 @@ LockSystem::LockSystem(vmkit::BumpPtrAllocator& all) : allocator(all) {
     allocator.Allocate(IndexSize * sizeof(FatLock*), "Index LockTable");
   currentIndex = 0;
   freeLock = NULL;
+  parkedThreads = 0;
+  biasTable = (BiasInfo*)
+    allocator.Allocate(BiasTableSize * sizeof(BiasInfo), "Bias table");
+  // Spinning is useless if the owner of the lock cannot run meanwhile.
+  spinLimit = (System::GetNumberOfProcessors() > 1) ? 1024 : 0;
+}
+
+void LockSystem::park(gc* object, word_t header) {
+  llvm_gcroot(object, 0);
+  word_t contended = header | ThinLock::ContendedMask;
+  word_t heldMask = ~(ThinLock::NonLockBitsMask | ThinLock::ThinCountMask);
+  parkLock.lock();
+  // Publish that a thread is parked before reading the header. The owner
+  // clears the contended bit before reading parkedThreads, so either it
+  // sees this thread or this thread sees the lock released.
+  __sync_fetch_and_add(&parkedThreads, 1);
+  if (header == contended ||
+      __sync_bool_compare_and_swap(&(object->header()), header, contended)) {
+    while ((object->header() & heldMask) == (contended & heldMask)) {
+      parkCond.wait(&parkLock);
+    }
+  }
+  __sync_fetch_and_sub(&parkedThreads, 1);
+  parkLock.unlock();
+}
+
+BiasInfo* LockSystem::getBiasInfo(void* VT, bool create) {
+  uint32_t index = (uint32_t)((word_t)VT >> 4);
+  for (uint32_t i = 0; i < BiasTableSize; ++i) {
+    BiasInfo* info = &biasTable[(index + i) & (BiasTableSize - 1)];
+    if (info->VT == VT) return info;
+    if (info->VT == NULL) {
+      if (!create) return NULL;
+      info->revocations = 0;
+      info->lastRevocation = 0;
+      info->VT = VT;
+      return info;
+    }
+  }
+  return NULL;
+}
+
+bool LockSystem::canBias(gc* object) {
+  llvm_gcroot(object, 0);
+  if (ThinLock::BiasedMask == 0) return false;
+  BiasInfo* info =
+    getBiasInfo((void*)VirtualTable::getVirtualTable(object), false);
+  return (info == NULL) || (info->revocations < BulkRevokeThreshold);
+}
+
+void LockSystem::unparkAll() {
+  if (parkedThreads == 0) return;
+  parkLock.lock();
+  parkCond.broadcast();
+  parkLock.unlock();
 }
 
 FatLock* LockSystem::allocate(gc* obj) {  
@@ -18,6 +18,8 @@
 
 #include <cassert>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <errno.h>
 #include <pthread.h>
 #include <sys/mman.h>
@@ -123,10 +125,24 @@ uint32_t Thread::getFrameContextLength() {
   return i;
 }
 
+FrameInfo* Thread::IPToFrameInfo(VirtualMachine* vm, word_t ip) {
+  uint32_t index = (uint32_t)(ip ^ (ip >> 8)) & (FrameInfoCacheSize - 1);
+  if (frameInfoIPs[index] == ip) return frameInfos[index];
+  FrameInfo* FI = vm->IPToFrameInfo(ip);
+  // Only cache known return addresses: code may later be registered at an
+  // unknown one.
+  if (FI->ReturnAddress == ip) {
+    frameInfoIPs[index] = ip;
+    frameInfos[index] = FI;
+  }
+  return FI;
+}
+
 FrameInfo* StackWalker::get() {
   if (addr == thread->baseSP) return 0;
   ip = System::GetIPFromCallerAddress(addr);
-  return thread->MyVM->IPToFrameInfo(ip);
+  // Use the cache of the walking thread, which may not be the walked thread.
+  return Thread::get()->IPToFrameInfo(thread->MyVM, ip);
 }
 
 word_t StackWalker::operator*() {
@@ -183,6 +199,16 @@ StackWalker::StackWalker(vmkit::Thread* th) {
 
 
 void Thread::scanStack(word_t closure) {
+  if (rootSlotsReady) {
+    for (uint32_t i = 0; i < nbRootSlots; ++i) {
+      word_t obj = *(word_t*)rootSlots[i];
+      // Verify that obj does not come from a JSR bytecode.
+      if (!(obj & 1)) {
+        Collector::scanObject(NULL, (void**)rootSlots[i], closure);
+      }
+    }
+    return;
+  }
   StackWalker Walker(this);
   while (FrameInfo* MI = Walker.get()) {
     MethodInfoHelper::scan(closure, MI, Walker.ip, Walker.addr);
@@ -190,6 +216,25 @@ void Thread::scanStack(word_t closure) {
   }
 }
 
+void Thread::recordStackRoots() {
+  assert(Thread::get() == this && "Recording the roots of another thread");
+  nbRootSlots = 0;
+  StackWalker Walker(this);
+  while (FrameInfo* MI = Walker.get()) {
+    word_t spaddr = System::GetCallerOfAddress(Walker.addr);
+    if (nbRootSlots + MI->NumLiveOffsets > rootSlotsCapacity) {
+      rootSlotsCapacity = 2 * (nbRootSlots + MI->NumLiveOffsets);
+      rootSlots = (word_t*)realloc(rootSlots,
+                                   rootSlotsCapacity * sizeof(word_t));
+    }
+    for (uint16 i = 0; i < MI->NumLiveOffsets; ++i) {
+      rootSlots[nbRootSlots++] = spaddr + MI->LiveOffsets[i];
+    }
+    ++Walker;
+  }
+  rootSlotsReady = true;
+}
+
 void Thread::enterUncooperativeCode(uint16_t level) {
   if (isVmkitThread()) {
   	if (!inRV) {
@@ -254,10 +299,10 @@ word_t Thread::waitOnSP() {
 
 
 word_t Thread::baseAddr = 0;
+word_t Thread::endAddr = 0;
 
-// These could be set at runtime.
-#define STACK_SIZE 0x100000
-#define NR_THREADS 255
+word_t vmkit::vmkitThreadIDMask = kThreadIDMask;
+word_t vmkit::vmkitStackOverflowMask = ~kThreadIDMask & ~0x3FFFF;
 
 /// StackThreadManager - This class allocates all stacks for threads. Because
 /// we want fast access to thread local data, and can not rely on platform
@@ -266,62 +311,135 @@ word_t Thread::baseAddr = 0;
 /// stack. A simple mask computes the thread local data , based on the current
 /// stack pointer.
 //
-/// The stacks are allocated at boot time. They must all be in the memory range
-/// 0x?0000000 and Ox(?+1)0000000, so that the thread local data can be computed
-/// and threads have a unique ID.
+/// Stacks are aligned on their size, which is a power of two. The memory of
+/// all stacks is reserved at startup, starting at kThreadStart, and the
+/// memory of a stack is only committed when a thread first uses it.
 ///
 class StackThreadManager {
 public:
+  /// stackSize - The size of a stack, a power of two.
+  ///
+  word_t stackSize;
+
+  /// stackSizeLog - log2(stackSize).
+  ///
+  uint32 stackSizeLog;
+
+  /// maxThreads - The number of stacks in the reserved memory.
+  ///
+  uint32 maxThreads;
+
+  /// nextStack - The index of the first stack never used.
+  ///
+  uint32 nextStack;
+
+  /// freeStacks - The indexes of the stacks released by dead threads.
+  ///
+  uint32* freeStacks;
+
+  /// nbFreeStacks - The number of indexes in freeStacks.
+  ///
+  uint32 nbFreeStacks;
+
   word_t baseAddr;
-  uint32 allocPtr;
-  uint32 used[NR_THREADS];
   LockNormal stackLock;
 
   StackThreadManager() {
+    stackSizeLog = 20;
+    stackSize = 1 << stackSizeLog;
+#if ARCH_X64
+    maxThreads = 4096;
+#else
+    maxThreads = 255;
+#endif
+    nextStack = 0;
+    freeStacks = NULL;
+    nbFreeStacks = 0;
     baseAddr = 0;
-    word_t ptr = kThreadStart;
+  }
+
+  /// configure - Set the size of stacks and the maximum number of threads.
+  /// The size is rounded up to a power of two, and can not be lower than
+  /// the size kThreadIDMask has been computed for. Stacks must be aligned on
+  /// their size, so they can not be larger than the alignment of
+  /// kThreadStart.
+  ///
+  void configure(word_t size, uint32 nb) {
+    assert(baseAddr == 0 && "Configuring stacks after creating threads");
+    if (size != 0) {
+      stackSizeLog = 20;
+      while (((word_t)1 << stackSizeLog) < size && stackSizeLog < 28) {
+        ++stackSizeLog;
+      }
+      stackSize = (word_t)1 << stackSizeLog;
+      if (stackSize < size) {
+        fprintf(stderr, "Stack size too large, using %lu MB\n",
+                (unsigned long)(stackSize >> 20));
+      }
+    }
+    if (nb != 0) maxThreads = nb;
+    if ((kThreadMemorySize >> stackSizeLog) < maxThreads) {
+      maxThreads = kThreadMemorySize >> stackSizeLog;
+      fprintf(stderr, "Too many threads, limiting to %u threads\n", maxThreads);
+    }
+    vmkitThreadIDMask = ~(stackSize - 1);
+    vmkitStackOverflowMask = (stackSize - 1) & ~0x3FFFF;
+    // Reserve the memory right now, to avoid conflicts with other allocators.
+    reserve();
+  }
 
-    uint32 flags = MAP_PRIVATE | MAP_ANON | MAP_FIXED;
-    baseAddr = (word_t)mmap((void*)ptr, STACK_SIZE * NR_THREADS,
-                               PROT_READ | PROT_WRITE, flags, -1, 0);
+  /// reserve - Reserve the memory of all stacks.
+  ///
+  void reserve() {
+    uint32 flags = MAP_PRIVATE | MAP_ANON | MAP_FIXED | MAP_NORESERVE;
+    baseAddr = (word_t)mmap((void*)kThreadStart, stackSize * maxThreads,
+                            PROT_NONE, flags, -1, 0);
 
     if (baseAddr == (word_t) MAP_FAILED) {
       fprintf(stderr, "Can not allocate thread memory\n");
       abort();
     }
- 
-    // Protect the page after the alternative stack.
-    uint32 pagesize = System::GetPageSize();
-    for (uint32 i = 0; i < NR_THREADS; ++i) {
-      word_t addr = baseAddr + (i * STACK_SIZE) + pagesize
-        + vmkit::System::GetAlternativeStackSize();
-      mprotect((void*)addr, pagesize, PROT_NONE);
-    }
 
-    memset((void*)used, 0, NR_THREADS * sizeof(uint32));
-    allocPtr = 0;
+    freeStacks = (uint32*)malloc(maxThreads * sizeof(uint32));
+    vmkit::Thread::endAddr = baseAddr + stackSize * maxThreads;
     vmkit::Thread::baseAddr = baseAddr;
   }
 
+  /// commit - Make the memory of a stack usable.
+  ///
+  void commit(word_t addr) {
+    if (mprotect((void*)addr, stackSize, PROT_READ | PROT_WRITE) != 0) {
+      fprintf(stderr, "Can not allocate thread memory\n");
+      abort();
+    }
+    // Protect the page after the alternative stack.
+    uint32 pagesize = System::GetPageSize();
+    addr += pagesize + vmkit::System::GetAlternativeStackSize();
+    mprotect((void*)addr, pagesize, PROT_NONE);
+  }
+
   word_t allocate() {
     stackLock.lock();
-    uint32 myIndex = 0;
-    do {
-      if (!used[myIndex]) {
-        used[myIndex] = 1;
-        break;
-      }
-      ++myIndex;
-    } while (myIndex != NR_THREADS);
-  
+    if (baseAddr == 0) reserve();
+    word_t res = 0;
+    if (nbFreeStacks != 0) {
+      res = baseAddr + ((word_t)freeStacks[--nbFreeStacks] << stackSizeLog);
+    } else if (nextStack != maxThreads) {
+      res = baseAddr + ((word_t)nextStack++ << stackSizeLog);
+      commit(res);
+    }
     stackLock.unlock();
-    
-    if (myIndex != NR_THREADS)
-      return baseAddr + myIndex * STACK_SIZE;
-
-    return 0;
+    return res;
   }
 
+  void release(word_t addr) {
+    // Give the pages of the stack back to the system, they are zeroed when
+    // a new thread uses the stack.
+    madvise((void*)addr, stackSize, MADV_DONTNEED);
+    stackLock.lock();
+    freeStacks[nbFreeStacks++] = (addr - baseAddr) >> stackSizeLog;
+    stackLock.unlock();
+  }
 };
 
 
@@ -329,6 +447,24 @@ public:
 /// machine specific.
 StackThreadManager TheStackManager;
 
+void Thread::initialise(int argc, char** argv) {
+  word_t size = 0;
+  uint32 nb = 0;
+  for (int i = System::NextVMOption(argc, argv, 0); i < argc;
+       i = System::NextVMOption(argc, argv, i)) {
+    if (!strncmp(argv[i], "-Xss", 4)) {
+      size = System::ParseSize(argv[i] + 4);
+      if (size == 0) fprintf(stderr, "Invalid stack size: %s\n", argv[i]);
+    } else if (!strncmp(argv[i], "-ss", 3)) {
+      size = System::ParseSize(argv[i] + 3);
+      if (size == 0) fprintf(stderr, "Invalid stack size: %s\n", argv[i]);
+    } else if (!strncmp(argv[i], "-Xmax-threads:", 14)) {
+      nb = atoi(argv[i] + 14);
+    }
+  }
+  TheStackManager.configure(size, nb);
+}
+
 extern void sigsegvHandler(int, siginfo_t*, void*);
 extern void sigsTermHandler(int n, siginfo_t *info, void *context);
 
@@ -382,7 +518,7 @@ void Thread::internalThreadStart(vmkit::Thread* th) {
 int Thread::start(void (*fct)(vmkit::Thread*)) {
   pthread_attr_t attributs;
   pthread_attr_init(&attributs);
-  pthread_attr_setstack(&attributs, this, STACK_SIZE);
+  pthread_attr_setstack(&attributs, this, TheStackManager.stackSize);
   routine = fct;
   // Make sure to add it in the list of threads before leaving this function:
   // the garbage collector wants to trace this thread.
@@ -411,15 +547,15 @@ void* Thread::operator new(size_t sz) {
 void Thread::releaseThread(vmkit::Thread* th) {
   // It seems like the pthread implementation in Linux is clearing with NULL
   // the stack of the thread. So we have to get the thread id before
-  // calling pthread_join.
+  // calling pthread_join. Same for the root slots.
   void* thread_id = th->internalThreadID;
+  void* rootSlots = th->rootSlots;
   if (thread_id != NULL) {
     // Wait for the thread to die.
     pthread_join((pthread_t)thread_id, NULL);
   }
-  word_t index = ((word_t)th & System::GetThreadIDMask());
-  index = (index & ~TheStackManager.baseAddr) >> 20;
-  TheStackManager.used[index] = 0;
+  free(rootSlots);
+  TheStackManager.release((word_t)th & System::GetThreadIDMask());
 }
 
 void Thread::throwNullPointerException(word_t methodIP)
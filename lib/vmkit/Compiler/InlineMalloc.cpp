@@ -20,6 +20,7 @@
 #include "llvm/Transforms/Utils/Cloning.h"
 
 #include "vmkit/JIT.h"
+#include "VmkitGC.h"
 
 using namespace llvm;
 
@@ -45,6 +46,8 @@ bool InlineMalloc::runOnFunction(Function& F) {
   Function* FieldWriteBarrier = F.getParent()->getFunction("fieldWriteBarrier");
   Function* ArrayWriteBarrier = F.getParent()->getFunction("arrayWriteBarrier");
   Function* NonHeapWriteBarrier = F.getParent()->getFunction("nonHeapWriteBarrier");
+  Function* ArrayCopyWriteBarrier =
+    F.getParent()->getFunction("arrayCopyWriteBarrier");
   bool Changed = false;
   const DataLayout *DL = getAnalysisIfAvailable<DataLayout>();
   for (Function::iterator BI = F.begin(), BE = F.end(); BI != BE; BI++) { 
@@ -58,8 +61,17 @@ bool InlineMalloc::runOnFunction(Function& F) {
       }
       CallSite Call(I);
       Function* Temp = Call.getCalledFunction();
-      if (Temp == VTMalloc ||
-      		Temp == vmkitMalloc) {
+      if (Temp == VTMalloc) {
+        // With allocation buffers, the fast path is small whatever the size,
+        // so that arrays of a size known at runtime are allocated inline
+        // too. Otherwise the whole allocator of MMTk would be inlined.
+        if (vmkit::Collector::hasAllocationBuffers() ||
+            dyn_cast<Constant>(Call.getArgument(0))) {
+          InlineFunctionInfo IFI(NULL, DL);
+          Changed |= InlineFunction(Call, IFI);
+          break;
+        }
+      } else if (Temp == vmkitMalloc) {
         if (dyn_cast<Constant>(Call.getArgument(0))) {
           InlineFunctionInfo IFI(NULL, DL);
           Changed |= InlineFunction(Call, IFI);
@@ -67,7 +79,8 @@ bool InlineMalloc::runOnFunction(Function& F) {
         }
       } else if (Temp == FieldWriteBarrier ||
                  Temp == NonHeapWriteBarrier ||
-                 Temp == ArrayWriteBarrier) {
+                 Temp == ArrayWriteBarrier ||
+                 Temp == ArrayCopyWriteBarrier) {
         InlineFunctionInfo IFI(NULL, DL);
         Changed |= InlineFunction(Call, IFI);
         break;
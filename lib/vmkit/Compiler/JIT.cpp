@@ -246,6 +246,16 @@ void VmkitModule::addCommandLinePasses(FunctionPassManager* PM) {
   PM->doInitialization();
 }
 
+void VmkitModule::addBaselinePasses(FunctionPassManager* PM) {
+  addPass(PM, createVerifierPass());        // Verify that input is correct
+
+  addPass(PM, createCFGSimplificationPass()); // Clean up disgusting code
+  addPass(PM, createPromoteMemoryToRegisterPass());// Kill useless allocas
+  addPass(PM, createInlineMallocPass());
+
+  PM->doInitialization();
+}
+
 LockRecursive VmkitModule::protectEngine;
 
 // We protect the creation of IR with the protectEngine. Note that
@@ -315,7 +325,7 @@ void BaseIntrinsics::init(llvm::Module* module) {
   constantFloatMinusZero = ConstantFP::get(Type::getFloatTy(Context), -0.0f);
   constantThreadIDMask = ConstantInt::get(pointerSizeType, vmkit::System::GetThreadIDMask());
   constantStackOverflowMask = 
-    ConstantInt::get(pointerSizeType, Thread::StackOverflowMask);
+    ConstantInt::get(pointerSizeType, vmkit::System::GetStackOverflowMask());
   constantFatMask = ConstantInt::get(pointerSizeType, ThinLock::FatMask);
   constantPtrOne = ConstantInt::get(pointerSizeType, 1);
   constantPtrZero = ConstantInt::get(pointerSizeType, 0);
@@ -361,6 +371,8 @@ void BaseIntrinsics::init(llvm::Module* module) {
 
   llvm_memcpy_i32 = module->getFunction("llvm.memcpy.i32");
   llvm_memset_i32 = module->getFunction("llvm.memset.i32");
+  llvm_memmove_i32 = module->getFunction("llvm.memmove.p0i8.p0i8.i32");
+  llvm_memmove_i64 = module->getFunction("llvm.memmove.p0i8.p0i8.i64");
   llvm_frameaddress = module->getFunction("llvm.frameaddress");
   llvm_gc_gcroot = module->getFunction("llvm.gcroot");
 
@@ -372,6 +384,7 @@ void BaseIntrinsics::init(llvm::Module* module) {
   assert(AddFinalizationCandidate && "No addFinalizationCandidate function");
 
   ArrayWriteBarrierFunction = module->getFunction("arrayWriteBarrier");
+  ArrayCopyWriteBarrierFunction = module->getFunction("arrayCopyWriteBarrier");
   FieldWriteBarrierFunction = module->getFunction("fieldWriteBarrier");
   NonHeapWriteBarrierFunction = module->getFunction("nonHeapWriteBarrier");
   AllocateFunction = module->getFunction("vmkitgcmalloc");
@@ -382,6 +395,7 @@ void BaseIntrinsics::init(llvm::Module* module) {
 
   AllocateFunction->setGC("vmkit");
   ArrayWriteBarrierFunction->setGC("vmkit");
+  ArrayCopyWriteBarrierFunction->setGC("vmkit");
   FieldWriteBarrierFunction->setGC("vmkit");
   NonHeapWriteBarrierFunction->setGC("vmkit");
 }
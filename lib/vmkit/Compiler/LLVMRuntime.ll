@@ -43,6 +43,8 @@ declare float  @fabsf(float)
 
 declare void @llvm.memcpy.i32(i8 *, i8 *, i32, i32) nounwind
 declare void @llvm.memset.i32(i8 *, i8, i32, i32) nounwind
+declare void @llvm.memmove.p0i8.p0i8.i32(i8 *, i8 *, i32, i32, i1) nounwind
+declare void @llvm.memmove.p0i8.p0i8.i64(i8 *, i8 *, i64, i32, i1) nounwind
 declare i8*  @llvm.frameaddress(i32) nounwind readnone
 
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
@@ -66,6 +68,7 @@ declare i8* @vmkitgcmalloc(i32, i8*)
 declare i8* @vmkitgcmallocUnresolved(i32, i8*)
 declare void @addFinalizationCandidate(i8*)
 declare void @arrayWriteBarrier(i8*, i8**, i8*)
+declare void @arrayCopyWriteBarrier(i8*, i8**, i8*, i8**, i32)
 declare void @fieldWriteBarrier(i8*, i8**, i8*)
 declare void @nonHeapWriteBarrier(i8**, i8*)
 ;;;;;;;;;;;;;;; Optimized Allocators for VT based Object Layout ;;;;;;;;;;;;;;;
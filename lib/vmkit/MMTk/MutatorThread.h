@@ -21,6 +21,9 @@ public:
   MutatorThread() : vmkit::Thread() {
     MutatorContext = 0;
     CollectionAttempts = 0;
+    CollectorContext = 0;
+    TLABCursor = 0;
+    TLABLimit = 0;
   }
   vmkit::ThreadAllocator Allocator;
   word_t MutatorContext;
@@ -31,6 +34,30 @@ public:
 
   uint32_t CollectionAttempts;
 
+  /// CollectorContext - The collector context of this thread while it takes
+  /// part in a collection.
+  ///
+  word_t CollectorContext;
+
+  /// TLABCursor - The next free byte of the allocation buffer of the thread.
+  /// Compiled code allocates objects by bumping it, and only calls the
+  /// collector when the buffer is exhausted.
+  ///
+  word_t TLABCursor;
+
+  /// TLABLimit - The end of the allocation buffer of the thread, or 0 if the
+  /// thread has no buffer.
+  ///
+  word_t TLABLimit;
+
+  /// resetTLAB - Drop the allocation buffer of the thread. The memory of
+  /// the buffer is reclaimed by the next collection.
+  ///
+  void resetTLAB() {
+    TLABCursor = 0;
+    TLABLimit = 0;
+  }
+
   static void init(Thread* _th);
 
   static MutatorThread* get() {
@@ -11,6 +11,7 @@
 #include "MutatorThread.h"
 #include "vmkit/VirtualMachine.h"
 
+#include <cstring>
 #include <set>
 
 using namespace vmkit;
@@ -18,6 +19,7 @@ using namespace vmkit;
 static vmkit::SpinLock lock;
 std::set<gc*> __InternalSet__;
 int Collector::verbose = 0;
+FILE* Collector::logFile = NULL;
 
 extern "C" void* prealloc(uint32_t sz) {
   gc* res = 0;
@@ -130,6 +132,11 @@ bool Collector::isLive(gc* ptr, word_t closure) {
   return false;
 }
 
+bool Collector::pin(gc* ptr) {
+  // Objects allocated with malloc never move.
+  return true;
+}
+
 void Collector::scanObject(FrameInfo* FI, void** ptr, word_t closure) {
   abort();
 }
@@ -142,6 +149,10 @@ void Collector::markAndTraceRoot(void* source, void* ptr, word_t closure) {
   abort();
 }
 
+bool Collector::pushArrayChunk(gc* array, uint32_t start, word_t closure) {
+  return false;
+}
+
 gc* Collector::retainForFinalize(gc* val, word_t closure) {
   abort();
   return NULL;
@@ -171,6 +182,11 @@ extern "C" void arrayWriteBarrier(void* ref, void** ptr, void* value) {
   *ptr = value;
 }
 
+extern "C" void arrayCopyWriteBarrier(void* src, void** srcPtr, void* dst,
+                                      void** dstPtr, uint32_t count) {
+  memmove(dstPtr, srcPtr, count * sizeof(void*));
+}
+
 extern "C" void fieldWriteBarrier(void* ref, void** ptr, void* value) {
   *ptr = value;
 }
@@ -214,6 +230,30 @@ void Collector::collect() {
 void Collector::initialise(int argc, char** argv) {
 }
 
+void Collector::startCollectorThreads(uint32_t nbThreads) {
+  // Nothing to do, there is no collection.
+}
+
+size_t Collector::getMaxMemory() {
+  return 0;
+}
+
+size_t Collector::getFreeMemory() {
+  return 0;
+}
+
+size_t Collector::getTotalMemory() {
+  return 0;
+}
+
+uint64_t Collector::getCollectionCount() {
+  return 0;
+}
+
+uint64_t Collector::getCollectionTime() {
+  return 0;
+}
+
 bool Collector::needsWriteBarrier() {
   return false;
 }
@@ -221,3 +261,7 @@ bool Collector::needsWriteBarrier() {
 bool Collector::needsNonHeapWriteBarrier() {
   return false;
 }
+
+bool Collector::hasAllocationBuffers() {
+  return false;
+}
@@ -13,6 +13,7 @@
 
 #include "vmkit/GC.h"
 #include "vmkit/Locks.h"
+#include <cstdio>
 #include <cstdlib>
 
 extern "C" void* vmkitgcmallocUnresolved(uint32_t sz, void* type);
@@ -32,6 +33,8 @@ public:
 };
 
 extern "C" void arrayWriteBarrier(void* ref, void** ptr, void* value);
+extern "C" void arrayCopyWriteBarrier(void* src, void** srcPtr, void* dst,
+                                      void** dstPtr, uint32_t count);
 extern "C" void fieldWriteBarrier(void* ref, void** ptr, void* value);
 extern "C" void nonHeapWriteBarrier(void** ptr, void* value);
 
@@ -41,10 +44,22 @@ class Collector {
 public:
   static int verbose;
 
+  /// logFile - The file of the event log of collections, or NULL if
+  /// collections are not logged. Set by -verbose:gc and -Xlog:gc.
+  ///
+  static FILE* logFile;
+
   static bool isLive(gc* ptr, word_t closure) __attribute__ ((always_inline)); 
   static void scanObject(FrameInfo* FI, void** ptr, word_t closure) __attribute__ ((always_inline));
   static void markAndTrace(void* source, void* ptr, word_t closure) __attribute__ ((always_inline));
   static void markAndTraceRoot(void* source, void* ptr, word_t closure) __attribute__ ((always_inline));
+
+  /// pushArrayChunk - Ask the closure to trace the elements of a reference
+  /// array from start to the end of their chunk later, possibly in another
+  /// collector thread. Returns false if the closure does not split arrays.
+  ///
+  static bool pushArrayChunk(gc* array, uint32_t start, word_t closure);
+
   static gc*  retainForFinalize(gc* val, word_t closure) __attribute__ ((always_inline));
   static gc*  retainReferent(gc* val, word_t closure) __attribute__ ((always_inline));
   static gc*  getForwardedFinalizable(gc* val, word_t closure) __attribute__ ((always_inline));
@@ -57,21 +72,46 @@ public:
   static bool needsWriteBarrier() __attribute__ ((always_inline));
   static bool needsNonHeapWriteBarrier() __attribute__ ((always_inline));
 
+  /// hasAllocationBuffers - Do threads allocate objects in their own
+  /// buffers? The allocation fast path is then small enough to be inlined
+  /// whatever the size of the object.
+  ///
+  static bool hasAllocationBuffers();
+
   static void collect();
+
+  /// pin - Ask the collector to never move the object. Returns false if the
+  /// object may still move, for example when it is in a copying space.
+  ///
+  static bool pin(gc* ptr);
   
   static void initialise(int argc, char** argv);
+
+  /// startCollectorThreads - Start the threads that help the thread
+  /// triggering a collection, so that nbThreads threads collect in parallel.
+  ///
+  static void startCollectorThreads(uint32_t nbThreads);
   
-  static int getMaxMemory() {
-    return 0;
-  }
-  
-  static int getFreeMemory() {
-    return 0;
-  }
-  
-  static int getTotalMemory() {
-    return 0;
-  }
+  /// getMaxMemory - The maximum size of the heap, as set by -Xmx.
+  ///
+  static size_t getMaxMemory();
+
+  /// getFreeMemory - The memory of the current heap not used by objects.
+  ///
+  static size_t getFreeMemory();
+
+  /// getTotalMemory - The current size of the heap.
+  ///
+  static size_t getTotalMemory();
+
+  /// getCollectionCount - The number of collections since the start.
+  ///
+  static uint64_t getCollectionCount();
+
+  /// getCollectionTime - The total pause time of the collections, in
+  /// nanoseconds.
+  ///
+  static uint64_t getCollectionTime();
 
   void setMaxMemory(size_t sz){
   }
@@ -42,9 +42,13 @@ void MethodInfoHelper::print(word_t ip, word_t addr) {
 }
 
 
-FunctionMap::FunctionMap(BumpPtrAllocator& allocator, CompiledFrames** allFrames) {
-  if (allFrames == NULL) return;
-  Functions.resize(32000); // Make sure the cache is big enough.
+FunctionMap::FunctionMap(BumpPtrAllocator& Alloc, CompiledFrames** allFrames) :
+    allocator(Alloc) {
+  if (allFrames == NULL) {
+    Table = newTable(1024);
+    return;
+  }
+  Table = newTable(65536); // Make sure the cache is big enough.
   int i = 0;
   CompiledFrames* compiledFrames = NULL;
   while ((compiledFrames = allFrames[i++]) != NULL) {
@@ -68,24 +72,68 @@ FunctionMap::FunctionMap(BumpPtrAllocator& allocator, CompiledFrames** allFrames
   }
 }
 
+FunctionMap::FrameInfoTable* FunctionMap::newTable(uint32_t size) {
+  FrameInfoTable* table = (FrameInfoTable*)
+    allocator.Allocate(sizeof(FrameInfoTable), "FrameInfoTable");
+  table->size = size;
+  table->count = 0;
+  table->IPs = (word_t*)
+    allocator.Allocate(size * sizeof(word_t), "FrameInfoTable IPs");
+  table->Infos = (FrameInfo**)
+    allocator.Allocate(size * sizeof(FrameInfo*), "FrameInfoTable Infos");
+  return table;
+}
+
+void FunctionMap::insert(FrameInfoTable* table, word_t ip, FrameInfo* meth) {
+  uint32_t index = hash(ip, table->size);
+  while (table->IPs[index] != 0 && table->IPs[index] != ip) {
+    index = (index + 1) & (table->size - 1);
+  }
+  table->Infos[index] = meth;
+  if (table->IPs[index] == 0) {
+    // Publish the FrameInfo before the key, so that a reader finding the key
+    // also finds the FrameInfo.
+    __sync_synchronize();
+    table->IPs[index] = ip;
+    ++table->count;
+  }
+}
+
 // Create a dummy FrameInfo, so that methods don't have to null check.
 static FrameInfo emptyInfo;
 
 FrameInfo* FunctionMap::IPToFrameInfo(word_t ip) {
-  FunctionMapLock.acquire();
-  llvm::DenseMap<word_t, FrameInfo*>::iterator I = Functions.find(ip);
-  FrameInfo* res = NULL;
-  if (I != Functions.end()) {
-    res = I->second;
-  } else {
-    assert(emptyInfo.Metadata == NULL);
-    assert(emptyInfo.NumLiveOffsets == 0);
-    res = &emptyInfo;
+  FrameInfoTable* table = Table;
+  uint32_t index = hash(ip, table->size);
+  word_t current = 0;
+  while ((current = ((volatile word_t*)table->IPs)[index]) != 0) {
+    if (current == ip) {
+      return ((FrameInfo* volatile*)table->Infos)[index];
+    }
+    index = (index + 1) & (table->size - 1);
   }
-  FunctionMapLock.release();
-  return res;
+  assert(emptyInfo.Metadata == NULL);
+  assert(emptyInfo.NumLiveOffsets == 0);
+  return &emptyInfo;
 }
 
+void FunctionMap::addFrameInfoNoLock(word_t ip, FrameInfo* meth) {
+  FrameInfoTable* table = Table;
+  if (2 * (table->count + 1) > table->size) {
+    // Fill a bigger table and publish it once complete. Readers of the old
+    // table still find all the entries it had.
+    FrameInfoTable* bigger = newTable(2 * table->size);
+    for (uint32_t i = 0; i < table->size; ++i) {
+      if (table->IPs[i] != 0) {
+        insert(bigger, table->IPs[i], table->Infos[i]);
+      }
+    }
+    __sync_synchronize();
+    Table = bigger;
+    table = bigger;
+  }
+  insert(table, ip, meth);
+}
 
 void FunctionMap::addFrameInfo(word_t ip, FrameInfo* meth) {
   FunctionMapLock.acquire();
@@ -67,3 +67,25 @@ void VirtualMachine::exit() {
   threadVar.signal();
   threadLock.unlock();
 }
+
+void VirtualMachine::leaveCriticalRegion() {
+  // The decrement is a full barrier: either this thread sees the waiting
+  // flag, or the waiting thread sees the new count.
+  if (__sync_sub_and_fetch(&criticalCount, 1) == 0 && criticalWaiting) {
+    criticalLock.lock();
+    criticalCond.broadcast();
+    criticalLock.unlock();
+  }
+}
+
+void VirtualMachine::waitForCriticalRegions() {
+  criticalLock.lock();
+  while (criticalCount != 0) {
+    criticalWaiting = true;
+    __sync_synchronize();
+    if (criticalCount == 0) break;
+    criticalCond.wait(&criticalLock);
+  }
+  criticalWaiting = false;
+  criticalLock.unlock();
+}
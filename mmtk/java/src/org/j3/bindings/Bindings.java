@@ -11,10 +11,13 @@ package org.j3.bindings;
 
 import org.j3.config.Selected;
 import org.j3.options.OptionSet;
+import org.mmtk.plan.CollectorContext;
 import org.mmtk.plan.MutatorContext;
 import org.mmtk.plan.Plan;
 import org.mmtk.plan.TraceLocal;
 import org.mmtk.plan.TransitiveClosure;
+import org.mmtk.plan.generational.Gen;
+import org.mmtk.plan.semispace.SS;
 import org.mmtk.utility.heap.HeapGrowthManager;
 import org.mmtk.utility.Constants;
 import org.mmtk.utility.Log;
@@ -59,6 +62,25 @@ public final class Bindings {
 	    return res;
 	  }
 
+	  @Inline
+	  private static Address allocateTLAB(int size) {
+	    Selected.Mutator mutator = Selected.Mutator.get();
+	    return mutator.alloc(size, 0, 0, Plan.ALLOC_DEFAULT, 0);
+	  }
+
+	  /**
+	   * Can threads carve objects of at most maxObjectSize bytes from buffers
+	   * allocated in the default space? The space must be bump-allocated, need
+	   * no work per object after allocation, and be able to copy such objects.
+	   */
+	  @Inline
+	  private static boolean supportsTLAB(int maxObjectSize) {
+	    Plan plan = Selected.Plan.get();
+	    if (!(plan instanceof Gen) && !(plan instanceof SS)) return false;
+	    return maxObjectSize <= Plan.MAX_NON_LOS_DEFAULT_ALLOC_BYTES &&
+	           maxObjectSize <= Plan.MAX_NON_LOS_COPY_BYTES;
+	  }
+
 	@Inline
 	private static Address prealloc(int size) {
 		Selected.Mutator mutator = Selected.Mutator.get();
@@ -119,6 +141,11 @@ public final class Bindings {
     closure.processEdge(source, slot);
   }
 
+  @Inline
+  private static boolean processArrayChunk(TransitiveClosure closure, ObjectReference array, int start) {
+    return closure.processArrayChunk(array, start);
+  }
+
   @Inline
   private static MutatorContext allocateMutator(int id) {
     Selected.Mutator mutator = new Selected.Mutator();
@@ -131,6 +158,23 @@ public final class Bindings {
     mutator.deinitMutator();
   }
 
+  @Inline
+  private static CollectorContext bootstrapCollector() {
+    return Selected.Collector.bootstrap();
+  }
+
+  @Inline
+  private static CollectorContext allocateCollector(int id) {
+    Selected.Collector collector = new Selected.Collector();
+    collector.initCollector(id);
+    return collector;
+  }
+
+  @Inline
+  private static void collectorCollect(CollectorContext collector) {
+    collector.collect();
+  }
+
   @Inline
   private static void boot(Extent minSize, Extent maxSize, String[] arguments) {
     if (arguments != null) {
@@ -143,6 +187,21 @@ public final class Bindings {
     plan.fullyBooted();
   }
 
+  @Inline
+  private static Extent maxMemory() {
+    return HeapGrowthManager.getMaxHeapSize();
+  }
+
+  @Inline
+  private static Extent totalMemory() {
+    return Plan.totalMemory();
+  }
+
+  @Inline
+  private static Extent freeMemory() {
+    return Plan.freeMemory();
+  }
+
   @Inline
   private static ObjectReference copy(ObjectReference from,
                               ObjectReference virtualTable,
@@ -182,6 +241,38 @@ public final class Bindings {
     }
   }
   
+  /**
+   * Barrier of a copy of count references between two reference arrays.
+   * Returns false if the caller has to copy the references.
+   */
+  @Inline
+  private static boolean arrayCopyWriteBarrier(ObjectReference src, Address srcSlot, ObjectReference dst, Address dstSlot, int count) {
+    if (!Selected.Constraints.get().needsObjectReferenceWriteBarrier()) {
+      return false;
+    }
+    Selected.Mutator mutator = Selected.Mutator.get();
+    if (Selected.Constraints.get().objectReferenceBulkCopySupported()) {
+      Offset srcOffset = srcSlot.diff(src.toAddress());
+      Offset dstOffset = dstSlot.diff(dst.toAddress());
+      return mutator.objectReferenceBulkCopy(src, srcOffset, dst, dstOffset, count << Constants.LOG_BYTES_IN_ADDRESS);
+    }
+    // One barrier per element, in the order of an overlapping copy.
+    if (srcSlot.LT(dstSlot)) {
+      for (int i = count - 1; i >= 0; i--) {
+        Offset offset = Offset.fromIntSignExtend(i << Constants.LOG_BYTES_IN_ADDRESS);
+        Address slot = dstSlot.plus(offset);
+        mutator.objectReferenceWrite(dst, slot, srcSlot.plus(offset).loadObjectReference(), slot.toWord(), slot.toWord(), Constants.ARRAY_ELEMENT);
+      }
+    } else {
+      for (int i = 0; i < count; i++) {
+        Offset offset = Offset.fromIntSignExtend(i << Constants.LOG_BYTES_IN_ADDRESS);
+        Address slot = dstSlot.plus(offset);
+        mutator.objectReferenceWrite(dst, slot, srcSlot.plus(offset).loadObjectReference(), slot.toWord(), slot.toWord(), Constants.ARRAY_ELEMENT);
+      }
+    }
+    return true;
+  }
+
   @Inline
   private static void fieldWriteBarrier(ObjectReference ref, Address slot, ObjectReference value) {
     if (Selected.Constraints.get().needsObjectReferenceWriteBarrier()) {
@@ -212,6 +303,11 @@ public final class Bindings {
     }
   }
 
+  @Inline
+  private static boolean willNeverMove(ObjectReference obj) {
+    return Selected.Plan.get().willNeverMove(obj);
+  }
+
   @Inline
   private static boolean needsWriteBarrier() {
     return Selected.Constraints.get().needsObjectReferenceWriteBarrier();
@@ -222,6 +318,11 @@ public final class Bindings {
     return Selected.Constraints.get().needsObjectReferenceNonHeapWriteBarrier();
   }
 
+  @Inline
+  private static boolean lastCollectionFullHeap() {
+    return Selected.Plan.get().lastCollectionFullHeap();
+  }
+
   @Inline
   private static void collect(int why) {
     boolean userTriggered = why == Collection.EXTERNAL_GC_TRIGGER;
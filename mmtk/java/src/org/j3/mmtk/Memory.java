@@ -103,6 +103,15 @@ public final class Memory extends org.mmtk.vm.Memory {
    */
   public native final boolean munprotect(Address start, int size);
 
+  /**
+   * Returns the physical memory of an area of virtual memory to the
+   * operating system. The area stays mapped and reads as zero.
+   *
+   * @param start the address of the start of the area to be released
+   * @param len the size, in bytes, of the area to be released
+   */
+  public native final void release(Address start, Extent len);
+
   /**
    * Zero a region of memory.
    * @param start Start of address range (inclusive)
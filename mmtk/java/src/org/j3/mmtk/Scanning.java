@@ -32,6 +32,17 @@ public final class Scanning extends org.mmtk.vm.Scanning {
   @Inline
   public native void specializedScanObject(int id, TransitiveClosure trace, ObjectReference object);
 
+  /**
+   * Delegated scanning of a chunk of a reference array, processing each
+   * element from the given index to the end of the chunk.
+   *
+   * @param trace The trace to use.
+   * @param array The array to be scanned.
+   * @param start The index of the first element of the chunk.
+   */
+  @Inline
+  public native void scanArrayChunk(TransitiveClosure trace, ObjectReference array, int start);
+
 
   /**
    * Precopying of a object's fields, processing each pointer field encountered.
@@ -29,6 +29,7 @@ public class Trace implements Constants {
   // Global pools for load-balancing deques
   final SharedDeque valuePool;
   final SharedDeque rootLocationPool;
+  final SharedDeque arrayChunkPool;
 
   /**
    * Constructor
@@ -36,6 +37,7 @@ public class Trace implements Constants {
   public Trace(RawPageSpace metaDataSpace) {
     valuePool = new SharedDeque("valuePool",metaDataSpace, 1);
     rootLocationPool = new SharedDeque("rootLocations", metaDataSpace, 1);
+    arrayChunkPool = new SharedDeque("arrayChunks", metaDataSpace, 2);
   }
 
   /**
@@ -44,6 +46,7 @@ public class Trace implements Constants {
   public void prepareNonBlocking() {
     valuePool.prepareNonBlocking();
     rootLocationPool.prepareNonBlocking();
+    arrayChunkPool.prepareNonBlocking();
   }
 
   /**
@@ -53,6 +56,7 @@ public class Trace implements Constants {
   public void prepare() {
     valuePool.prepare();
     rootLocationPool.prepareNonBlocking();
+    arrayChunkPool.prepare();
   }
 
   /**
@@ -61,12 +65,14 @@ public class Trace implements Constants {
   public void release() {
     valuePool.reset();
     rootLocationPool.reset();
+    arrayChunkPool.reset();
   }
 
   /**
    * Is there any work outstanding in this trace. That is are there any pages in the pools.
    */
   public boolean hasWork() {
-    return (valuePool.enqueuedPages() + rootLocationPool.enqueuedPages()) > 0;
+    return (valuePool.enqueuedPages() + rootLocationPool.enqueuedPages() +
+            arrayChunkPool.enqueuedPages()) > 0;
   }
 }
@@ -42,6 +42,8 @@ public abstract class TraceLocal extends TransitiveClosure implements Constants
   protected final ObjectReferenceDeque values;
   /* delayed root slots */
   protected final AddressDeque rootLocations;
+  /* chunks of large reference arrays, as (array, first index) pairs */
+  protected final AddressPairDeque arrayChunks;
 
   /****************************************************************************
    *
@@ -67,6 +69,7 @@ public abstract class TraceLocal extends TransitiveClosure implements Constants
     super(specializedScan);
     values = new ObjectReferenceDeque("value", trace.valuePool);
     rootLocations = new AddressDeque("roots", trace.rootLocationPool);
+    arrayChunks = new AddressPairDeque(trace.arrayChunkPool);
   }
 
   /****************************************************************************
@@ -186,12 +189,40 @@ public abstract class TraceLocal extends TransitiveClosure implements Constants
     values.push(object);
   }
 
+  /**
+   * Add a chunk of a reference array, so that other collector threads can
+   * trace the chunks of a large array in parallel.
+   *
+   * @param array The array to be processed.
+   * @param start The index of the first element of the chunk.
+   * @return True, the chunk is traced later.
+   */
+  @Inline
+  public final boolean processArrayChunk(ObjectReference array, int start) {
+    if (VM.VERIFY_ASSERTIONS) VM.assertions._assert(start > 0);
+    arrayChunks.push(array.toAddress(), Address.fromIntZeroExtend(start));
+    return true;
+  }
+
+  /**
+   * Trace the pending chunks of reference arrays.
+   */
+  @Inline
+  private void processArrayChunks() {
+    while (!arrayChunks.isEmpty()) {
+      ObjectReference array = arrayChunks.pop1().toObjectReference();
+      int start = arrayChunks.pop2().toInt();
+      VM.scanning.scanArrayChunk(this, array, start);
+    }
+  }
+
   /**
    * Flush the local buffers of all deques.
    */
   public final void flush() {
     values.flushLocal();
     rootLocations.flushLocal();
+    arrayChunks.flushLocal();
   }
 
   /**
@@ -452,6 +483,7 @@ public abstract class TraceLocal extends TransitiveClosure implements Constants
   public void release() {
     values.reset();
     rootLocations.reset();
+    arrayChunks.reset();
   }
 
   /**
@@ -478,12 +510,15 @@ public abstract class TraceLocal extends TransitiveClosure implements Constants
     logMessage(5, "processing gray objects");
     assertMutatorRemsetsFlushed();
     do {
-      while (!values.isEmpty()) {
-        ObjectReference v = values.pop();
-        scanObject(v);
-      }
+      do {
+        while (!values.isEmpty()) {
+          ObjectReference v = values.pop();
+          scanObject(v);
+        }
+        processArrayChunks();
+      } while (!values.isEmpty());
       processRememberedSets();
-    } while (!values.isEmpty());
+    } while (!values.isEmpty() || !arrayChunks.isEmpty());
     assertMutatorRemsetsFlushed();
   }
 
@@ -505,8 +540,15 @@ public abstract class TraceLocal extends TransitiveClosure implements Constants
         scanObject(v);
         units++;
       }
-    } while (!values.isEmpty() && units < workLimit);
-    return values.isEmpty();
+      while (values.isEmpty() && !arrayChunks.isEmpty() && units < workLimit) {
+        ObjectReference array = arrayChunks.pop1().toObjectReference();
+        int start = arrayChunks.pop2().toInt();
+        VM.scanning.scanArrayChunk(this, array, start);
+        units++;
+      }
+    } while ((!values.isEmpty() || !arrayChunks.isEmpty()) &&
+             units < workLimit);
+    return values.isEmpty() && arrayChunks.isEmpty();
   }
 
   /**
@@ -91,4 +91,17 @@ public abstract class TransitiveClosure {
   public void processNode(ObjectReference object) {
     VM.assertions.fail("processNode not implemented.");
   }
+
+  /**
+   * Trace the elements of a reference array from a given index as a
+   * separate unit of work.
+   *
+   * @param array The array to be processed.
+   * @param start The index of the first element to trace.
+   * @return False if this closure does not split arrays, in which case
+   * the caller traces the elements itself.
+   */
+  public boolean processArrayChunk(ObjectReference array, int start) {
+    return false;
+  }
 }
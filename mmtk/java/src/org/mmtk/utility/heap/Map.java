@@ -227,6 +227,8 @@ public class Map {
       descriptorMap[chunk + offset] = 0;
       VM.barriers.objectArrayStoreNoGCBarrier(spaceMap, chunk + offset, null);
     }
+    VM.memory.release(addressForChunkIndex(chunk),
+        Word.fromIntZeroExtend(chunks).lsh(Space.LOG_BYTES_IN_CHUNK).toExtent());
     return chunks;
   }
 
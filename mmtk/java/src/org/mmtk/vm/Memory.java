@@ -97,6 +97,15 @@ import org.vmmagic.pragma.*;
    */
   public abstract boolean munprotect(Address start, int size);
 
+  /**
+   * Returns the physical memory of an area of virtual memory to the
+   * operating system. The area stays mapped and reads as zero.
+   *
+   * @param start the address of the start of the area to be released
+   * @param len the size, in bytes, of the area to be released
+   */
+  public abstract void release(Address start, Extent len);
+
   /**
    * Zero a region of memory.
    * @param start Start of address range (inclusive)
@@ -38,6 +38,16 @@ import org.vmmagic.unboxed.*;
    */
   public abstract void specializedScanObject(int id, TransitiveClosure trace, ObjectReference object);
 
+  /**
+   * Delegated scanning of a chunk of a reference array, processing each
+   * element from the given index to the end of the chunk.
+   *
+   * @param trace The trace to use.
+   * @param array The array to be scanned.
+   * @param start The index of the first element of the chunk.
+   */
+  public abstract void scanArrayChunk(TransitiveClosure trace, ObjectReference array, int start);
+
   /**
    * Delegated precopying of a object's children, processing each pointer field
    * encountered.
@@ -9,10 +9,16 @@
 
 #include "MutatorThread.h"
 #include "VmkitGC.h"
+#include "../mmtk-j3/CollectorThread.h"
+#include "../mmtk-j3/GCStatistics.h"
 #include "../mmtk-j3/MMTkObject.h"
 
+#include "vmkit/System.h"
 #include "vmkit/VirtualMachine.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <sys/mman.h>
 #include <set>
 
@@ -21,15 +27,22 @@
 using namespace vmkit;
 
 int Collector::verbose = 0;
+FILE* Collector::logFile = NULL;
 extern "C" void Java_org_j3_mmtk_Collection_triggerCollection__I(word_t, int32_t) ALWAYS_INLINE;
 
 extern "C" word_t JnJVM_org_j3_bindings_Bindings_allocateMutator__I(int32_t) ALWAYS_INLINE;
 extern "C" void JnJVM_org_j3_bindings_Bindings_freeMutator__Lorg_mmtk_plan_MutatorContext_2(word_t) ALWAYS_INLINE;
+extern "C" word_t JnJVM_org_j3_bindings_Bindings_maxMemory__() ALWAYS_INLINE;
+extern "C" word_t JnJVM_org_j3_bindings_Bindings_freeMemory__() ALWAYS_INLINE;
+extern "C" word_t JnJVM_org_j3_bindings_Bindings_totalMemory__() ALWAYS_INLINE;
 extern "C" void JnJVM_org_j3_bindings_Bindings_boot__Lorg_vmmagic_unboxed_Extent_2Lorg_vmmagic_unboxed_Extent_2_3Ljava_lang_String_2(word_t, word_t, mmtk::MMTkObjectArray*) ALWAYS_INLINE;
 
 extern "C" void JnJVM_org_j3_bindings_Bindings_processEdge__Lorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2(
     word_t closure, void* source, void* slot) ALWAYS_INLINE;
 
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_processArrayChunk__Lorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2I(
+    word_t closure, void* array, int32_t start) ALWAYS_INLINE;
+
 extern "C" void JnJVM_org_j3_bindings_Bindings_reportDelayedRootEdge__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_Address_2(
     word_t TraceLocal, void** slot) ALWAYS_INLINE;
 extern "C" void JnJVM_org_j3_bindings_Bindings_processRootEdge__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_Address_2Z(
@@ -47,10 +60,14 @@ extern "C" gc* JnJVM_org_j3_bindings_Bindings_getForwardedFinalizable__Lorg_mmtk
 extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_isLive__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_ObjectReference_2(
     word_t TraceLocal, void* obj) ALWAYS_INLINE;
   
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_willNeverMove__Lorg_vmmagic_unboxed_ObjectReference_2(
+    void* obj) ALWAYS_INLINE;
 extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_writeBarrierCAS__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_ObjectReference_2(gc* ref, gc** slot, gc* old, gc* value) ALWAYS_INLINE;
   
 extern "C" void JnJVM_org_j3_bindings_Bindings_arrayWriteBarrier__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2(gc* ref, gc** ptr, gc* value) ALWAYS_INLINE;
 
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_arrayCopyWriteBarrier__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2I(gc* src, gc** srcPtr, gc* dst, gc** dstPtr, int count) ALWAYS_INLINE;
+
 extern "C" void JnJVM_org_j3_bindings_Bindings_fieldWriteBarrier__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2(gc* ref, gc** ptr, gc* value) ALWAYS_INLINE;
   
 extern "C" void JnJVM_org_j3_bindings_Bindings_nonHeapWriteBarrier__Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2(gc** ptr, gc* value) ALWAYS_INLINE;
@@ -66,6 +83,10 @@ extern "C" void* JnJVM_org_j3_bindings_Bindings_vmkitgcmalloc__ILorg_vmmagic_unb
 extern "C" void* JnJVM_org_j3_bindings_Bindings_VTgcmalloc__ILorg_vmmagic_unboxed_ObjectReference_2(
     int sz, void* VT) ALWAYS_INLINE;
 
+extern "C" void* JnJVM_org_j3_bindings_Bindings_allocateTLAB__I(int sz) ALWAYS_INLINE;
+
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_supportsTLAB__I(int maxObjectSize) ALWAYS_INLINE;
+
 extern "C" void addFinalizationCandidate(gc* obj) ALWAYS_INLINE;
 
 /**************************************
@@ -119,13 +140,69 @@ extern "C" void* vmkitgcmallocUnresolved(uint32_t sz, void* type) {
  * Optimized gcmalloc for VT based object layout.                             *
  *****************************************************************************/
 
+/// TLABSize - The size of the allocation buffers of the threads, or 0 if the
+/// plan does not allocate objects with a bump pointer. Not static: compiled
+/// code inlines VTgcmalloc, and reads it.
+///
+uint32_t TLABSize = 0;
+
+/// kTLABSize - The size of allocation buffers, when the plan supports them.
+///
+static const uint32_t kTLABSize = 32 * 1024;
+
+/// kTLABMaxObjectSize - Larger objects are allocated outside the buffers, so
+/// that refilling a buffer wastes at most this size.
+///
+static const uint32_t kTLABMaxObjectSize = kTLABSize / 8;
+
+/// VTgcmallocSlow - Allocate an object when the buffer of the thread is
+/// exhausted: refill the buffer, or allocate large objects directly.
+///
+extern "C" void* VTgcmallocSlow(uint32_t sz, void* VT)
+  __attribute__ ((noinline));
+
+extern "C" void* VTgcmallocSlow(uint32_t sz, void* VT) {
+	gc* res = 0;
+	llvm_gcroot(res, 0);
+	if (sz <= kTLABMaxObjectSize) {
+		MutatorThread* th = MutatorThread::get();
+		// Set the buffer after the allocation, which may collect and drop the
+		// previous buffer.
+		word_t buffer =
+			(word_t)JnJVM_org_j3_bindings_Bindings_allocateTLAB__I(TLABSize);
+		th->TLABCursor = buffer + sz;
+		th->TLABLimit = buffer + TLABSize;
+		res = ((gcHeader*)buffer)->toReference();
+		VirtualTable::setVirtualTable(res, (VirtualTable*)VT);
+		return res;
+	}
+	res = ((gcHeader*)JnJVM_org_j3_bindings_Bindings_VTgcmalloc__ILorg_vmmagic_unboxed_ObjectReference_2(sz, VT))->toReference();
+	return res;
+}
+
+/// VTgcmalloc - Allocate an object in the buffer of the thread, or with the
+/// inlined allocator of MMTk if the plan has no buffers. With buffers, the
+/// function is inlined in compiled code whatever the size, so this fast path
+/// must stay small.
+///
 extern "C" void* VTgcmalloc(uint32_t sz, void* VT) {
 	gc* res = 0;
 	llvm_gcroot(res, 0);
 	sz += gcHeader::hiddenHeaderSize();
 	sz = llvm::RoundUpToAlignment(sz, sizeof(void*));
-	res = ((gcHeader*)JnJVM_org_j3_bindings_Bindings_VTgcmalloc__ILorg_vmmagic_unboxed_ObjectReference_2(sz, VT))->toReference();
-	return res;
+	if (TLABSize == 0) {
+		res = ((gcHeader*)JnJVM_org_j3_bindings_Bindings_VTgcmalloc__ILorg_vmmagic_unboxed_ObjectReference_2(sz, VT))->toReference();
+		return res;
+	}
+	MutatorThread* th = MutatorThread::get();
+	word_t cursor = th->TLABCursor;
+	if (th->TLABLimit - cursor >= sz) {
+		th->TLABCursor = cursor + sz;
+		res = ((gcHeader*)cursor)->toReference();
+		VirtualTable::setVirtualTable(res, (VirtualTable*)VT);
+		return res;
+	}
+	return VTgcmallocSlow(sz, VT);
 }
 
 extern "C" void* VTgcmallocUnresolved(uint32_t sz, void* VT) {
@@ -151,6 +228,17 @@ extern "C" void arrayWriteBarrier(void* ref, void** ptr, void* value) {
   if (vmkit::Thread::get()->doYield) vmkit::Collector::collect();
 }
 
+extern "C" void arrayCopyWriteBarrier(void* src, void** srcPtr, void* dst,
+                                      void** dstPtr, uint32_t count) {
+  llvm_gcroot(src, 0);
+  llvm_gcroot(dst, 0);
+  if (!JnJVM_org_j3_bindings_Bindings_arrayCopyWriteBarrier__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2I(
+        (gc*)src, (gc**)srcPtr, (gc*)dst, (gc**)dstPtr, count)) {
+    memmove(dstPtr, srcPtr, count * sizeof(void*));
+  }
+  if (vmkit::Thread::get()->doYield) vmkit::Collector::collect();
+}
+
 extern "C" void fieldWriteBarrier(void* ref, void** ptr, void* value) {
   llvm_gcroot(ref, 0);
   llvm_gcroot(value, 0);
@@ -180,10 +268,16 @@ bool Collector::isLive(gc* ptr, word_t closure) {
   return JnJVM_org_j3_bindings_Bindings_isLive__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_ObjectReference_2(closure, ptr);
 }
 
+bool Collector::pin(gc* ptr) {
+  llvm_gcroot(ptr, 0);
+  return JnJVM_org_j3_bindings_Bindings_willNeverMove__Lorg_vmmagic_unboxed_ObjectReference_2(ptr);
+}
+
 void Collector::scanObject(FrameInfo* FI, void** ptr, word_t closure) {
   if ((*ptr) != NULL) {
     assert(vmkit::Thread::get()->MyVM->isCorruptedType((gc*)(*ptr)));
   }
+  mmtk::GCStatistics::countRoot();
   JnJVM_org_j3_bindings_Bindings_reportDelayedRootEdge__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_Address_2(closure, ptr);
 }
  
@@ -197,12 +291,18 @@ void Collector::markAndTrace(void* source, void* ptr, word_t closure) {
 	JnJVM_org_j3_bindings_Bindings_processEdge__Lorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Address_2(closure, source, ptr);
 }
   
+bool Collector::pushArrayChunk(gc* array, uint32_t start, word_t closure) {
+  llvm_gcroot(array, 0);
+  return JnJVM_org_j3_bindings_Bindings_processArrayChunk__Lorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2I(closure, array, start);
+}
+
 void Collector::markAndTraceRoot(void* source, void* ptr, word_t closure) {
   llvm_gcroot(source, 0);
   void** ptr_ = (void**)ptr;
   if ((*ptr_) != NULL) {
     assert(vmkit::Thread::get()->MyVM->isCorruptedType((gc*)(*ptr_)));
   }
+  mmtk::GCStatistics::countRootEdge();
   JnJVM_org_j3_bindings_Bindings_processRootEdge__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_Address_2Z(closure, ptr, true);
 }
 
@@ -238,25 +338,60 @@ void Collector::collect() {
 static const char* kPrefix = "-X:gc:";
 static const int kPrefixLength = strlen(kPrefix);
 
+static const size_t kDefaultMinHeapSize = 20 * 1024 * 1024;
+static const size_t kDefaultMaxHeapSize = 100 * 1024 * 1024;
+
 void Collector::initialise(int argc, char** argv) {
-  int i = 1;
   int count = 0;
+  size_t minSize = kDefaultMinHeapSize;
+  size_t maxSize = kDefaultMaxHeapSize;
   ThreadAllocator allocator;
   mmtk::MMTkObjectArray* arguments = NULL;
-  while (i < argc && argv[i][0] == '-') {
+  for (int i = System::NextVMOption(argc, argv, 0); i < argc;
+       i = System::NextVMOption(argc, argv, i)) {
+    const char* value = NULL;
+    size_t* size = NULL;
     if (!strncmp(argv[i], kPrefix, kPrefixLength)) {
       count++;
+    } else if (!strncmp(argv[i], "-Xmx", 4)) {
+      value = argv[i] + 4;
+      size = &maxSize;
+    } else if (!strncmp(argv[i], "-mx", 3)) {
+      value = argv[i] + 3;
+      size = &maxSize;
+    } else if (!strncmp(argv[i], "-Xms", 4)) {
+      value = argv[i] + 4;
+      size = &minSize;
+    } else if (!strncmp(argv[i], "-ms", 3)) {
+      value = argv[i] + 3;
+      size = &minSize;
+    }
+    if (size != NULL) {
+      size_t val = System::ParseSize(value);
+      if (val == 0) {
+        fprintf(stderr, "Invalid heap size: %s\n", argv[i]);
+      } else {
+        *size = val;
+      }
     }
-    i++;
+  }
+
+  // The heap can not grow beyond the memory reserved for it.
+  if (maxSize < minSize) maxSize = minSize;
+  if (maxSize > kGCMemorySize) {
+    fprintf(stderr, "Maximum heap size too large, using %lu MB\n",
+            (unsigned long)(kGCMemorySize >> 20));
+    maxSize = kGCMemorySize;
+    if (minSize > maxSize) minSize = maxSize;
   }
 
   if (count > 0) {
     arguments = reinterpret_cast<mmtk::MMTkObjectArray*>(
         malloc(sizeof(mmtk::MMTkObjectArray) + count * sizeof(mmtk::MMTkString*)));
     arguments->size = count;
-    i = 1;
     int arrayIndex = 0;
-    while (i < argc && argv[i][0] == '-') {
+    for (int i = System::NextVMOption(argc, argv, 0); i < argc;
+         i = System::NextVMOption(argc, argv, i)) {
       if (!strncmp(argv[i], kPrefix, kPrefixLength)) {
         int size = strlen(argv[i]) - kPrefixLength;
         mmtk::MMTkArray* array = reinterpret_cast<mmtk::MMTkArray*>(
@@ -272,12 +407,41 @@ void Collector::initialise(int argc, char** argv) {
         str->offset = 0;
         arguments->elements[arrayIndex++] = str;
       }
-      i++;
     }
     assert(arrayIndex == count);
   }
 
-  JnJVM_org_j3_bindings_Bindings_boot__Lorg_vmmagic_unboxed_Extent_2Lorg_vmmagic_unboxed_Extent_2_3Ljava_lang_String_2(20 * 1024 * 1024, 100 * 1024 * 1024, arguments);
+  mmtk::GCStatistics::bootNanos = System::GetTimeNanos();
+  JnJVM_org_j3_bindings_Bindings_boot__Lorg_vmmagic_unboxed_Extent_2Lorg_vmmagic_unboxed_Extent_2_3Ljava_lang_String_2(minSize, maxSize, arguments);
+
+  if (JnJVM_org_j3_bindings_Bindings_supportsTLAB__I(kTLABMaxObjectSize)) {
+    TLABSize = kTLABSize;
+  }
+}
+
+size_t Collector::getMaxMemory() {
+  return JnJVM_org_j3_bindings_Bindings_maxMemory__();
+}
+
+size_t Collector::getFreeMemory() {
+  return JnJVM_org_j3_bindings_Bindings_freeMemory__();
+}
+
+size_t Collector::getTotalMemory() {
+  return JnJVM_org_j3_bindings_Bindings_totalMemory__();
+}
+
+uint64_t Collector::getCollectionCount() {
+  return mmtk::GCStatistics::collections;
+}
+
+uint64_t Collector::getCollectionTime() {
+  return mmtk::GCStatistics::totalNanos;
+}
+
+void Collector::startCollectorThreads(uint32_t nbThreads) {
+  mmtk::CollectorThread::startCollectorThreads(vmkit::Thread::get()->MyVM,
+                                               nbThreads);
 }
 
 extern "C" void* MMTkMutatorAllocate(uint32_t size, void* type) {
@@ -328,6 +492,10 @@ bool Collector::needsNonHeapWriteBarrier() {
   return JnJVM_org_j3_bindings_Bindings_needsNonHeapWriteBarrier__();
 }
 
+bool Collector::hasAllocationBuffers() {
+  return TLABSize != 0;
+}
+
 //TODO: Remove these.
 std::set<gc*> __InternalSet__;
 void* Collector::begOf(gc* obj) {
@@ -9,36 +9,54 @@
 
 #include "debug.h"
 #include "vmkit/VirtualMachine.h"
+#include "CollectorThread.h"
 #include "MMTkObject.h"
 #include "MutatorThread.h"
 
 namespace mmtk {
 
+// Collector threads iterate over mutators concurrently. Once a thread has
+// reached the end of the list, others must not start a new iteration before
+// the primary collector resets the iterator.
+static vmkit::SpinLock mutatorLock;
+static bool mutatorsExhausted = false;
+
 extern "C" MMTkObject* Java_org_j3_mmtk_ActivePlan_getNextMutator__(MMTkActivePlan* A) {
   assert(A && "No active plan");
-  
-  if (A->current == NULL) {
-    A->current = (vmkit::MutatorThread*)vmkit::Thread::get()->MyVM->mainThread;
-  } else if (A->current->next() == vmkit::Thread::get()->MyVM->mainThread) {
-    A->current = NULL;
+  vmkit::Thread* mainThread = vmkit::Thread::get()->MyVM->mainThread;
+  word_t context = 0;
+
+  mutatorLock.acquire();
+  if (mutatorsExhausted) {
+    mutatorLock.release();
     return NULL;
-  } else {
-    A->current = (vmkit::MutatorThread*)A->current->next();
   }
+  do {
+    if (A->current == NULL) {
+      A->current = (vmkit::MutatorThread*)mainThread;
+    } else if (A->current->next() == mainThread) {
+      A->current = NULL;
+      mutatorsExhausted = true;
+      break;
+    } else {
+      A->current = (vmkit::MutatorThread*)A->current->next();
+    }
+    context = A->current->MutatorContext;
+  } while (context == 0);
+  mutatorLock.release();
 
-  if (A->current->MutatorContext == 0) {
-    return Java_org_j3_mmtk_ActivePlan_getNextMutator__(A);
-  }
-  return (MMTkObject*)A->current->MutatorContext;
+  return (MMTkObject*)context;
 }
 
 extern "C" void Java_org_j3_mmtk_ActivePlan_resetMutatorIterator__(MMTkActivePlan* A) {
+  mutatorLock.acquire();
   A->current = NULL;
+  mutatorsExhausted = false;
+  mutatorLock.release();
 }
 
 extern "C" int Java_org_j3_mmtk_ActivePlan_collectorCount__ (MMTkActivePlan* A) {
-  // We do not support parallel GC yet.
-  return 1;
+  return CollectorThread::nbCollectors;
 }
 
 }
@@ -9,6 +9,9 @@
 
 #include "debug.h"
 #include "vmkit/VirtualMachine.h"
+#include "vmkit/System.h"
+#include "CollectorThread.h"
+#include "GCStatistics.h"
 #include "MMTkObject.h"
 #include "VmkitGC.h"
 
@@ -24,27 +27,48 @@ extern "C" void Java_org_j3_mmtk_Collection_reportAllocationSuccess__ (MMTkObjec
 }
 
 extern "C" void JnJVM_org_j3_bindings_Bindings_collect__I(int why);
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_lastCollectionFullHeap__();
 
 extern "C" void Java_org_j3_mmtk_Collection_triggerCollection__I (MMTkObject* C, int why) {
   vmkit::MutatorThread* th = vmkit::MutatorThread::get();
   if (why > 2) th->CollectionAttempts++;
 
-  // Verify that another collection is not happening.
-  th->MyVM->rendezvous.startRV();
-  if (th->MyVM->rendezvous.getInitiator() != NULL) {
-    th->MyVM->rendezvous.cancelRV();
-    th->MyVM->rendezvous.join();
-    return;
-  } else {
+  while (true) {
+    // Verify that another collection is not happening.
+    th->MyVM->rendezvous.startRV();
+    if (th->MyVM->rendezvous.getInitiator() != NULL) {
+      th->MyVM->rendezvous.cancelRV();
+      th->MyVM->rendezvous.join();
+      return;
+    }
+
+    uint64_t start = vmkit::System::GetTimeNanos();
     th->MyVM->startCollection();
     th->MyVM->rendezvous.synchronize();
 
-    JnJVM_org_j3_bindings_Bindings_collect__I(why);
+    // Critical regions are entered in cooperative code, so no thread can
+    // enter one while the others are stopped. If a thread is in one, let
+    // the threads run again and collect once it is left.
+    bool collect = (th->MyVM->criticalCount == 0);
+    if (collect) {
+      // The space of the allocation buffers is reclaimed by the collection.
+      vmkit::MutatorThread* tcur = th;
+      do {
+        tcur->resetTLAB();
+        tcur = (vmkit::MutatorThread*)tcur->next();
+      } while (tcur != th);
+      GCStatistics::startCollection(start, why);
+      JnJVM_org_j3_bindings_Bindings_collect__I(why);
+      GCStatistics::endCollection(
+          JnJVM_org_j3_bindings_Bindings_lastCollectionFullHeap__());
+    }
 
     th->MyVM->rendezvous.finishRV();
     th->MyVM->endCollection();
-  }
 
+    if (collect) return;
+    th->MyVM->waitForCriticalRegions();
+  }
 }
 
 extern "C" void Java_org_j3_mmtk_Collection_joinCollection__ (MMTkObject* C) {
@@ -54,7 +78,7 @@ extern "C" void Java_org_j3_mmtk_Collection_joinCollection__ (MMTkObject* C) {
 }
 
 extern "C" int Java_org_j3_mmtk_Collection_rendezvous__I (MMTkObject* C, int where) {
-  return 1;
+  return CollectorThread::rendezvous();
 }
 
 extern "C" int Java_org_j3_mmtk_Collection_maximumCollectionAttempt__ (MMTkObject* C) {
@@ -79,8 +103,13 @@ extern "C" void Java_org_j3_mmtk_Collection_prepareCollector__Lorg_mmtk_plan_Col
 extern "C" void Java_org_j3_mmtk_Collection_prepareMutator__Lorg_mmtk_plan_MutatorContext_2 (MMTkObject* C, MMTkObject* MC) {
 }
 
-extern "C" int32_t Java_org_j3_mmtk_Collection_activeGCThreads__ (MMTkObject* C) { return 1; }
-extern "C" int32_t Java_org_j3_mmtk_Collection_activeGCThreadOrdinal__ (MMTkObject* C) { return 1; }
+extern "C" int32_t Java_org_j3_mmtk_Collection_activeGCThreads__ (MMTkObject* C) {
+  return CollectorThread::nbActive;
+}
+
+extern "C" int32_t Java_org_j3_mmtk_Collection_activeGCThreadOrdinal__ (MMTkObject* C) {
+  return CollectorThread::getOrdinal();
+}
 
 
 extern "C" void Java_org_j3_mmtk_Collection_reportPhysicalAllocationFailed__ (MMTkObject* C) { UNIMPLEMENTED(); }
@@ -0,0 +1,164 @@
+//===------ CollectorThread.cpp - Threads of the parallel collector -------===//
+//
+//                              The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdlib>
+
+#include "debug.h"
+#include "vmkit/System.h"
+#include "vmkit/VirtualMachine.h"
+#include "CollectorThread.h"
+
+namespace mmtk {
+
+extern "C" word_t JnJVM_org_j3_bindings_Bindings_bootstrapCollector__();
+extern "C" word_t JnJVM_org_j3_bindings_Bindings_allocateCollector__I(int32_t);
+extern "C" void JnJVM_org_j3_bindings_Bindings_collectorCollect__Lorg_mmtk_plan_CollectorContext_2(word_t);
+
+word_t CollectorThread::contexts[CollectorThread::MaxCollectors];
+uint32_t CollectorThread::nbCollectors = 1;
+uint32_t CollectorThread::nbActive = 1;
+uint32_t CollectorThread::collections = 0;
+uint32_t CollectorThread::nbRunning = 0;
+vmkit::LockNormal CollectorThread::lock;
+vmkit::Cond CollectorThread::startCond;
+vmkit::Cond CollectorThread::doneCond;
+uint32_t CollectorThread::arrived = 0;
+uint32_t CollectorThread::rendezvousCount = 0;
+vmkit::Cond CollectorThread::rendezvousCond;
+vmkit::Thread** CollectorThread::threads = NULL;
+uint32_t CollectorThread::nbThreads = 0;
+uint32_t CollectorThread::threadsCapacity = 0;
+uint32_t CollectorThread::threadCounter = 0;
+
+void CollectorThread::startCollectorThreads(vmkit::VirtualMachine* vm,
+                                            uint32_t nb) {
+  if (nb > MaxCollectors) nb = MaxCollectors;
+  for (uint32_t i = 1; i < nb; ++i) {
+    CollectorThread* th = new CollectorThread();
+    th->MyVM = vm;
+    // The ordinal is set once the thread is ready to collect. Until then,
+    // use it as the identifier of the collector context.
+    th->ordinal = i;
+    // Collector threads do not need a mutator context: call the start
+    // function of vmkit::Thread directly.
+    th->Thread::start((void (*)(vmkit::Thread*))collectorStart);
+  }
+}
+
+void CollectorThread::collectorStart(CollectorThread* th) {
+  word_t context =
+    JnJVM_org_j3_bindings_Bindings_allocateCollector__I(th->ordinal);
+
+  // From now on, this thread only runs the collector, and never goes back to
+  // cooperative code: the rendezvous of the VM counts it as joined, and
+  // locks do not try to join the rendezvous while a collection runs.
+  th->enterUncooperativeCode();
+  th->inRV = true;
+
+  lock.lock();
+  assert(nbCollectors < MaxCollectors && "Too many collector threads");
+  th->ordinal = nbCollectors;
+  contexts[th->ordinal] = context;
+  th->CollectorContext = context;
+  ++nbCollectors;
+  uint32_t seen = collections;
+
+  while (true) {
+    while (collections == seen) {
+      startCond.wait(&lock);
+    }
+    seen = collections;
+    lock.unlock();
+
+    JnJVM_org_j3_bindings_Bindings_collectorCollect__Lorg_mmtk_plan_CollectorContext_2(context);
+
+    lock.lock();
+    if (--nbRunning == 0) {
+      doneCond.signal();
+    }
+  }
+}
+
+void CollectorThread::collect() {
+  vmkit::MutatorThread* th = vmkit::MutatorThread::get();
+  assert(th->inRV && "Collecting without a rendezvous");
+
+  if (contexts[0] == 0) {
+    contexts[0] = JnJVM_org_j3_bindings_Bindings_bootstrapCollector__();
+  }
+  th->CollectorContext = contexts[0];
+
+  // Other collector threads may scan the stack of this thread: tell them
+  // where it starts. Frames below belong to the collector.
+  th->setLastSP(vmkit::System::GetCallerAddress());
+
+  // Snapshot the threads whose stack must be scanned. The thread list does
+  // not change during the collection, the initiator holds its lock.
+  nbThreads = 0;
+  vmkit::Thread* cur = th;
+  do {
+    if (nbThreads == threadsCapacity) {
+      threadsCapacity = threadsCapacity ? 2 * threadsCapacity : 64;
+      threads = (vmkit::Thread**)realloc(
+          threads, threadsCapacity * sizeof(vmkit::Thread*));
+    }
+    threads[nbThreads++] = cur;
+    cur = (vmkit::Thread*)cur->next();
+  } while (cur != th);
+  threadCounter = 0;
+
+  lock.lock();
+  nbActive = nbCollectors;
+  nbRunning = nbActive - 1;
+  if (nbRunning != 0) {
+    ++collections;
+    startCond.broadcast();
+  }
+  lock.unlock();
+
+  JnJVM_org_j3_bindings_Bindings_collectorCollect__Lorg_mmtk_plan_CollectorContext_2(contexts[0]);
+
+  lock.lock();
+  while (nbRunning != 0) {
+    doneCond.wait(&lock);
+  }
+  lock.unlock();
+
+  th->setLastSP(0);
+  th->CollectorContext = 0;
+}
+
+int CollectorThread::rendezvous() {
+  if (nbActive == 1) return 1;
+
+  lock.lock();
+  int order = ++arrived;
+  if ((uint32_t)order == nbActive) {
+    arrived = 0;
+    ++rendezvousCount;
+    rendezvousCond.broadcast();
+  } else {
+    uint32_t count = rendezvousCount;
+    while (count == rendezvousCount) {
+      rendezvousCond.wait(&lock);
+    }
+  }
+  lock.unlock();
+  return order;
+}
+
+uint32_t CollectorThread::getOrdinal() {
+  word_t context = vmkit::MutatorThread::get()->CollectorContext;
+  for (uint32_t i = 0; i < nbActive; ++i) {
+    if (contexts[i] == context) return i;
+  }
+  return 0;
+}
+
+} // namespace mmtk
@@ -0,0 +1,132 @@
+//===------- CollectorThread.h - Threads of the parallel collector --------===//
+//
+//                              The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MMTK_COLLECTOR_THREAD_H
+#define MMTK_COLLECTOR_THREAD_H
+
+#include "vmkit/Cond.h"
+#include "vmkit/Locks.h"
+
+#include "MutatorThread.h"
+
+namespace vmkit {
+  class VirtualMachine;
+}
+
+namespace mmtk {
+
+/// CollectorThread - A thread that helps the thread triggering a collection
+/// to run the phases of the collector. Collector threads never run code
+/// with objects on their stack, so they stay in uncooperative code and the
+/// rendezvous of the VM never waits for them.
+///
+class CollectorThread : public vmkit::MutatorThread {
+public:
+  /// MaxCollectors - The maximum number of collector contexts, including the
+  /// one of the thread triggering the collection. Immix does not support more.
+  ///
+  static const uint32_t MaxCollectors = 16;
+
+  /// ordinal - The ordinal of this thread. The thread triggering a collection
+  /// has ordinal zero.
+  ///
+  uint32_t ordinal;
+
+  /// contexts - The collector contexts, indexed by ordinal.
+  ///
+  static word_t contexts[MaxCollectors];
+
+  /// nbCollectors - The number of collector contexts ready to collect.
+  ///
+  static uint32_t nbCollectors;
+
+  /// nbActive - The number of threads running the current collection.
+  ///
+  static uint32_t nbActive;
+
+  /// collections - Number of collections started, used by collector
+  /// threads to know when a new collection starts.
+  ///
+  static uint32_t collections;
+
+  /// nbRunning - Number of collector threads that have not finished the
+  /// current collection.
+  ///
+  static uint32_t nbRunning;
+
+  /// lock - Lock protecting the state of the collector threads.
+  ///
+  static vmkit::LockNormal lock;
+
+  /// startCond - Condition to wake up collector threads.
+  ///
+  static vmkit::Cond startCond;
+
+  /// doneCond - Condition to wake up the thread triggering the collection
+  /// once the collector threads are done.
+  ///
+  static vmkit::Cond doneCond;
+
+  /// arrived - Number of threads waiting on the current rendezvous.
+  ///
+  static uint32_t arrived;
+
+  /// rendezvousCount - Number of rendezvous that completed.
+  ///
+  static uint32_t rendezvousCount;
+
+  /// rendezvousCond - Condition to wake up the threads of a rendezvous.
+  ///
+  static vmkit::Cond rendezvousCond;
+
+  /// threads - The threads whose stack must be scanned in the current
+  /// collection.
+  ///
+  static vmkit::Thread** threads;
+
+  /// nbThreads - The number of threads in threads.
+  ///
+  static uint32_t nbThreads;
+
+  /// threadsCapacity - The number of threads the threads array can hold.
+  ///
+  static uint32_t threadsCapacity;
+
+  /// threadCounter - The index in threads of the next stack to scan.
+  /// Collector threads claim stacks by incrementing it.
+  ///
+  static uint32_t threadCounter;
+
+  /// startCollectorThreads - Start the collector threads so that nb threads,
+  /// including the thread triggering a collection, collect.
+  ///
+  static void startCollectorThreads(vmkit::VirtualMachine* vm, uint32_t nb);
+
+  /// collect - Run a collection with all the collector threads. Called by
+  /// the thread triggering the collection once all mutators are stopped.
+  ///
+  static void collect();
+
+  /// rendezvous - Wait for all the threads of the collection, and return the
+  /// order in which this thread arrived, starting at one.
+  ///
+  static int rendezvous();
+
+  /// getOrdinal - The ordinal of the current thread in the collection.
+  ///
+  static uint32_t getOrdinal();
+
+  /// collectorStart - The main loop of a collector thread.
+  ///
+  static void collectorStart(CollectorThread* th);
+};
+
+} // namespace mmtk
+
+#endif // MMTK_COLLECTOR_THREAD_H
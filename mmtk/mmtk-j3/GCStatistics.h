@@ -0,0 +1,104 @@
+//===-------- GCStatistics.h - Counters and event log of collections ------===//
+//
+//                              The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MMTK_GC_STATISTICS_H
+#define MMTK_GC_STATISTICS_H
+
+#include "vmkit/Thread.h"
+#include "VmkitGC.h"
+
+namespace mmtk {
+
+/// GCStatistics - Counters of the collections, and the event log written
+/// when -verbose:gc or -Xlog:gc is given. Each collection logs a start and
+/// an end event, one line each, made of name=value fields.
+///
+class GCStatistics {
+public:
+  /// collections - The number of collections since the start.
+  ///
+  static uint64_t collections;
+
+  /// totalNanos - The total pause time of the collections.
+  ///
+  static uint64_t totalNanos;
+
+  /// bootNanos - The time at which the collector was initialised. Events
+  /// are timed from it.
+  ///
+  static uint64_t bootNanos;
+
+  /// startNanos - The time at which the current collection started to stop
+  /// the threads.
+  ///
+  static uint64_t startNanos;
+
+  /// usedBefore - The memory used by objects before the current collection.
+  ///
+  static size_t usedBefore;
+
+  /// rootsScanned, bytesTraced - The number of roots and the size of the
+  /// objects traced by the current collection. Only counted when
+  /// collections are logged.
+  ///
+  static uint64_t rootsScanned;
+  static uint64_t bytesTraced;
+
+  /// rootScanner - The collector thread reporting the global and static
+  /// roots of the virtual machine, while it reports them. Object tracers
+  /// also report edges as roots, and they are not counted.
+  ///
+  static vmkit::Thread* rootScanner;
+
+  /// pagesAcquired, pagesReleased - The pages that spaces acquired and
+  /// released since the previous collection.
+  ///
+  static uint64_t pagesAcquired;
+  static uint64_t pagesReleased;
+
+  /// startCollection - Record the start of a collection, once the threads
+  /// are stopped. start is the time at which stopping them began, and why
+  /// is the MMTk trigger of the collection.
+  ///
+  static void startCollection(uint64_t start, int why);
+
+  /// endCollection - Record the end of a collection. fullHeap tells
+  /// whether the collection traced the whole heap.
+  ///
+  static void endCollection(bool fullHeap);
+
+  /// countRoot - Count a root reported to the collector.
+  ///
+  static void countRoot() {
+    if (vmkit::Collector::logFile != NULL) {
+      __sync_fetch_and_add(&rootsScanned, 1);
+    }
+  }
+
+  /// countRootEdge - Count an edge reported as a root, if it is reported
+  /// while scanning the roots of the virtual machine.
+  ///
+  static void countRootEdge() {
+    if (vmkit::Collector::logFile != NULL &&
+        rootScanner == vmkit::Thread::get()) {
+      __sync_fetch_and_add(&rootsScanned, 1);
+    }
+  }
+  /// countTraced - Count an object traced by the collector.
+  ///
+  static void countTraced(size_t size) {
+    if (vmkit::Collector::logFile != NULL) {
+      __sync_fetch_and_add(&bytesTraced, (uint64_t)size);
+    }
+  }
+};
+
+} // namespace mmtk
+
+#endif // MMTK_GC_STATISTICS_H
@@ -26,6 +26,9 @@ extern "C" void Java_org_j3_mmtk_Lock_acquire__(MMTkLock* l) {
 }
 
 extern "C" void Java_org_j3_mmtk_Lock_release__(MMTkLock* l) {
+  // Collector threads share locks: make the writes of the critical section
+  // visible before the lock.
+  __sync_synchronize();
   l->state = 0;
 }
 
@@ -7,29 +7,32 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "vmkit/System.h"
+
+#include "GCStatistics.h"
 #include "MMTkObject.h"
 
+#include <cstdio>
+
 namespace mmtk {
 
 extern "C" void Java_org_j3_mmtk_MMTk_1Events_tracePageAcquired__Lorg_mmtk_policy_Space_2Lorg_vmmagic_unboxed_Address_2I(
     MMTkObject* event, MMTkObject* space, word_t address, int numPages) {
-#if 0
-  fprintf(stderr, "Pages acquired by thread %p from space %p at %x (%d)\n", (void*)vmkit::Thread::get(), (void*)space, address, numPages);
-#endif
+  __sync_fetch_and_add(&GCStatistics::pagesAcquired, (uint64_t)numPages);
 }
 
 extern "C" void Java_org_j3_mmtk_MMTk_1Events_tracePageReleased__Lorg_mmtk_policy_Space_2Lorg_vmmagic_unboxed_Address_2I(
     MMTkObject* event, MMTkObject* space, word_t address, int numPages) {
-#if 0
-  fprintf(stderr, "Pages released by thread %p from space %p at %x (%d)\n", (void*)vmkit::Thread::get(), (void*)space, address, numPages);
-#endif
+  __sync_fetch_and_add(&GCStatistics::pagesReleased, (uint64_t)numPages);
 }
 
 extern "C" void Java_org_j3_mmtk_MMTk_1Events_heapSizeChanged__Lorg_vmmagic_unboxed_Extent_2(
     MMTkObject* event, word_t heapSize) {
-#if 0
-  fprintf(stderr, "New heap size : %d\n", (int)heapSize);
-#endif
+  FILE* log = vmkit::Collector::logFile;
+  if (log == NULL) return;
+  uint64_t now = vmkit::System::GetTimeNanos() - GCStatistics::bootNanos;
+  fprintf(log, "[gc] event=heap-resize time_us=%llu heap_total_kb=%llu\n",
+          (unsigned long long)now / 1000, (unsigned long long)heapSize >> 10);
 }
 
 }
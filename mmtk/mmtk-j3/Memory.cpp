@@ -11,6 +11,7 @@
 #include "vmkit/VirtualMachine.h"
 #include "MMTkObject.h"
 
+#include <cerrno>
 #include <sys/mman.h>
 
 namespace mmtk {
@@ -18,8 +19,10 @@ namespace mmtk {
 class InitCollector {
 public:
   InitCollector() {
-    uint32 flags = MAP_PRIVATE | MAP_ANON | MAP_FIXED;
-    void* baseAddr = mmap((void*)vmkit::kGCMemoryStart, vmkit::kGCMemorySize, PROT_READ | PROT_WRITE,
+    // Only reserve the address range of the heap, so that other allocators
+    // do not use it. Pages are committed by dzmmap when MMTk maps them.
+    uint32 flags = MAP_PRIVATE | MAP_ANON | MAP_FIXED | MAP_NORESERVE;
+    void* baseAddr = mmap((void*)vmkit::kGCMemoryStart, vmkit::kGCMemorySize, PROT_NONE,
                           flags, -1, 0);
     if (baseAddr == MAP_FAILED) {
       perror("mmap for GC memory");
@@ -28,7 +31,7 @@ public:
   }
 };
 
-// Allocate the memory for MMTk right now, to avoid conflicts with other allocators.
+// Reserve the memory for MMTk right now, to avoid conflicts with other allocators.
 InitCollector initCollector;
 
 extern "C" word_t Java_org_j3_mmtk_Memory_getHeapStartConstant__ (MMTkObject* M) {
@@ -51,8 +54,20 @@ extern "C" sint32
 Java_org_j3_mmtk_Memory_dzmmap__Lorg_vmmagic_unboxed_Address_2I(MMTkObject* M,
                                                                 void* start,
                                                                 sint32 size) {
-  // Already mmapped during initialization.
-  return 0;
+  // The range has been reserved during initialization, commit it now.
+  assert((word_t)start >= vmkit::kGCMemoryStart &&
+         (word_t)start + size <= vmkit::kGCMemoryStart + vmkit::kGCMemorySize &&
+         "Mapping memory outside of the heap");
+  int val = mprotect(start, size, PROT_READ | PROT_WRITE);
+  return (val == 0) ? 0 : errno;
+}
+
+extern "C" void
+Java_org_j3_mmtk_Memory_release__Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_Extent_2(MMTkObject* M,
+                                                                                             void* start,
+                                                                                             word_t len) {
+  // The pages stay mapped: the next access faults in a zeroed page.
+  madvise(start, len, MADV_DONTNEED);
 }
 
 extern "C" uint8_t
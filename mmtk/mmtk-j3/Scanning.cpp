@@ -9,6 +9,8 @@
 
 #include "debug.h"
 #include "vmkit/VirtualMachine.h"
+#include "CollectorThread.h"
+#include "GCStatistics.h"
 #include "MMTkObject.h"
 #include "VmkitGC.h"
 
@@ -16,17 +18,20 @@ namespace mmtk {
 
 extern "C" void Java_org_j3_mmtk_Scanning_computeThreadRoots__Lorg_mmtk_plan_TraceLocal_2 (MMTkObject* Scanning, MMTkObject* TL) {
   // When entering this function, all threads are waiting on the rendezvous to
-  // finish.
-  vmkit::Thread* th = vmkit::Thread::get();
-  vmkit::Thread* tcur = th;
-  
-  do {
-    tcur->scanStack(reinterpret_cast<word_t>(TL));
-    tcur = (vmkit::Thread*)tcur->next();
-  } while (tcur != th);
+  // finish. All collector threads call this function, and claim the stacks
+  // to scan one at a time.
+  uint32_t index = 0;
+  while ((index = __sync_fetch_and_add(&CollectorThread::threadCounter, 1)) <
+         CollectorThread::nbThreads) {
+    CollectorThread::threads[index]->scanStack(reinterpret_cast<word_t>(TL));
+  }
 }
 
 extern "C" void Java_org_j3_mmtk_Scanning_computeGlobalRoots__Lorg_mmtk_plan_TraceLocal_2 (MMTkObject* Scanning, MMTkObject* TL) { 
+  // All collector threads call this function, only the first one traces the
+  // global roots.
+  if (CollectorThread::getOrdinal() != 0) return;
+  GCStatistics::rootScanner = vmkit::Thread::get();
   vmkit::Thread::get()->MyVM->tracer(reinterpret_cast<word_t>(TL));
   
 	vmkit::Thread* th = vmkit::Thread::get();
@@ -36,20 +41,46 @@ extern "C" void Java_org_j3_mmtk_Scanning_computeGlobalRoots__Lorg_mmtk_plan_Tra
     tcur->tracer(reinterpret_cast<word_t>(TL));
     tcur = (vmkit::Thread*)tcur->next();
   } while (tcur != th);
+  GCStatistics::rootScanner = NULL;
 }
 
 extern "C" void Java_org_j3_mmtk_Scanning_computeStaticRoots__Lorg_mmtk_plan_TraceLocal_2 (MMTkObject* Scanning, MMTkObject* TL) {
-  // Nothing to do.
+  // All collector threads call this function, only the first one traces the
+  // static roots.
+  if (CollectorThread::getOrdinal() != 0) return;
+  GCStatistics::rootScanner = vmkit::Thread::get();
+  vmkit::Thread::get()->MyVM->staticRootsTracer(reinterpret_cast<word_t>(TL));
+  GCStatistics::rootScanner = NULL;
 }
 
 extern "C" void Java_org_j3_mmtk_Scanning_resetThreadCounter__ (MMTkObject* Scanning) {
-  // Nothing to do.
+  CollectorThread::threadCounter = 0;
+}
+
+/// scanObject - Call the tracer of the virtual table of the object. The
+/// tracer is specialized for the layout of the object, so objects are traced
+/// without going through the virtual machine.
+///
+static inline void scanObject(gc* obj, word_t closure) {
+  typedef void (*tracer_t)(gc*, word_t);
+  tracer_t tracer =
+    reinterpret_cast<tracer_t>(VirtualTable::getVirtualTable(obj)->tracer);
+  assert(tracer && "No tracer in VT");
+  if (vmkit::Collector::logFile != NULL) {
+    GCStatistics::countTraced(vmkit::Thread::get()->MyVM->getObjectSize(obj));
+  }
+  tracer(obj, closure);
 }
 
 extern "C" void Java_org_j3_mmtk_Scanning_specializedScanObject__ILorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2 (MMTkObject* Scanning, uint32_t id, MMTkObject* TC, gc* obj) ALWAYS_INLINE;
 
 extern "C" void Java_org_j3_mmtk_Scanning_specializedScanObject__ILorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2 (MMTkObject* Scanning, uint32_t id, MMTkObject* TC, gc* obj) {
-  vmkit::Thread::get()->MyVM->traceObject(obj, reinterpret_cast<word_t>(TC));
+  scanObject(obj, reinterpret_cast<word_t>(TC));
+}
+
+extern "C" void Java_org_j3_mmtk_Scanning_scanArrayChunk__Lorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2I (
+    MMTkObject* Scanning, word_t TC, gc* array, int32_t start) {
+  vmkit::Thread::get()->MyVM->traceArrayChunk(array, start, TC);
 }
 
 extern "C" void Java_org_j3_mmtk_Scanning_preCopyGCInstances__Lorg_mmtk_plan_TraceLocal_2 (MMTkObject* Scanning, MMTkObject* TL) {
@@ -58,7 +89,7 @@ extern "C" void Java_org_j3_mmtk_Scanning_preCopyGCInstances__Lorg_mmtk_plan_Tra
 
 extern "C" void Java_org_j3_mmtk_Scanning_scanObject__Lorg_mmtk_plan_TransitiveClosure_2Lorg_vmmagic_unboxed_ObjectReference_2 (
     MMTkObject* Scanning, word_t TC, gc* obj) {
-	vmkit::Thread::get()->MyVM->traceObject(obj, TC);
+  scanObject(obj, TC);
 }
 
 extern "C" void Java_org_j3_mmtk_Scanning_precopyChildren__Lorg_mmtk_plan_TraceLocal_2Lorg_vmmagic_unboxed_ObjectReference_2 (
@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "CollectorThread.h"
 #include "MutatorThread.h"
 #include "MMTkObject.h"
 
@@ -16,4 +17,12 @@ extern "C" MMTkObject* Java_org_j3_config_Selected_00024Mutator_get__() {
   return (MMTkObject*)vmkit::MutatorThread::get()->MutatorContext;
 }
 
+extern "C" MMTkObject* Java_org_j3_config_Selected_00024Collector_get__() {
+  return (MMTkObject*)vmkit::MutatorThread::get()->CollectorContext;
+}
+
+extern "C" void Java_org_j3_config_Selected_00024Collector_staticCollect__() {
+  CollectorThread::collect();
+}
+
 }
@@ -2,47 +2,203 @@
 //
 //                              The VMKit project
 //
-// This file is distributed under the University of Illinois Open Source 
+// This file is distributed under the University of Illinois Open Source
 // License. See LICENSE.TXT for details.
 //
 //===----------------------------------------------------------------------===//
 
+#include "vmkit/System.h"
+
+#include "GCStatistics.h"
 #include "MMTkObject.h"
 
-#include <sys/time.h>
-#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
 
 namespace mmtk {
 
-extern "C" int64_t Java_org_j3_mmtk_Statistics_cycles__ (MMTkObject* S) {
-  return 0;
+uint64_t GCStatistics::collections = 0;
+uint64_t GCStatistics::totalNanos = 0;
+uint64_t GCStatistics::bootNanos = 0;
+uint64_t GCStatistics::startNanos = 0;
+size_t GCStatistics::usedBefore = 0;
+uint64_t GCStatistics::rootsScanned = 0;
+uint64_t GCStatistics::bytesTraced = 0;
+vmkit::Thread* GCStatistics::rootScanner = NULL;
+uint64_t GCStatistics::pagesAcquired = 0;
+uint64_t GCStatistics::pagesReleased = 0;
+
+/// triggerNames - The names of the MMTk triggers of collections, in the
+/// order of org.mmtk.vm.Collection.
+///
+static const char* triggerNames[] = {
+  "unknown", "phase", "system", "allocation", "internal"
+};
+
+static size_t usedMemory() {
+  return vmkit::Collector::getTotalMemory() -
+         vmkit::Collector::getFreeMemory();
 }
 
-extern "C" int64_t Java_org_j3_mmtk_Statistics_nanoTime__ (MMTkObject* S) {
-  int64_t result;
-  struct timeval tp; 
+void GCStatistics::startCollection(uint64_t start, int why) {
+  startNanos = start;
+  rootsScanned = 0;
+  bytesTraced = 0;
+  FILE* log = vmkit::Collector::logFile;
+  if (log == NULL) return;
+  usedBefore = usedMemory();
+  const char* reason = (why >= 0 && why < 5) ? triggerNames[why] : "unknown";
+  fprintf(log, "[gc] event=start id=%llu time_us=%llu reason=%s "
+               "heap_used_kb=%llu\n",
+          (unsigned long long)collections + 1,
+          (unsigned long long)(start - bootNanos) / 1000, reason,
+          (unsigned long long)usedBefore >> 10);
+}
 
-  int res = gettimeofday (&tp, NULL);
-  USE(res);
-  assert(res != -1 && "failed gettimeofday.");
+void GCStatistics::endCollection(bool fullHeap) {
+  uint64_t end = vmkit::System::GetTimeNanos();
+  uint64_t pause = end - startNanos;
+  ++collections;
+  totalNanos += pause;
+  FILE* log = vmkit::Collector::logFile;
+  if (log == NULL) return;
+  fprintf(log, "[gc] event=end id=%llu time_us=%llu kind=%s pause_us=%llu "
+               "heap_before_kb=%llu heap_after_kb=%llu heap_total_kb=%llu "
+               "roots=%llu traced_kb=%llu pages_acquired=%llu "
+               "pages_released=%llu\n",
+          (unsigned long long)collections,
+          (unsigned long long)(end - bootNanos) / 1000,
+          fullHeap ? "full" : "nursery",
+          (unsigned long long)pause / 1000,
+          (unsigned long long)usedBefore >> 10,
+          (unsigned long long)usedMemory() >> 10,
+          (unsigned long long)vmkit::Collector::getTotalMemory() >> 10,
+          (unsigned long long)rootsScanned,
+          (unsigned long long)bytesTraced >> 10,
+          (unsigned long long)pagesAcquired,
+          (unsigned long long)pagesReleased);
+  fflush(log);
+  pagesAcquired = 0;
+  pagesReleased = 0;
+}
 
-  result = (int64_t) tp.tv_sec;
-  result *= (int64_t)1000000L;
-  result += (int64_t)tp.tv_usec;
-  result *= (int64_t)1000;
+extern "C" int64_t Java_org_j3_mmtk_Statistics_cycles__ (MMTkObject* S) {
+#if defined(__i386__) || defined(__x86_64__)
+  uint32_t low, high;
+  __asm__ __volatile__ ("rdtsc" : "=a" (low), "=d" (high));
+  return ((int64_t)high << 32) | low;
+#else
+  return vmkit::System::GetTimeNanos();
+#endif
+}
 
-  return result;
+extern "C" int64_t Java_org_j3_mmtk_Statistics_nanoTime__ (MMTkObject* S) {
+  return vmkit::System::GetTimeNanos();
 }
 
 
 extern "C" int32_t Java_org_j3_mmtk_Statistics_getCollectionCount__ (MMTkObject* S) {
-  return 0;
+  return (int32_t)GCStatistics::collections;
 }
 
-extern "C" void Java_org_j3_mmtk_Statistics_perfEventInit__Ljava_lang_String_2(MMTkObject* S, MMTkObject* Str) {
+/// MaxPerfEvents - The maximum number of performance events MMTk can read.
+///
+static const int MaxPerfEvents = 16;
+
+/// perfEventFds - The file descriptors of the performance events, or -1 if
+/// an event could not be opened.
+///
+static int perfEventFds[MaxPerfEvents];
+
+#if defined(__linux__)
+/// perfEventConfig - The generic hardware event of a name of
+/// -X:gc:perfEvents, or -1 if the name is not known.
+///
+static int64_t perfEventConfig(const char* name) {
+  static const struct {
+    const char* name;
+    int64_t config;
+  } events[] = {
+    { "PERF_COUNT_HW_CPU_CYCLES", PERF_COUNT_HW_CPU_CYCLES },
+    { "PERF_COUNT_HW_INSTRUCTIONS", PERF_COUNT_HW_INSTRUCTIONS },
+    { "PERF_COUNT_HW_CACHE_REFERENCES", PERF_COUNT_HW_CACHE_REFERENCES },
+    { "PERF_COUNT_HW_CACHE_MISSES", PERF_COUNT_HW_CACHE_MISSES },
+    { "PERF_COUNT_HW_BRANCH_INSTRUCTIONS",
+      PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+    { "PERF_COUNT_HW_BRANCH_MISSES", PERF_COUNT_HW_BRANCH_MISSES },
+    { "PERF_COUNT_HW_BUS_CYCLES", PERF_COUNT_HW_BUS_CYCLES }
+  };
+  for (uint32_t i = 0; i < sizeof(events) / sizeof(events[0]); ++i) {
+    if (!strcmp(name, events[i].name)) return events[i].config;
+  }
+  return -1;
+}
+
+static int openPerfEvent(const char* name) {
+  int64_t config = perfEventConfig(name);
+  if (config == -1) {
+    fprintf(stderr, "Unknown performance event %s.\n", name);
+    return -1;
+  }
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format =
+    PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // Count the threads created after the boot too.
+  attr.inherit = 1;
+  int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd == -1) {
+    fprintf(stderr, "Can not open the performance event %s.\n", name);
+  }
+  return fd;
+}
+#endif
+
+extern "C" void Java_org_j3_mmtk_Statistics_perfEventInit__Ljava_lang_String_2(MMTkObject* S, MMTkString* Str) {
+  for (int i = 0; i < MaxPerfEvents; ++i) perfEventFds[i] = -1;
+  if (Str == NULL) return;
+
+  // The events are separated by commas, as in -X:gc:perfEvents.
+  char name[128];
+  int length = 0;
+  int id = 0;
+  for (int32_t i = 0; i <= Str->count && id < MaxPerfEvents; ++i) {
+    char c = (i == Str->count) ? ',' :
+             (char)Str->value->elements[Str->offset + i];
+    if (c != ',') {
+      if (length < (int)sizeof(name) - 1) name[length++] = c;
+      continue;
+    }
+    if (length == 0) continue;
+    name[length] = 0;
+    length = 0;
+#if defined(__linux__)
+    perfEventFds[id] = openPerfEvent(name);
+#else
+    fprintf(stderr, "Performance events are not supported.\n");
+#endif
+    ++id;
+  }
 }
 
-extern "C" void Java_org_j3_mmtk_Statistics_perfEventRead__I_3J(MMTkObject* S, int id, int64_t* values) {
+extern "C" void Java_org_j3_mmtk_Statistics_perfEventRead__I_3J(MMTkObject* S, int id, MMTkArray* values) {
+  // values holds the raw count, the time enabled and the time running.
+  int64_t* counts = reinterpret_cast<int64_t*>(values->elements);
+  counts[0] = counts[1] = counts[2] = 0;
+  if (id < 0 || id >= MaxPerfEvents || perfEventFds[id] == -1) return;
+  uint64_t buffer[3];
+  if (read(perfEventFds[id], buffer, sizeof(buffer)) == sizeof(buffer)) {
+    for (int i = 0; i < 3; ++i) counts[i] = (int64_t)buffer[i];
+  }
 }
 
 } // namespace mmtk
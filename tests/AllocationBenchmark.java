@@ -0,0 +1,76 @@
+// Allocates small objects and int arrays of a size only known at runtime
+// from 1, 2, 4 and 8 threads, and prints the allocation rate of each run.
+// Allocation buffers are used with the generational and semi-space plans:
+//   ./configure --with-mmtk-plan=genimmix && make && j3 AllocationBenchmark
+//   j3 AllocationBenchmark <allocations per thread> <maximum threads> \
+//                          <minimum array length>
+public class AllocationBenchmark {
+
+  static class Point {
+    int x;
+    int y;
+    Point next;
+  }
+
+  static volatile int sink;
+
+  static int allocateObjects(int count) {
+    Point last = null;
+    for (int i = 0; i < count; ++i) {
+      Point p = new Point();
+      p.x = i;
+      p.next = last;
+      // Keep a short chain alive, so that the allocations are not removed.
+      last = ((i & 7) == 0) ? null : p;
+    }
+    return last == null ? 0 : last.x;
+  }
+
+  static int allocateArrays(int count, int length) {
+    int total = 0;
+    for (int i = 0; i < count; ++i) {
+      int[] array = new int[length + (i & 7)];
+      array[0] = i;
+      total += array.length;
+    }
+    return total;
+  }
+
+  static long run(int nbThreads, final int count, final boolean arrays,
+                  final int length) throws InterruptedException {
+    Thread[] threads = new Thread[nbThreads];
+    for (int i = 0; i < nbThreads; ++i) {
+      threads[i] = new Thread() {
+        public void run() {
+          sink += arrays ? allocateArrays(count, length) :
+                           allocateObjects(count);
+        }
+      };
+    }
+    long start = System.nanoTime();
+    for (int i = 0; i < nbThreads; ++i) threads[i].start();
+    for (int i = 0; i < nbThreads; ++i) threads[i].join();
+    return System.nanoTime() - start;
+  }
+
+  public static void main(String[] args) throws InterruptedException {
+    int count = args.length > 0 ? Integer.parseInt(args[0]) : 10000000;
+    int maxThreads = args.length > 1 ? Integer.parseInt(args[1]) : 8;
+    // Read the length from the arguments so that the compiler can not fold
+    // the size of the arrays.
+    int length = args.length > 2 ? Integer.parseInt(args[2]) : 4;
+
+    // Warm up the compiler.
+    run(1, count / 10, false, length);
+    run(1, count / 10, true, length);
+
+    for (int n = 1; n <= maxThreads; n <<= 1) {
+      long objects = run(n, count, false, length);
+      long arrays = run(n, count, true, length);
+      System.out.println(n + " threads: " +
+                         ((long)n * count * 1000 / objects) +
+                         " objects/ms, " +
+                         ((long)n * count * 1000 / arrays) + " arrays/ms");
+    }
+  }
+}
@@ -0,0 +1,91 @@
+// Serves simulated requests that allocate short-lived objects, while a table
+// of long-lived objects is slowly updated, and prints the pauses seen by the
+// requests. Compare a build with the mark-sweep plan and a build with a
+// generational plan:
+//   ./configure --with-mmtk-plan=ms && make && j3 GCPauseBenchmark
+//   ./configure --with-mmtk-plan=genms && make && j3 GCPauseBenchmark
+//   j3 GCPauseBenchmark <number of requests> <live objects>
+public class GCPauseBenchmark {
+
+  static class Entry {
+    Entry next;
+    byte[] payload;
+    int key;
+  }
+
+  // Pauses shorter than this are not counted.
+  static final long minPauseNanos = 1000000;
+
+  static Entry[] table;
+
+  static int serve(int request) {
+    // Most of the objects of a request die when the request ends.
+    Entry head = null;
+    for (int i = 0; i < 64; ++i) {
+      Entry entry = new Entry();
+      entry.payload = new byte[32 + (i & 63)];
+      entry.key = request + i;
+      entry.next = head;
+      head = entry;
+    }
+    StringBuilder builder = new StringBuilder();
+    for (Entry e = head; e != null; e = e.next) builder.append(e.key);
+
+    // A few objects survive and are stored in old objects.
+    if ((request & 15) == 0) {
+      int index = (request >>> 4) % table.length;
+      Entry old = table[index];
+      head.next = old.next;
+      old.next = head;
+      old.next.next = null;
+    }
+    return builder.length();
+  }
+
+  public static void main(String[] args) {
+    int requests = args.length > 0 ? Integer.parseInt(args[0]) : 2000000;
+    int live = args.length > 1 ? Integer.parseInt(args[1]) : 200000;
+
+    table = new Entry[live];
+    for (int i = 0; i < live; ++i) {
+      table[i] = new Entry();
+      table[i].payload = new byte[64];
+    }
+
+    long[] pauses = new long[1024];
+    int nbPauses = 0;
+    long maxPause = 0;
+    long totalPause = 0;
+    int checksum = 0;
+
+    long start = System.nanoTime();
+    long last = start;
+    for (int i = 0; i < requests; ++i) {
+      checksum += serve(i);
+      long now = System.nanoTime();
+      long pause = now - last;
+      if (pause >= minPauseNanos) {
+        if (nbPauses < pauses.length) pauses[nbPauses] = pause;
+        ++nbPauses;
+        totalPause += pause;
+        if (pause > maxPause) maxPause = pause;
+      }
+      last = now;
+    }
+    long elapsed = System.nanoTime() - start;
+
+    int counted = nbPauses < pauses.length ? nbPauses : pauses.length;
+    java.util.Arrays.sort(pauses, 0, counted);
+    long median = counted > 0 ? pauses[counted / 2] : 0;
+    long p99 = counted > 0 ? pauses[(counted * 99) / 100] : 0;
+
+    System.out.println("Served " + requests + " requests in " +
+                       (elapsed / 1000000) + " ms (checksum " + checksum +
+                       ")");
+    System.out.println("Pauses: " + nbPauses + ", total " +
+                       (totalPause / 1000000) + " ms, median " +
+                       (median / 1000) + " us, 99th percentile " +
+                       (p99 / 1000) + " us, max " + (maxPause / 1000) +
+                       " us");
+  }
+}
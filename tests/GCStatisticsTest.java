@@ -0,0 +1,31 @@
+import java.lang.management.GarbageCollectorMXBean;
+import java.lang.management.ManagementFactory;
+import java.util.List;
+
+public class GCStatisticsTest {
+
+  public static void main(String[] args) throws Exception {
+    List<GarbageCollectorMXBean> collectors =
+      ManagementFactory.getGarbageCollectorMXBeans();
+    check(collectors.size() == 1);
+    GarbageCollectorMXBean gc = collectors.get(0);
+
+    long count = gc.getCollectionCount();
+    long time = gc.getCollectionTime();
+    check(count >= 0);
+    check(time >= 0);
+
+    System.gc();
+    check(gc.getCollectionCount() > count);
+    check(gc.getCollectionTime() >= time);
+
+    count = gc.getCollectionCount();
+    System.gc();
+    System.gc();
+    check(gc.getCollectionCount() >= count + 2);
+  }
+
+  private static void check(boolean b) throws Exception {
+    if (!b) throw new Exception("Test failed!!!");
+  }
+}
@@ -0,0 +1,91 @@
+// Builds a large linked structure and prints the time of full collections,
+// which mark every object of the structure. The structure mixes objects with
+// no reference, with a few references and with many references. Compare the
+// times before and after a change of the object tracers:
+//   j3 ReferenceMapBenchmark
+//   j3 ReferenceMapBenchmark <number of nodes> <number of collections>
+public class ReferenceMapBenchmark {
+
+  static class Leaf {
+    int value;
+    long stamp;
+  }
+
+  static class ListNode {
+    ListNode next;
+    int value;
+  }
+
+  static class TreeNode {
+    TreeNode left;
+    TreeNode right;
+    Leaf leaf;
+  }
+
+  static class WideNode {
+    Object a, b, c, d, e, f;
+    int value;
+  }
+
+  static ListNode makeList(int length) {
+    ListNode head = null;
+    for (int i = 0; i < length; ++i) {
+      ListNode node = new ListNode();
+      node.next = head;
+      node.value = i;
+      head = node;
+    }
+    return head;
+  }
+
+  static TreeNode makeTree(int depth) {
+    TreeNode node = new TreeNode();
+    node.leaf = new Leaf();
+    if (depth > 0) {
+      node.left = makeTree(depth - 1);
+      node.right = makeTree(depth - 1);
+    }
+    return node;
+  }
+
+  static WideNode makeWide(int length) {
+    WideNode head = null;
+    for (int i = 0; i < length; ++i) {
+      WideNode node = new WideNode();
+      node.a = head;
+      node.b = new Leaf();
+      node.c = node.b;
+      node.e = head;
+      node.value = i;
+      head = node;
+    }
+    return head;
+  }
+
+  public static void main(String[] args) {
+    int nodes = args.length > 0 ? Integer.parseInt(args[0]) : 1000000;
+    int collections = args.length > 1 ? Integer.parseInt(args[1]) : 10;
+
+    int depth = 0;
+    while ((2 << depth) < nodes) ++depth;
+    Object[] roots = {
+      makeList(nodes), makeTree(depth), makeWide(nodes / 2)
+    };
+
+    // Warm up the collector.
+    System.gc();
+
+    long total = 0;
+    long best = Long.MAX_VALUE;
+    for (int i = 0; i < collections; ++i) {
+      long start = System.nanoTime();
+      System.gc();
+      long elapsed = System.nanoTime() - start;
+      total += elapsed;
+      if (elapsed < best) best = elapsed;
+    }
+    System.out.println("Marked " + roots.length + " structures of about " +
+                       nodes + " nodes in " + (best / 1000) + " us (best), " +
+                       (total / collections / 1000) + " us (average)");
+  }
+}
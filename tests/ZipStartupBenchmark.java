@@ -0,0 +1,82 @@
+import java.io.BufferedReader;
+import java.io.FileReader;
+
+// Loads classes from the boot archives and prints the time it took and the
+// resident memory of the VM. Compare reading the archives with mapping them:
+//   j3 -Xzip:copy ZipStartupBenchmark
+//   j3 -Xzip:map ZipStartupBenchmark
+public class ZipStartupBenchmark {
+
+  static final String[] classes = {
+    "java.util.ArrayList", "java.util.LinkedList", "java.util.HashMap",
+    "java.util.TreeMap", "java.util.HashSet", "java.util.TreeSet",
+    "java.util.Vector", "java.util.Stack", "java.util.Hashtable",
+    "java.util.IdentityHashMap", "java.util.WeakHashMap",
+    "java.util.LinkedHashMap", "java.util.PriorityQueue",
+    "java.util.Collections", "java.util.Arrays", "java.util.BitSet",
+    "java.util.Calendar", "java.util.GregorianCalendar", "java.util.Date",
+    "java.util.Locale", "java.util.Random", "java.util.Scanner",
+    "java.util.StringTokenizer", "java.util.Timer", "java.util.UUID",
+    "java.util.regex.Pattern", "java.util.regex.Matcher",
+    "java.util.zip.ZipFile", "java.util.zip.Inflater",
+    "java.util.zip.Deflater", "java.util.zip.CRC32",
+    "java.util.concurrent.ConcurrentHashMap",
+    "java.util.concurrent.LinkedBlockingQueue",
+    "java.util.concurrent.ThreadPoolExecutor",
+    "java.util.concurrent.locks.ReentrantLock",
+    "java.util.concurrent.atomic.AtomicInteger",
+    "java.io.File", "java.io.FileInputStream", "java.io.FileOutputStream",
+    "java.io.BufferedInputStream", "java.io.BufferedOutputStream",
+    "java.io.DataInputStream", "java.io.DataOutputStream",
+    "java.io.ObjectInputStream", "java.io.ObjectOutputStream",
+    "java.io.PrintWriter", "java.io.StringReader", "java.io.StringWriter",
+    "java.io.RandomAccessFile", "java.io.PipedInputStream",
+    "java.net.URL", "java.net.URI", "java.net.Socket",
+    "java.net.ServerSocket", "java.net.InetAddress",
+    "java.nio.ByteBuffer", "java.nio.CharBuffer", "java.nio.IntBuffer",
+    "java.nio.channels.FileChannel", "java.nio.charset.Charset",
+    "java.math.BigInteger", "java.math.BigDecimal",
+    "java.text.SimpleDateFormat", "java.text.DecimalFormat",
+    "java.text.MessageFormat", "java.text.Collator",
+    "java.lang.reflect.Proxy", "java.lang.reflect.Array",
+    "java.lang.ref.WeakReference", "java.lang.ref.SoftReference",
+    "java.lang.ref.PhantomReference", "java.lang.StringBuilder",
+    "java.lang.ProcessBuilder", "java.lang.ThreadLocal",
+    "java.security.MessageDigest", "java.security.SecureRandom",
+    "java.util.logging.Logger", "java.util.jar.JarFile",
+    "java.util.jar.Manifest", "java.beans.PropertyChangeSupport"
+  };
+
+  static long residentKB() {
+    try {
+      BufferedReader reader =
+        new BufferedReader(new FileReader("/proc/self/status"));
+      String line;
+      while ((line = reader.readLine()) != null) {
+        if (line.startsWith("VmRSS:")) {
+          reader.close();
+          String value = line.substring(6).trim();
+          return Long.parseLong(value.substring(0, value.indexOf(' ')));
+        }
+      }
+      reader.close();
+    } catch (Exception e) {
+    }
+    return -1;
+  }
+
+  public static void main(String[] args) throws Exception {
+    long start = System.nanoTime();
+    int loaded = 0;
+    for (int i = 0; i < classes.length; ++i) {
+      try {
+        Class.forName(classes[i]);
+        ++loaded;
+      } catch (ClassNotFoundException e) {
+      }
+    }
+    long elapsed = (System.nanoTime() - start) / 1000000;
+    System.out.println("Loaded " + loaded + " classes in " + elapsed + " ms");
+    System.out.println("Resident memory: " + residentKB() + " kB");
+  }
+}
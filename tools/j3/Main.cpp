@@ -16,6 +16,8 @@
 #include "j3/JavaJITCompiler.h"
 #include "../../lib/j3/VMCore/JnjvmClassLoader.h"
 #include "../../lib/j3/VMCore/Jnjvm.h"
+#include "../../lib/j3/VMCore/Reader.h"
+#include "../../lib/j3/VMCore/SharedArchive.h"
 
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -28,7 +30,10 @@ int main(int argc, char **argv, char **envp) {
 
   // Initialize base components.  
   VmkitModule::initialise(argc, argv);
+  Thread::initialise(argc, argv);
   Collector::initialise(argc, argv);
+  Reader::initialise(argc, argv);
+  SharedArchive::initialise(argc, argv);
  
   // Create the allocator that will allocate the bootstrap loader and the JVM.
   vmkit::BumpPtrAllocator Allocator;
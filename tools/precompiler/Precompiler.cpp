@@ -58,6 +58,7 @@ int main(int argc, char **argv, char **envp) {
 
   // Initialize base components.  
   VmkitModule::initialise(argc, argv);
+  Thread::initialise(argc, argv);
   Collector::initialise(argc, argv);
   
   // Create the allocator that will allocate the bootstrap loader and the JVM.
@@ -123,6 +123,7 @@ int main(int argc, char **argv) {
   }
    
   vmkit::VmkitModule::initialise(argc, argv);
+  vmkit::Thread::initialise(argc, argv);
   vmkit::Collector::initialise(argc, argv);
 
   // WARNING: This is a silly method to discover that we are compiling MMTk.